@@ -0,0 +1,487 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: benchmark driver for the compiler: generates parameterised workloads,
+*                 times repeated runs of ./main and compares them with a baseline
+***************************************************************************************/
+
+// Usage: lcbench [options] [-- compiler options]
+//
+// Each case is a generated (or copied) .lctest file, compiled by running
+// the compiler as a child process: warmup runs first, then the measured
+// runs. wait4() gives each run's peak RSS. The findings notes measure
+// three runs and take the mean, so --runs defaults to 3.
+//
+// Results are CSV, one row per case. With --baseline FILE (an earlier
+// --save) each case is also compared with its baseline mean. A case counts
+// as a regression when it is more than --threshold percent slower and the
+// gap is wider than three standard deviations of either run, so noise on
+// tiny cases does not trip it. Any regression makes the exit status 1.
+//
+// --depth-scaling instead compiles nested lets and cons chains at depths
+// growing tenfold up to --max-depth (10^6 by default) and reports time and
+// peak RSS per nesting level. Each tenfold step may cost at most
+// --growth-limit times ten; steps whose shorter run is under 50 ms are
+// reported but not judged, as process startup dominates them.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::string compiler = "./main";
+    std::string corpus = "../findngs-src/LC";
+    std::vector<std::string> compiler_args;
+    std::vector<std::string> only;      // --case; empty runs every case
+    int runs = 3;
+    int warmup = 1;
+    double scale = 1.0;
+    double threshold = 10.0;            // percent
+    std::string baseline;
+    std::string save;
+    bool keep = false;
+    bool depth_scaling = false;
+    size_t max_depth = 1000000;
+    double growth_limit = 1.5;
+};
+
+struct Case {
+    std::string name;
+    std::function<void(std::ostream &)> generate;
+};
+
+struct Result {
+    std::string name;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+    int runs = 0;
+    double mean_ms = 0;
+    double stddev_ms = 0;
+    double min_ms = 0;
+    long peak_rss_kb = 0;
+};
+
+struct Baseline {
+    double mean_ms;
+    double stddev_ms;
+};
+
+static size_t scaled(const Options &opts, size_t n) {
+    return std::max<size_t>(1, static_cast<size_t>(static_cast<double>(n) * opts.scale));
+}
+
+// (+ 1 2 ... n): one application with n arguments, lowered to a chain
+static void wide_forms(std::ostream &out, size_t forms, size_t width) {
+    for (size_t f = 0; f < forms; f++) {
+        out << "(+";
+        for (size_t i = 0; i < width; i++) out << ' ' << (i + f) % 10;
+        out << ")\n";
+    }
+}
+
+// (+ 1 (* 2 (+ 3 ...))): nesting depth grows the parser's and
+// translator's recursion
+static void deep_forms(std::ostream &out, size_t forms, size_t depth) {
+    for (size_t f = 0; f < forms; f++) {
+        for (size_t i = 0; i < depth; i++) out << (i % 2 ? "(* " : "(+ ") << i % 7 << ' ';
+        out << f % 10;
+        out << std::string(depth, ')') << '\n';
+    }
+}
+
+// many small, distinct top-level forms of the kinds example.lctest has
+static void many_forms(std::ostream &out, size_t forms) {
+    for (size_t i = 0; i < forms; i++) {
+        switch (i % 5) {
+        case 0: out << "(+ " << i % 50 << ' ' << (i + 1) % 50 << ")\n"; break;
+        case 1: out << "(lambda (x" << i << ") (* x" << i << ' ' << i % 9 << "))\n"; break;
+        case 2: out << "(let ((a " << i % 20 << ")) (if (< a 10) (+ a 1) (- a 1)))\n"; break;
+        case 3: out << "(cons " << i % 30 << " (cons " << (i + 7) % 30 << " nil))\n"; break;
+        default: out << "((lambda (f x) (f (f x))) (lambda (n) (+ n 1)) " << i % 40 << ")\n"; break;
+        }
+    }
+}
+
+// Church numerals are unary, so output grows with the literal's value
+static void huge_numerals(std::ostream &out, size_t forms, size_t largest) {
+    for (size_t f = 1; f <= forms; f++) {
+        size_t v = largest * f / forms;
+        out << "(+ " << v << ' ' << v / 2 << ")\n";
+    }
+}
+
+// (let ((x0 0)) (let ((x1 x0)) ... x{n-1})): n nested scopes
+static void nested_lets(std::ostream &out, size_t depth) {
+    for (size_t i = 0; i < depth; i++) {
+        out << "(let ((x" << i << ' ';
+        if (i == 0) {
+            out << '0';
+        } else {
+            out << 'x' << i - 1;
+        }
+        out << ")) ";
+    }
+    out << 'x' << depth - 1 << std::string(depth, ')') << '\n';
+}
+
+// (cons 1 (cons 1 ... nil)): a list literal n elements long
+static void cons_chain(std::ostream &out, size_t depth) {
+    for (size_t i = 0; i < depth; i++) out << "(cons 1 ";
+    out << "nil" << std::string(depth, ')') << '\n';
+}
+
+static std::vector<Case> make_cases(const Options &opts) {
+    std::vector<Case> cases = {
+        {"wide", [&](std::ostream &o) { wide_forms(o, 10, scaled(opts, 5000)); }},
+        {"deep", [&](std::ostream &o) { deep_forms(o, 10, scaled(opts, 2000)); }},
+        {"many", [&](std::ostream &o) { many_forms(o, scaled(opts, 50000)); }},
+        {"numerals", [&](std::ostream &o) { huge_numerals(o, 20, scaled(opts, 100000)); }},
+    };
+    // the findings programs, compiled as they are
+    std::error_code ec;
+    std::vector<fs::path> programs;
+    for (const auto &e : fs::directory_iterator(opts.corpus, ec)) {
+        if (e.is_regular_file()) programs.push_back(e.path());
+    }
+    if (ec) std::cerr << "lcbench: no corpus at " << opts.corpus << ", skipping its cases\n";
+    std::sort(programs.begin(), programs.end());
+    for (const fs::path &p : programs) {
+        cases.push_back({"lc-" + p.filename().string(), [p](std::ostream &o) {
+            std::ifstream in(p, std::ios::binary);
+            o << in.rdbuf();
+        }});
+    }
+    return cases;
+}
+
+// Runs the compiler once; returns false if it could not run or failed.
+static bool run_once(const Options &opts, const std::string &input, double &ms, long &rss_kb) {
+    std::vector<std::string> args = {opts.compiler, input};
+    args.insert(args.end(), opts.compiler_args.begin(), opts.compiler_args.end());
+    std::vector<char *> argv;
+    for (std::string &a : args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) dup2(null, STDOUT_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) return false;
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    rss_kb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool measure(const Options &opts, const std::string &name, const fs::path &input, Result &r) {
+    r.name = name;
+    r.input_bytes = fs::file_size(input);
+    std::vector<double> times;
+    for (int i = 0; i < opts.warmup + opts.runs; i++) {
+        double ms = 0;
+        long rss = 0;
+        if (!run_once(opts, input.string(), ms, rss)) {
+            std::cerr << "lcbench: " << opts.compiler << " failed on case " << name << "\n";
+            return false;
+        }
+        if (i < opts.warmup) continue;
+        times.push_back(ms);
+        r.peak_rss_kb = std::max(r.peak_rss_kb, rss);
+    }
+    r.runs = static_cast<int>(times.size());
+    double sum = 0;
+    for (double t : times) sum += t;
+    r.mean_ms = sum / r.runs;
+    double sq = 0;
+    for (double t : times) sq += (t - r.mean_ms) * (t - r.mean_ms);
+    r.stddev_ms = r.runs > 1 ? std::sqrt(sq / (r.runs - 1)) : 0.0;
+    r.min_ms = *std::min_element(times.begin(), times.end());
+
+    // the compiler writes NAME.lc or NAME.lcb next to its input
+    for (const char *ext : {".lc", ".lcb"}) {
+        fs::path out = input;
+        out.replace_extension(ext);
+        std::error_code ec;
+        if (fs::exists(out, ec)) r.output_bytes = fs::file_size(out, ec);
+    }
+    return true;
+}
+
+static int depth_scaling(const Options &opts, const fs::path &workdir) {
+    struct Shape {
+        const char *name;
+        void (*generate)(std::ostream &, size_t);
+    };
+    const Shape shapes[] = {{"let", nested_lets}, {"cons", cons_chain}};
+    std::vector<size_t> depths;
+    for (size_t d = opts.max_depth; d >= 10 && depths.size() < 4; d /= 10) depths.insert(depths.begin(), d);
+
+    std::cout << "shape,depth,input_bytes,runs,mean_ms,stddev_ms,ns_per_level,peak_rss_kb,rss_bytes_per_level\n";
+    std::cout << std::fixed;
+    int failures = 0;
+    for (const Shape &shape : shapes) {
+        if (!opts.only.empty() && std::find(opts.only.begin(), opts.only.end(), shape.name) == opts.only.end()) {
+            continue;
+        }
+        double prev_ms = 0;
+        size_t prev_depth = 0;
+        for (size_t depth : depths) {
+            std::string name = std::string(shape.name) + "-" + std::to_string(depth);
+            fs::path input = workdir / (name + ".lctest");
+            {
+                std::ofstream out(input, std::ios::binary);
+                shape.generate(out, depth);
+            }
+            Result r;
+            bool ok = measure(opts, name, input, r);
+            std::error_code ec;
+            for (const char *ext : {".lctest", ".lc", ".lcb"}) {
+                fs::path p = input;
+                fs::remove(p.replace_extension(ext), ec);
+            }
+            if (!ok) {
+                failures++;
+                break;
+            }
+            std::cout << shape.name << ',' << depth << ',' << r.input_bytes << ',' << r.runs << ','
+                      << std::setprecision(3) << r.mean_ms << ',' << r.stddev_ms << ','
+                      << std::setprecision(1) << r.mean_ms * 1e6 / depth << ',' << r.peak_rss_kb << ','
+                      << r.peak_rss_kb * 1024.0 / depth << '\n';
+            if (prev_depth > 0 && prev_ms >= 50) {
+                double steps = static_cast<double>(depth) / prev_depth;
+                double growth = r.mean_ms / prev_ms;
+                bool linear = growth <= steps * opts.growth_limit;
+                std::cerr << std::fixed << "lcbench: " << shape.name << " depth " << prev_depth << " -> " << depth << ": "
+                          << std::setprecision(1) << growth << "x time for " << steps << "x depth ("
+                          << (linear ? "linear" : "SUPERLINEAR") << ")\n";
+                if (!linear) failures++;
+            }
+            prev_ms = r.mean_ms;
+            prev_depth = depth;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+static std::vector<std::string> split_csv(const std::string &line) {
+    std::vector<std::string> cells;
+    std::stringstream ss(line);
+    std::string cell;
+    while (std::getline(ss, cell, ',')) cells.push_back(cell);
+    return cells;
+}
+
+static bool load_baseline(const std::string &path, std::map<std::string, Baseline> &out) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "lcbench: cannot read baseline " << path << "\n";
+        return false;
+    }
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    std::vector<std::string> header = split_csv(line);
+    auto column = [&](const char *name) {
+        return static_cast<size_t>(std::find(header.begin(), header.end(), name) - header.begin());
+    };
+    size_t name_col = column("case"), mean_col = column("mean_ms"), sd_col = column("stddev_ms");
+    if (name_col == header.size() || mean_col == header.size() || sd_col == header.size()) {
+        std::cerr << "lcbench: " << path << " is not an lcbench CSV\n";
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::vector<std::string> cells = split_csv(line);
+        if (cells.size() < header.size()) continue;
+        out[cells[name_col]] = {std::atof(cells[mean_col].c_str()), std::atof(cells[sd_col].c_str())};
+    }
+    return true;
+}
+
+static void print_usage() {
+    std::cout << "Usage: lcbench [options] [-- compiler options]\n\n"
+              << "  --compiler PATH   Compiler to run (default ./main)\n"
+              << "  --corpus DIR      Programs run as lc-NAME cases (default ../findngs-src/LC)\n"
+              << "  --runs N          Measured runs per case (default 3)\n"
+              << "  --warmup N        Unmeasured runs first (default 1)\n"
+              << "  --scale X         Multiply generated workload sizes by X (default 1)\n"
+              << "  --case NAME       Run only this case; may be repeated\n"
+              << "  --save FILE       Also write the results to FILE as a baseline\n"
+              << "  --baseline FILE   Compare with a saved baseline and flag regressions\n"
+              << "  --threshold PCT   Slowdown that counts as a regression (default 10)\n"
+              << "  --keep            Keep the generated workload directory\n"
+              << "  --depth-scaling   Time nested lets and cons chains at growing depths instead\n"
+              << "  --max-depth N     Deepest nesting for --depth-scaling (default 1000000)\n"
+              << "  --growth-limit X  Allowed time growth per tenfold depth, over 10x (default 1.5)\n";
+}
+
+int main(int argc, char *argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                std::cerr << "lcbench: " << arg << " needs a value\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--") {
+            opts.compiler_args.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--compiler") {
+            opts.compiler = value();
+        } else if (arg == "--corpus") {
+            opts.corpus = value();
+        } else if (arg == "--runs") {
+            opts.runs = std::max(1, std::atoi(value()));
+        } else if (arg == "--warmup") {
+            opts.warmup = std::max(0, std::atoi(value()));
+        } else if (arg == "--scale") {
+            opts.scale = std::atof(value());
+        } else if (arg == "--case") {
+            opts.only.push_back(value());
+        } else if (arg == "--save") {
+            opts.save = value();
+        } else if (arg == "--baseline") {
+            opts.baseline = value();
+        } else if (arg == "--threshold") {
+            opts.threshold = std::atof(value());
+        } else if (arg == "--depth-scaling") {
+            opts.depth_scaling = true;
+        } else if (arg == "--max-depth") {
+            opts.max_depth = std::strtoull(value(), nullptr, 10);
+        } else if (arg == "--growth-limit") {
+            opts.growth_limit = std::atof(value());
+        } else if (arg == "--keep") {
+            opts.keep = true;
+        } else if (arg == "--help") {
+            print_usage();
+            return 0;
+        } else {
+            std::cerr << "lcbench: unknown option " << arg << "\n";
+            return 2;
+        }
+    }
+    if (opts.max_depth < 10) {
+        std::cerr << "lcbench: --max-depth must be at least 10\n";
+        return 2;
+    }
+    if (opts.scale <= 0) {
+        std::cerr << "lcbench: --scale must be positive\n";
+        return 2;
+    }
+    if (access(opts.compiler.c_str(), X_OK) != 0) {
+        std::cerr << "lcbench: cannot execute " << opts.compiler << " (run make first)\n";
+        return 2;
+    }
+    std::map<std::string, Baseline> baseline;
+    if (!opts.baseline.empty() && !load_baseline(opts.baseline, baseline)) return 2;
+
+    char dir_template[] = "/tmp/lcbench.XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::cerr << "lcbench: cannot create a work directory\n";
+        return 2;
+    }
+    fs::path workdir = dir_template;
+    if (opts.depth_scaling) {
+        int status = depth_scaling(opts, workdir);
+        std::error_code ec;
+        fs::remove_all(workdir, ec);
+        return status;
+    }
+
+    std::ostringstream csv;
+    csv << "case,input_bytes,output_bytes,runs,mean_ms,stddev_ms,min_ms,in_mb_per_s,out_mb_per_s,peak_rss_kb";
+    if (!opts.baseline.empty()) csv << ",baseline_ms,change_pct,status";
+    csv << '\n';
+    csv << std::fixed;
+
+    int regressions = 0;
+    int failures = 0;
+    for (const Case &c : make_cases(opts)) {
+        if (!opts.only.empty() && std::find(opts.only.begin(), opts.only.end(), c.name) == opts.only.end()) {
+            continue;
+        }
+        fs::path input = workdir / (c.name + ".lctest");
+        {
+            std::ofstream out(input, std::ios::binary);
+            c.generate(out);
+        }
+        Result r;
+        if (!measure(opts, c.name, input, r)) {
+            failures++;
+            continue;
+        }
+        auto mb_per_s = [&](uint64_t bytes) {
+            return r.mean_ms > 0 ? bytes / (r.mean_ms / 1000.0) / (1024.0 * 1024.0) : 0.0;
+        };
+        csv << r.name << ',' << r.input_bytes << ',' << r.output_bytes << ',' << r.runs << ','
+            << std::setprecision(3) << r.mean_ms << ',' << r.stddev_ms << ',' << r.min_ms << ','
+            << std::setprecision(2) << mb_per_s(r.input_bytes) << ',' << mb_per_s(r.output_bytes) << ','
+            << r.peak_rss_kb;
+        if (!opts.baseline.empty()) {
+            auto it = baseline.find(r.name);
+            if (it == baseline.end()) {
+                csv << ",,,new";
+            } else {
+                const Baseline &b = it->second;
+                double change = b.mean_ms > 0 ? (r.mean_ms - b.mean_ms) / b.mean_ms * 100.0 : 0;
+                double noise = 3 * std::max(r.stddev_ms, b.stddev_ms);
+                const char *status = "ok";
+                if (change > opts.threshold && r.mean_ms - b.mean_ms > noise) {
+                    status = "REGRESSION";
+                    regressions++;
+                } else if (change < -opts.threshold && b.mean_ms - r.mean_ms > noise) {
+                    status = "faster";
+                }
+                csv << ',' << std::setprecision(3) << b.mean_ms << ',' << std::setprecision(1) << change
+                    << ',' << status;
+            }
+        }
+        csv << '\n';
+    }
+
+    std::cout << csv.str();
+    if (!opts.save.empty()) {
+        std::ofstream out(opts.save);
+        out << csv.str();
+        if (!out) {
+            std::cerr << "lcbench: cannot write " << opts.save << "\n";
+            failures++;
+        }
+    }
+    if (!opts.keep) {
+        std::error_code ec;
+        fs::remove_all(workdir, ec);
+    } else {
+        std::cerr << "lcbench: workloads kept in " << workdir.string() << "\n";
+    }
+    if (regressions > 0) {
+        std::cerr << "lcbench: " << regressions << " case(s) regressed against " << opts.baseline << "\n";
+    }
+    return failures > 0 || regressions > 0 ? 1 : 0;
+}
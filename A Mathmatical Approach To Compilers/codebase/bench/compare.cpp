@@ -0,0 +1,405 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: comparative compile benchmark: runs the findings programs through the
+*                 LC compiler and each installed toolchain and tabulates time and memory
+***************************************************************************************/
+
+// Usage: lccompare [options]
+//
+// Replaces the hand-run simple.sh/complex.sh scripts behind findings.ods.
+// Each recipe (see bench/toolchains.recipes) names a toolchain, a program,
+// its sources and the commands that compile it. Following the notes, every
+// recipe runs --runs times (default 3) after --warmup unmeasured runs,
+// each in a fresh directory, and the table reports the mean. A run's time
+// is the wall time of all its steps and its memory the largest peak RSS
+// any step reached, both taken from wait4().
+//
+// A recipe whose commands are not installed is reported as skipped rather
+// than failing the run; a recipe whose commands fail makes the exit
+// status 1.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::string compiler = "./main";
+    std::string findings = "../findngs-src";
+    std::string recipes = "bench/toolchains.recipes";
+    std::vector<std::string> toolchains;   // --toolchain; empty runs every one
+    std::vector<std::string> programs;     // --program
+    std::string format = "csv";
+    int runs = 3;
+    int warmup = 1;
+};
+
+struct Source {
+    std::string name;
+    std::string text;
+};
+
+struct Recipe {
+    std::string toolchain;
+    std::string program;
+    int line = 0;
+    std::vector<Source> sources;
+    std::vector<std::vector<std::string>> steps;
+    std::string output;
+    std::string error;          // a source that could not be read
+};
+
+struct Result {
+    std::string status = "ok";  // ok, skipped or failed
+    std::string reason;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+    int runs = 0;
+    double mean_ms = 0;
+    double stddev_ms = 0;
+    double min_ms = 0;
+    double mean_rss_kb = 0;
+    long peak_rss_kb = 0;
+};
+
+static std::vector<std::string> split_words(const std::string &line) {
+    std::vector<std::string> words;
+    std::istringstream in(line);
+    std::string word;
+    while (in >> word) words.push_back(word);
+    return words;
+}
+
+// The files a findings script writes with `cat > NAME << 'EOF'`.
+static bool read_heredocs(const fs::path &script, std::vector<Source> &out) {
+    std::ifstream in(script);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> w = split_words(line);
+        if (w.size() != 5 || w[0] != "cat" || w[1] != ">" || w[3] != "<<") continue;
+        std::string end = w[4];
+        if (end.size() >= 2 && (end.front() == '\'' || end.front() == '"')) end = end.substr(1, end.size() - 2);
+        Source s{w[2], ""};
+        while (std::getline(in, line) && line != end) s.text += line + '\n';
+        out.push_back(std::move(s));
+    }
+    return true;
+}
+
+static bool load_recipes(const Options &opts, std::vector<Recipe> &out) {
+    std::ifstream in(opts.recipes);
+    if (!in) {
+        std::cerr << "lccompare: cannot read recipes " << opts.recipes << "\n";
+        return false;
+    }
+    fs::path findings = opts.findings;
+    std::string line;
+    int number = 0;
+    while (std::getline(in, line)) {
+        number++;
+        std::vector<std::string> w = split_words(line.substr(0, line.find('#')));
+        if (w.empty()) continue;
+        auto bad = [&](const char *why) {
+            std::cerr << "lccompare: " << opts.recipes << ":" << number << ": " << why << "\n";
+            return false;
+        };
+        if (w[0] == "recipe") {
+            if (w.size() != 3) return bad("expected: recipe TOOLCHAIN PROGRAM");
+            Recipe r;
+            r.toolchain = w[1];
+            r.program = w[2];
+            r.line = number;
+            out.push_back(std::move(r));
+            continue;
+        }
+        if (out.empty()) return bad("expected a recipe line first");
+        Recipe &r = out.back();
+        if (w[0] == "script" && w.size() == 2) {
+            if (!read_heredocs(findings / w[1], r.sources)) r.error = "cannot read " + w[1];
+        } else if (w[0] == "source" && (w.size() == 2 || w.size() == 3)) {
+            std::ifstream src(findings / w[1], std::ios::binary);
+            std::ostringstream text;
+            text << src.rdbuf();
+            if (!src) r.error = "cannot read " + w[1];
+            r.sources.push_back({w.size() == 3 ? w[2] : fs::path(w[1]).filename().string(), text.str()});
+        } else if (w[0] == "step" && w.size() >= 2) {
+            r.steps.emplace_back(w.begin() + 1, w.end());
+        } else if (w[0] == "output" && w.size() == 2) {
+            r.output = w[1];
+        } else {
+            return bad("unknown recipe line");
+        }
+    }
+    for (const Recipe &r : out) {
+        if (r.steps.empty()) {
+            std::cerr << "lccompare: " << opts.recipes << ":" << r.line << ": recipe has no steps\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Where execvp would find a command, or "" when it is not installed.
+static std::string find_command(const std::string &command) {
+    if (command.find('/') != std::string::npos) {
+        return access(command.c_str(), X_OK) == 0 ? command : "";
+    }
+    const char *path = std::getenv("PATH");
+    std::istringstream dirs(path ? path : "/usr/bin:/bin");
+    std::string dir;
+    while (std::getline(dirs, dir, ':')) {
+        std::string candidate = (dir.empty() ? "." : dir) + "/" + command;
+        if (access(candidate.c_str(), X_OK) == 0) return candidate;
+    }
+    return "";
+}
+
+// Runs one step in dir with its output in dir/.log; false if it could not
+// run or failed.
+static bool run_step(const std::vector<std::string> &step, const fs::path &dir, long &rss_kb) {
+    std::vector<std::string> args = step;
+    std::vector<char *> argv;
+    for (std::string &a : args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        if (chdir(dir.c_str()) != 0) _exit(127);
+        int log = open(".log", O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (log >= 0) {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+        }
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) return false;
+    rss_kb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void measure(const Options &opts, const Recipe &recipe, const fs::path &workdir, Result &r) {
+    if (!recipe.error.empty()) {
+        r.status = "failed";
+        r.reason = recipe.error;
+        return;
+    }
+    std::string compiler = fs::absolute(opts.compiler).string();
+    std::vector<std::vector<std::string>> steps = recipe.steps;
+    for (std::vector<std::string> &step : steps) {
+        for (std::string &a : step) {
+            if (a == "$LC") a = compiler;
+        }
+        std::string found = find_command(step[0]);
+        if (found.empty()) {
+            r.status = "skipped";
+            r.reason = step[0] + " not installed";
+            return;
+        }
+    }
+    for (const Source &s : recipe.sources) r.input_bytes += s.text.size();
+
+    std::vector<double> times;
+    std::vector<long> rss;
+    fs::path dir = workdir / (recipe.toolchain + "-" + recipe.program);
+    for (int i = 0; i < opts.warmup + opts.runs; i++) {
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+        fs::create_directories(dir);
+        for (const Source &s : recipe.sources) {
+            std::ofstream out(dir / s.name, std::ios::binary);
+            out << s.text;
+        }
+        long run_rss = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::vector<std::string> &step : steps) {
+            long step_rss = 0;
+            if (!run_step(step, dir, step_rss)) {
+                r.status = "failed";
+                r.reason = step[0] + " failed";
+                std::ifstream log(dir / ".log");
+                std::cerr << "lccompare: " << recipe.toolchain << " " << recipe.program << ": " << r.reason
+                          << "\n" << log.rdbuf();
+                return;
+            }
+            run_rss = std::max(run_rss, step_rss);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i < opts.warmup) continue;
+        times.push_back(ms);
+        rss.push_back(run_rss);
+        if (!recipe.output.empty()) r.output_bytes = fs::file_size(dir / recipe.output, ec);
+        if (ec) r.output_bytes = 0;
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+
+    r.runs = static_cast<int>(times.size());
+    double sum = 0;
+    for (double t : times) sum += t;
+    r.mean_ms = sum / r.runs;
+    double sq = 0;
+    for (double t : times) sq += (t - r.mean_ms) * (t - r.mean_ms);
+    r.stddev_ms = r.runs > 1 ? std::sqrt(sq / (r.runs - 1)) : 0.0;
+    r.min_ms = *std::min_element(times.begin(), times.end());
+    double rss_sum = 0;
+    for (long k : rss) rss_sum += static_cast<double>(k);
+    r.mean_rss_kb = rss_sum / r.runs;
+    r.peak_rss_kb = *std::max_element(rss.begin(), rss.end());
+}
+
+static std::string json_string(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\u%04x", u);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static void print_usage() {
+    std::cout << "Usage: lccompare [options]\n\n"
+              << "  --compiler PATH   LC compiler, $LC in recipes (default ./main)\n"
+              << "  --findings DIR    Directory recipe paths are relative to (default ../findngs-src)\n"
+              << "  --recipes FILE    Toolchain recipes (default bench/toolchains.recipes)\n"
+              << "  --toolchain NAME  Run only this toolchain; may be repeated\n"
+              << "  --program NAME    Run only this program (simple, complex); may be repeated\n"
+              << "  --runs N          Measured runs per recipe (default 3)\n"
+              << "  --warmup N        Unmeasured runs first (default 1)\n"
+              << "  --format FMT      csv or json (default csv)\n";
+}
+
+int main(int argc, char *argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                std::cerr << "lccompare: " << arg << " needs a value\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--compiler") {
+            opts.compiler = value();
+        } else if (arg == "--findings") {
+            opts.findings = value();
+        } else if (arg == "--recipes") {
+            opts.recipes = value();
+        } else if (arg == "--toolchain") {
+            opts.toolchains.push_back(value());
+        } else if (arg == "--program") {
+            opts.programs.push_back(value());
+        } else if (arg == "--runs") {
+            opts.runs = std::max(1, std::atoi(value()));
+        } else if (arg == "--warmup") {
+            opts.warmup = std::max(0, std::atoi(value()));
+        } else if (arg == "--format") {
+            opts.format = value();
+        } else if (arg == "--help") {
+            print_usage();
+            return 0;
+        } else {
+            std::cerr << "lccompare: unknown option " << arg << "\n";
+            return 2;
+        }
+    }
+    if (opts.format != "csv" && opts.format != "json") {
+        std::cerr << "lccompare: --format must be csv or json\n";
+        return 2;
+    }
+    std::vector<Recipe> recipes;
+    if (!load_recipes(opts, recipes)) return 2;
+
+    char dir_template[] = "/tmp/lccompare.XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::cerr << "lccompare: cannot create a work directory\n";
+        return 2;
+    }
+    fs::path workdir = dir_template;
+
+    auto selected = [](const std::vector<std::string> &only, const std::string &name) {
+        return only.empty() || std::find(only.begin(), only.end(), name) != only.end();
+    };
+    std::ostringstream table;
+    table << std::fixed;
+    bool json = opts.format == "json";
+    if (json) {
+        table << "[";
+    } else {
+        table << "toolchain,program,status,input_bytes,output_bytes,runs,mean_ms,stddev_ms,min_ms,"
+                 "mean_rss_kb,peak_rss_kb,reason\n";
+    }
+    int failures = 0;
+    size_t rows = 0;
+    for (const Recipe &recipe : recipes) {
+        if (!selected(opts.toolchains, recipe.toolchain) || !selected(opts.programs, recipe.program)) continue;
+        Result r;
+        measure(opts, recipe, workdir, r);
+        if (r.status == "failed") failures++;
+        if (r.status == "skipped") {
+            std::cerr << "lccompare: skipping " << recipe.toolchain << " " << recipe.program << ": " << r.reason
+                      << "\n";
+        }
+        if (json) {
+            table << (rows ? ",\n" : "\n") << "  {\"toolchain\": " << json_string(recipe.toolchain)
+                  << ", \"program\": " << json_string(recipe.program) << ", \"status\": \"" << r.status << "\"";
+            if (r.status == "ok") {
+                table << ", \"input_bytes\": " << r.input_bytes << ", \"output_bytes\": " << r.output_bytes
+                      << ", \"runs\": " << r.runs << std::setprecision(3) << ", \"mean_ms\": " << r.mean_ms
+                      << ", \"stddev_ms\": " << r.stddev_ms << ", \"min_ms\": " << r.min_ms
+                      << std::setprecision(1) << ", \"mean_rss_kb\": " << r.mean_rss_kb
+                      << ", \"peak_rss_kb\": " << r.peak_rss_kb;
+            } else {
+                table << ", \"reason\": " << json_string(r.reason);
+            }
+            table << "}";
+        } else {
+            table << recipe.toolchain << ',' << recipe.program << ',' << r.status << ',';
+            if (r.status == "ok") {
+                table << r.input_bytes << ',' << r.output_bytes << ',' << r.runs << ',' << std::setprecision(3)
+                      << r.mean_ms << ',' << r.stddev_ms << ',' << r.min_ms << ',' << std::setprecision(1)
+                      << r.mean_rss_kb << ',' << r.peak_rss_kb << ",\n";
+            } else {
+                table << ",,,,,,,," << r.reason << '\n';
+            }
+        }
+        rows++;
+    }
+    if (json) table << (rows ? "\n]\n" : "]\n");
+    std::cout << table.str();
+
+    std::error_code ec;
+    fs::remove_all(workdir, ec);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Interned atom text. Every distinct atom is copied once into a chunked
+// character pool and referred to by a 32-bit id from then on.
+class SymbolTable {
+public:
+    uint32_t intern(std::string_view text);
+    std::string_view name(uint32_t id) const { return names[id]; }
+    bool contains(std::string_view text) const { return !slots.empty() && slots[find(text, hash(text))] != 0; }
+    size_t size() const { return names.size(); }
+    size_t bytes() const { return pool_bytes; }
+    void clear();
+
+private:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> chunks;
+    std::vector<std::unique_ptr<char[]>> large;
+    size_t chunk_used = CHUNK_SIZE;
+    size_t pool_bytes = 0;
+    std::vector<std::string_view> names;
+    // Open addressing with linear probing, at most half full. A slot is 0
+    // when empty, else the text's hash in the high half and its id + 1 in
+    // the low half, so a probe only reads the text back on a hash match.
+    std::vector<uint64_t> slots;
+
+    static uint64_t hash(std::string_view text) { return std::hash<std::string_view>{}(text); }
+    // The slot holding text, or the empty slot where it would go.
+    size_t find(std::string_view text, uint64_t h) const;
+    void rehash(size_t slot_count);
+};
+
+// Arena node. Atoms hold a symbol id; lists hold the index range
+// [first, first + count) of their children, which always sit next to
+// each other in the arena.
+struct AstNode {
+    bool is_atom;
+    uint32_t first; // symbol id for atoms, index of first child for lists
+    uint32_t count; // number of children (0 for atoms)
+};
+
+// Contiguous AST storage: one vector of nodes plus the symbol table.
+// Nothing is owned per node, so clear() releases a whole program at once.
+class AstArena {
+public:
+    using Id = uint32_t;
+
+    const AstNode &operator[](Id id) const { return nodes[id]; }
+    std::string_view atom(Id id) const { return symbols.name(nodes[id].first); }
+    Id child(Id id, uint32_t i) const { return nodes[id].first + i; }
+
+    // Build helpers used by the parser: an atom value, and a list whose
+    // children are copied out of a scratch buffer into one contiguous block.
+    AstNode make_atom(std::string_view text) { return {true, symbols.intern(text), 0}; }
+    AstNode make_list(const AstNode *children, uint32_t count);
+    Id push(const AstNode &node);
+
+    // In-place rewrites for passes over a parsed program. A replaced node's
+    // old children stay in the arena, just unreferenced; erase_child shifts
+    // the later siblings down so the child range stays contiguous.
+    void replace(Id id, const AstNode &node) { nodes[id] = node; }
+    void erase_child(Id id, uint32_t i);
+
+    Id root() const { return root_id; }
+    void set_root(Id id) { root_id = id; }
+
+    size_t node_count() const { return nodes.size(); }
+    size_t symbol_count() const { return symbols.size(); }
+    size_t bytes() const { return nodes.capacity() * sizeof(AstNode) + symbols.bytes(); }
+    void clear();
+
+private:
+    std::vector<AstNode> nodes;
+    SymbolTable symbols;
+    Id root_id = 0;
+};
+
+#endif
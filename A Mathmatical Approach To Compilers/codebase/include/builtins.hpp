@@ -0,0 +1,47 @@
+#ifndef BUILTINS_HPP
+#define BUILTINS_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Church-encoded combinators the translator lowers builtins to. The
+// enumerators keep the names of the old per-operator string constants.
+enum class Builtin : uint8_t {
+    LADD, LMUL, LSUB, LDIV,
+    LTRUE, LFALSE, LAND, LOR, LNOT,
+    LEQ, LLT, LGT, LGEQ,
+    LSUCC, LPRED, LISZERO,
+    Y_COMBINATOR,
+    LPAIR, LFIRST, LSECOND,
+    LNIL, LCONS, LHEAD, LTAIL, LISNIL,
+    LEQUAL,     // appended so .lcb Const indices stay stable
+    COUNT
+};
+
+constexpr size_t BUILTIN_COUNT = static_cast<size_t>(Builtin::COUNT);
+
+// λ-calculus text of a builtin, exactly as it appears in the .lc output.
+std::string_view builtin_text(Builtin b);
+
+// Name a builtin is defined under in a prelude ("ADD", "PRED", ...). The
+// texts refer to each other by these names, so a prelude has to define
+// every dependency of what it uses.
+std::string_view builtin_name(Builtin b);
+bool builtin_from_name(std::string_view name, Builtin &b);
+
+// Sets of builtins as bit masks, bit i standing for Builtin(i).
+using BuiltinSet = uint32_t;
+static_assert(BUILTIN_COUNT <= 32, "BuiltinSet has one bit per builtin");
+
+constexpr BuiltinSet builtin_bit(Builtin b) { return BuiltinSet(1) << static_cast<unsigned>(b); }
+
+// Builtins whose names appear free in b's text.
+BuiltinSet builtin_deps(Builtin b);
+
+// Appends the builtins of set, together with everything they depend on
+// and nothing in done, to order so that each one comes after its
+// dependencies. Returns done plus everything appended.
+BuiltinSet builtin_closure(BuiltinSet set, BuiltinSet done, std::vector<Builtin> &order);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CBACKEND_HPP
+#define CBACKEND_HPP
+
+#include "lc_reader.hpp"
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// Native backend: lowers a program to one self-contained C file that
+// runs it the way --eval does and prints the same "line N: value" lines.
+//
+// Every λ and every argument that needs suspending is closure-converted
+// into a top-level C function taking its free variables from a flat
+// environment record; those without free variables are lifted to static
+// closures and static, memoised thunks, so they are never allocated.
+// A function body does no evaluation of its own: it allocates what it
+// suspends, pushes its arguments and names the head to enter next, and a
+// push/enter loop in the runtime drives everything with call-by-need
+// updates. Nothing recurses on the C stack, so deep programs only cost
+// heap. The heap is a bump-allocated semispace collected by copying
+// (Cheney), growing up to 1 GB.
+//
+// With NativeNumerals::Machine, numerals are machine integers and the
+// arithmetic and comparison builtins (recognised by name or by their
+// inlined text) are native operations. A builtin forces its arguments
+// and falls back to its Church encoding when one is not a machine
+// integer, so results never differ from the encodings except that a
+// builtin's arguments are evaluated even if the encoding would have
+// ignored them.
+enum class NativeNumerals { Machine, Church };
+
+struct NativeStats {
+    size_t functions = 0;      // lifted λs and suspended arguments
+    size_t statics = 0;        // closed ones, allocated statically
+    size_t primitives = 0;     // builtins lowered to native operations
+};
+
+// Writes the program as C. Expressions are labelled "label N" from their
+// line numbers. Adds the builtin texts (and Church-expanded numerals) to
+// program.terms.
+NativeStats write_c_program(LcProgram &program, const char *label, NativeNumerals numerals,
+                            std::ostream &out);
+
+// Compiles c_path into exe_path with $CC (default cc) -O2. On failure
+// returns false with the reason in error.
+bool build_native(const std::string &c_path, const std::string &exe_path, std::string &error);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef COMBINATORS_HPP
+#define COMBINATORS_HPP
+
+#include "evaluator.hpp"
+#include "lc_reader.hpp"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Combinator backend: the λ-term IR compiled to S, K, I, B, C and Turner's
+// S', B*, C' by bracket abstraction, and a graph reducer for the result.
+//
+// Abstraction works innermost λ first, so the variable being abstracted is
+// always the deepest one still free and "does x occur in E" is a compare of
+// E's deepest free variable. Turner's rules keep the output near linear:
+//
+//   S (K p) (K q) = K (p q)    S (K p) I = p       S (K p) (B q r) = B* p q r
+//   S (K p) q     = B p q      S (B p q) (K r) = C' p q r
+//   S p (K q)     = C p q      S (B p q) r     = S' p q r
+//
+// Combinator terms are hash-consed, so equal subterms (every use of a
+// builtin, a numeral, a shared argument) are one node. Numerals stay single
+// nodes, n f x = f ((n-1) f x), instead of being spelled out.
+//
+// There are no variables left to capture, so the reducer rewrites that
+// graph in place: each redex is overwritten with its result and every
+// other use of the node sees it already reduced. Results are read back
+// with the same markers and the same text as Evaluator::evaluate. Nodes
+// come from a bump arena released with the program; EvalOptions caps its
+// size and the number of rewrites per expression.
+struct SkiStats {
+    size_t nodes = 0;           // distinct combinator terms
+    size_t shared = 0;          // terms written once and named in the .ski text
+    uint64_t rewrites = 0;
+    uint64_t rule_counts[9] = {};   // S K I B C S' B* C' and numeral unfoldings
+    uint64_t heap_bytes = 0;
+};
+
+class SkiProgram {
+public:
+    explicit SkiProgram(EvalOptions opts = {});
+    ~SkiProgram();
+    SkiProgram(const SkiProgram &) = delete;
+    SkiProgram &operator=(const SkiProgram &) = delete;
+
+    // Compiles the program's definitions and expressions. Free names that
+    // are builtins get their text compiled as definitions too.
+    void compile(const LcProgram &program);
+
+    // Writes the .ski text: "NAME := term" for the definitions and for
+    // every large term used more than once, then one line per expression.
+    // Application is juxtaposition, numerals are digits.
+    void write(std::ostream &out);
+
+    size_t expressions() const;
+    // Reduces expression i and reads it back as text, as Evaluator does.
+    // Throws EvalError when the expression itself cannot be reduced.
+    std::string evaluate(size_t i);
+
+    const SkiStats &stats() const;
+    static const char *rule_name(size_t rule);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef EMITTER_HPP
+#define EMITTER_HPP
+
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Output sink for the λ-calculus IR. Translation appends to one growable
+// buffer, so every output byte is written exactly once. When bound to a
+// stream the buffer is flushed whenever it passes flush_at bytes, which
+// keeps memory flat no matter how much IR is produced.
+class Emitter {
+public:
+    Emitter() = default;
+    explicit Emitter(std::ostream &stream, size_t flush_at = 1 << 16)
+        : os(&stream), threshold(flush_at) {}
+    ~Emitter() { flush(); }
+    Emitter(const Emitter &) = delete;
+    Emitter &operator=(const Emitter &) = delete;
+
+    Emitter &operator<<(std::string_view s) {
+        buf.append(s.data(), s.size());
+        if (os && buf.size() >= threshold) flush();
+        return *this;
+    }
+    Emitter &operator<<(char c) {
+        buf.push_back(c);
+        if (os && buf.size() >= threshold) flush();
+        return *this;
+    }
+
+    void flush() {
+        if (os && !buf.empty()) {
+            os->write(buf.data(), static_cast<std::streamsize>(buf.size()));
+            flushed += buf.size();
+            buf.clear();
+        }
+    }
+
+    // Total bytes emitted so far, including anything already flushed.
+    size_t size() const { return flushed + buf.size(); }
+    // Unflushed contents; the whole output when no stream is bound.
+    const std::string &str() const { return buf; }
+    std::string take() { std::string out; out.swap(buf); flushed += out.size(); return out; }
+
+private:
+    std::ostream *os = nullptr;
+    size_t threshold = 0;
+    size_t flushed = 0;
+    std::string buf;
+};
+
+#endif
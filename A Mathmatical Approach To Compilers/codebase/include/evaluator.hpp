@@ -0,0 +1,73 @@
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include "lambda.hpp"
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Call-by-need evaluator for the λ-term IR.
+//
+// Terms are compiled to de Bruijn-indexed code and run on a lazy
+// environment machine: every argument becomes a heap thunk that is
+// evaluated at most once and then overwritten with its value, so a
+// subterm shared by several uses is reduced a single time. All heap
+// objects live in one bump arena owned by the evaluator and are released
+// together when it is destroyed; nothing is collected before that, so the
+// arena is capped at max_heap_bytes.
+//
+// Free names are looked up in the definitions given to define() and then
+// in the builtin table (ADD, PRED, ISZERO, ...), which is what lets
+// inlined builtin text such as (λm.λn. n PRED m) run without a prelude.
+//
+// Results are read back by applying them to native markers: a numeral n
+// applied to a native successor and zero gives n, a boolean to two
+// markers gives one of them, and a pair to a native constructor gives its
+// components. λt.λf.f is both 0 and false and reads back as "0/false".
+struct EvalOptions {
+    uint64_t max_steps = 10000000;        // β-reductions per evaluation
+    uint64_t max_heap_bytes = 1ull << 30;  // whole arena, across evaluations
+};
+
+struct EvalStats {
+    uint64_t steps = 0;        // β-reductions
+    uint64_t updates = 0;      // thunks overwritten with their value
+    uint64_t thunks = 0;
+    uint64_t values = 0;
+    uint64_t env_cells = 0;
+    uint64_t heap_bytes = 0;
+};
+
+// Evaluation got stuck (a non-function applied), ran out of steps or
+// heap, or forced a thunk that depends on itself.
+class EvalError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+class Evaluator {
+public:
+    explicit Evaluator(EvalOptions opts = {});
+    ~Evaluator();
+    Evaluator(const Evaluator &) = delete;
+    Evaluator &operator=(const Evaluator &) = delete;
+
+    // Binds a global name; later definitions of the same name win.
+    void define(std::string_view name, const TermTable &terms, TermId root);
+
+    // Reduces root to weak head normal form and reads it back as text:
+    // "6", "true", "0/false", "(1 2 3)", "(2 . 770)", "<function>" or
+    // "<free name>". Throws EvalError when the term itself cannot be
+    // reduced; a readback that fails just falls through to the next guess.
+    std::string evaluate(const TermTable &terms, TermId root);
+
+    const EvalStats &stats() const;
+
+private:
+    struct Machine;
+    std::unique_ptr<Machine> m;
+};
+
+#endif
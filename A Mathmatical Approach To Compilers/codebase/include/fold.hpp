@@ -0,0 +1,34 @@
+#ifndef FOLD_HPP
+#define FOLD_HPP
+
+#include "parser.hpp"
+#include <memory>
+
+// Constant folding on the parsed program, run before translation with
+// --fold. Works bottom-up and rewrites the tree in place:
+//
+//   (+ 2 3)              -> 5          +, *, - (truncating, like SUB)
+//   (< 3 5)              -> true       =, <, >, <=, >=
+//   (and false x)        -> false      and, or, not on literal booleans
+//   (succ 4)             -> 5          succ, pred, zero?
+//   (if true a b)        -> a
+//   (let ((x 5)) (+ x 1)) -> 6         constant bindings are substituted
+//                                      (respecting shadowing) and dropped
+//
+// Only what the Church encodings compute identically is folded: / is left
+// alone because LDIV is not integer division, results that overflow 64
+// bits are left alone, and in unary numeral mode a product is only folded
+// while its numeral stays small, since a unary numeral costs bytes in
+// proportion to its value. Malformed forms are left for the translator to
+// report.
+//
+// Both overloads take a parse() result, i.e. the list of top-level forms,
+// and return the number of nodes folded away.
+size_t fold_constants(const std::shared_ptr<SExpr> &program);
+size_t fold_constants(AstArena &arena, AstArena::Id program);
+
+// Running total over every call, for --stats.
+size_t folded_nodes();
+void reset_fold_stats();
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef FORM_CACHE_HPP
+#define FORM_CACHE_HPP
+
+#include "builtins.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// On-disk cache of translated forms for --cache DIR. The key of a form is
+// its canonical text (atoms joined by single spaces, so layout and comments
+// do not matter) together with every option that changes its IR; see
+// form_cache_key in translator.cpp. Each entry is one file named after a
+// 64-bit hash of the key:
+//
+//   "LCFC" u32 version | u32 builtins | u64 key length | u64 IR length
+//   | u64 checksum | key | IR
+//
+// The full key is stored and compared on lookup, so a hash collision is a
+// miss, never wrong output. builtins is the form's prelude BuiltinSet.
+//
+// Entries are written to a temporary file and renamed into place, so
+// readers in other threads or processes see either the old entry or the
+// new one. A torn or foreign file fails the header, length or checksum
+// test and counts as a miss. A hit refreshes the entry's mtime, and trim()
+// deletes least recently used entries once the directory passes its byte
+// limit. Only files with an entry's name and magic count towards it or are
+// ever deleted, so other files in DIR are left alone.
+struct FormCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t stored = 0;
+    size_t evicted = 0;
+    uint64_t bytes = 0;     // directory size after the last trim
+    uint64_t limit = 0;
+};
+
+// 64-bit FNV-1a, used for entry names, checksums and key fingerprints.
+uint64_t form_cache_hash(std::string_view s);
+
+class FormCache {
+public:
+    // Creates dir if needed; throws std::runtime_error if that fails.
+    FormCache(std::string dir, uint64_t max_bytes);
+
+    // All three are safe to call from several threads at once.
+    bool lookup(std::string_view key, std::string &ir, BuiltinSet &builtins);
+    void store(std::string_view key, std::string_view ir, BuiltinSet builtins);
+    // Evicts oldest entries down to 3/4 of the limit when it is exceeded.
+    // Holds an flock on the directory so only one process trims at a time.
+    void trim();
+
+    FormCacheStats stats() const;
+
+private:
+    std::string dir;
+    uint64_t limit;
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+    std::atomic<size_t> stored{0};
+    std::atomic<size_t> evicted{0};
+    std::atomic<uint64_t> bytes{0};
+
+    std::string path_for(std::string_view key) const;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef FORM_READER_HPP
+#define FORM_READER_HPP
+
+#include <istream>
+#include <string>
+#include <string_view>
+
+// Splits an input stream into top-level forms without reading it whole.
+// Input is pulled in fixed-size chunks and only the unconsumed tail plus
+// the form currently being scanned is kept, so memory is bounded by the
+// largest single form rather than by the file size.
+class FormReader {
+public:
+    explicit FormReader(std::istream &input, size_t chunk_size = 1 << 16);
+
+    // Fetches the next form's source text. The view stays valid until the
+    // following call. Returns false once only whitespace is left.
+    bool next(std::string_view &form);
+
+    // Position of the form last returned by next(), for error messages.
+    int line() const { return form_line; }
+    int col() const { return form_col; }
+
+    size_t bytes_read() const { return total; }
+    size_t largest_form() const { return largest; }
+    size_t buffer_peak() const { return peak; }
+
+private:
+    std::istream &in;
+    size_t chunk;
+    std::string buf;
+    size_t pos = 0;
+    bool eof = false;
+    size_t total = 0;
+    size_t largest = 0;
+    size_t peak = 0;
+    int cur_line = 1, cur_col = 1;
+    int form_line = 1, form_col = 1;
+
+    bool fill();
+    void track(size_t from, size_t to);
+};
+
+#endif
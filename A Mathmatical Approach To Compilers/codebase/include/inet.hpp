@@ -0,0 +1,82 @@
+#ifndef INET_HPP
+#define INET_HPP
+
+#include "evaluator.hpp"
+#include "lc_reader.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Parallel interaction-net reducer for the λ-term IR.
+//
+// Each expression, with every definition and builtin it uses, becomes an
+// interaction net in Lamping's abstract algorithm: λ and application are
+// one binary agent, every variable used more than once is shared through
+// a tree of fans carrying that binder's label, and unused ones end in an
+// eraser. Definitions and builtins are built once per expression and
+// shared the same way, so a numeral or Y_COMBINATOR used many times is one
+// subnet. Fans only ever copy what is actually reached, which gives the
+// optimal sharing ordinary reduction lacks: work done inside a λ is done
+// once for all of its copies.
+//
+// The net is reduced to normal form by all threads at once. Every
+// interaction rewrites just its own two agents, so the only shared state
+// is the wiring between them: a wire whose ends are rewritten by two
+// threads at once is joined through an atomic exchange on a variable cell,
+// so no locks are taken. Each thread keeps its active pairs on a
+// Chase-Lev deque and steals from the others when it runs dry.
+//
+// Y_COMBINATOR (recognised by shape, whatever its names) becomes a
+// fixpoint agent instead of its self-application, which no net reduces
+// to normal form: the recursive call inside every copy of the body would
+// be unfolded again at once. An applied fixpoint is parked; once the
+// threads run dry, the parked ones the root's normal form reaches are
+// unfolded once each and the next round starts, so recursion goes only
+// as deep as the data it is given.
+//
+// The normal form is read back into a λ-term (fans pair up by label) and
+// printed by Evaluator, so results read exactly as --eval's do. Without
+// Lamping's bracket oracle, fans can still cross in terms that copy a λ
+// which copies its own variable; reading that back fails with an
+// EvalError rather than printing a wrong value. Terms with no normal form
+// (a recursive function returned unapplied, Ω) run until the interaction
+// budget, max_steps, is spent. Agents live in one region capped at
+// max_heap_bytes.
+struct InetStats {
+    uint64_t interactions = 0;
+    uint64_t annihilations = 0;  // λ meets application (β) or two fans of one label
+    uint64_t commutations = 0;   // fans copying agents, including each other
+    uint64_t erasures = 0;
+    uint64_t unfolds = 0;        // fixpoints applied, each once its result is needed
+    uint64_t steals = 0;         // active pairs taken from another thread's deque
+    uint64_t agents = 0;         // in the nets as built
+    uint64_t heap_bytes = 0;     // largest net reached
+    double seconds = 0;          // spent reducing
+};
+
+class NetReducer {
+public:
+    // program must outlive the reducer.
+    NetReducer(const LcProgram &program, EvalOptions opts = {}, unsigned threads = 1);
+    ~NetReducer();
+    NetReducer(const NetReducer &) = delete;
+    NetReducer &operator=(const NetReducer &) = delete;
+
+    void set_threads(unsigned threads);
+    unsigned threads() const;
+
+    size_t expressions() const;
+    // Builds and reduces expression i and reads back its normal form as
+    // Evaluator::evaluate would print it. Throws EvalError when the net
+    // runs out of interactions or heap, or reads back inconsistently.
+    std::string evaluate(size_t i);
+
+    // Totals over every evaluate() so far.
+    const InetStats &stats() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef LAMBDA_HPP
+#define LAMBDA_HPP
+
+#include "arena.hpp"
+#include "builtins.hpp"
+#include "emitter.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// λ-term IR sitting between the S-expression AST and the .lc text.
+//
+//   Var    a = name symbol
+//   Lam    a = parameter symbol, b = body
+//   App    a = function,         b = argument
+//   Const  a = Builtin
+//   Num    a = value of a Church numeral
+//
+// Terms are hash-consed: building a node that already exists returns the
+// existing id, so structurally equal subterms are one node and the program
+// is a DAG. Children are always created before their parents, so ids are a
+// topological order (every child id is smaller than its parent's).
+using TermId = uint32_t;
+
+enum class TermKind : uint8_t { Var, Lam, App, Const, Num };
+
+struct Term {
+    TermKind kind;
+    uint32_t a;
+    uint32_t b;
+    bool operator==(const Term &o) const { return kind == o.kind && a == o.a && b == o.b; }
+};
+
+class TermTable {
+public:
+    TermId var(std::string_view name) { return make(TermKind::Var, symbols.intern(name), 0); }
+    TermId lam(std::string_view param, TermId body) { return make(TermKind::Lam, symbols.intern(param), body); }
+    TermId app(TermId f, TermId x) { return make(TermKind::App, f, x); }
+    TermId constant(Builtin b) { return make(TermKind::Const, static_cast<uint32_t>(b), 0); }
+    TermId num(uint32_t n) { return make(TermKind::Num, n, 0); }
+
+    const Term &operator[](TermId id) const { return nodes[id]; }
+    std::string_view name(uint32_t sym) const { return symbols.name(sym); }
+    bool has_symbol(std::string_view text) const { return symbols.contains(text); }
+
+    size_t size() const { return nodes.size(); }
+    // Drops every node but keeps the allocations for the next form.
+    void clear();
+
+private:
+    struct TermHash {
+        size_t operator()(const Term &t) const {
+            uint64_t h = (static_cast<uint64_t>(t.a) << 32) | t.b;
+            h ^= static_cast<uint64_t>(t.kind) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 29;
+            h *= 0xBF58476D1CE4E5B9ull;
+            return static_cast<size_t>(h ^ (h >> 32));
+        }
+    };
+
+    TermId make(TermKind kind, uint32_t a, uint32_t b);
+    void rehash(size_t slot_count);
+
+    std::vector<Term> nodes;
+    // Open addressing with linear probing: each slot is EMPTY or a node id,
+    // kept at most half full. A probe touches one flat array instead of a
+    // chain of heap nodes, which keeps lookups cheap once a form's table
+    // outgrows the caches.
+    static constexpr TermId EMPTY = UINT32_MAX;
+    std::vector<TermId> slots;
+    SymbolTable symbols;
+};
+
+struct NumeralCacheStats {
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+// Church numeral text for n, built once and shared by every thread. The
+// cache holds at most its byte budget (64 MiB by default); numerals not
+// used since the last eviction sweep are dropped and rebuilt on demand.
+std::shared_ptr<const std::string> church_numeral_text(uint32_t n);
+NumeralCacheStats numeral_cache_stats();
+void set_numeral_cache_limit(size_t bytes);
+void clear_numeral_cache();
+// Length in bytes of church_numeral_text(n), without building it.
+uint64_t church_numeral_length(uint32_t n);
+
+// Output bytes the printers spent on builtins and numerals, for --profile.
+// A hoisted (--cse) subterm counts once, as it is printed once.
+struct PrintProfile {
+    uint64_t builtin_uses[BUILTIN_COUNT] = {};
+    uint64_t builtin_bytes[BUILTIN_COUNT] = {};
+    struct Numeral {
+        uint64_t uses = 0;
+        uint64_t bytes = 0;
+    };
+    std::unordered_map<uint32_t, Numeral> numerals;
+};
+
+// Writes a term in .lc syntax. An abstraction in function position is
+// parenthesised, so ((λx.body) arg) reads back as the redex it is.
+// With builtin_names, builtins are printed as their prelude names (ADD,
+// PRED, ...) instead of their full text. A profile, when given, is added to.
+void print_term(const TermTable &terms, TermId root, Emitter &out, bool builtin_names = false,
+                PrintProfile *profile = nullptr);
+
+// Like print_term, but every subterm that would be printed more than once
+// (and is worth naming) is printed a single time and bound with a
+// let-style redex:  ((λ_cse0.(... _cse0 ... _cse0 ...)) shared).
+// Only subterms without variables bound inside the form are hoisted, so
+// the binding can sit at the top without capturing anything.
+// Returns the number of bindings introduced.
+size_t print_shared(const TermTable &terms, TermId root, Emitter &out, bool builtin_names = false,
+                    PrintProfile *profile = nullptr);
+
+#endif
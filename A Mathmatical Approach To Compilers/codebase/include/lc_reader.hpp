@@ -0,0 +1,40 @@
+#ifndef LC_READER_HPP
+#define LC_READER_HPP
+
+#include "lambda.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reads .lc text back into the λ-term IR. Each non-blank line is either a
+// prelude definition "NAME := term" or one top-level expression:
+//
+//   term  ::= 'λ' name '.' term | app
+//   app   ::= atom { atom } [ 'λ' name '.' term ]
+//   atom  ::= name | '(' term ')'
+//
+// An abstraction extends as far right as possible, which is how the
+// printer leaves a λ in argument position unparenthesised. A backslash is
+// accepted in place of λ.
+struct LcDefinition {
+    std::string name;
+    TermId term;
+    int line;
+};
+
+struct LcExpression {
+    TermId term;
+    int line;
+};
+
+struct LcProgram {
+    TermTable terms;
+    std::vector<LcDefinition> definitions;
+    std::vector<LcExpression> expressions;
+};
+
+// Appends everything in text to program. Throws std::runtime_error with
+// the line and column of the first syntax error.
+void read_lc(std::string_view text, LcProgram &program);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LCB_HPP
+#define LCB_HPP
+
+#include "emitter.hpp"
+#include "lambda.hpp"
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// .lcb: binary λ-term IR.
+//
+//   header   "LCB\0", u32 version
+//   records  one per top-level form, back to back
+//   index    u64 offset, u64 size per record
+//   trailer  u64 index offset, u64 record count  (last 16 bytes)
+//
+// Fixed-width fields are little-endian. A record is self-contained, so a
+// loader can map the file, read the trailer and decode any form without
+// touching the others:
+//
+//   varint name count, then (varint length, bytes) per free name
+//   varint node count, then the nodes
+//
+// Nodes are stored children first and the last one is the root. Each
+// starts with a varint (operand << 3 | tag):
+//
+//   0 Var    de Bruijn index
+//   1 Free   index into the record's names
+//   2 Lam    distance back to the body
+//   3 App    distance back to the function; a second varint gives the
+//            distance back to the argument
+//   4 Const  Builtin
+//   5 Num    value of a Church numeral
+//
+// Nodes are hash-consed on their de Bruijn form, so a subterm that occurs
+// several times in a form (including under different binder names) is
+// stored once. Binder names are not kept.
+void encode_lcb_form(const TermTable &terms, TermId root, std::string &record);
+
+// Writes the header up front and the index and trailer on finish(), so it
+// can stream records to a bound Emitter.
+class LcbWriter {
+public:
+    explicit LcbWriter(Emitter &out);
+    void add_form(std::string_view record);
+    void finish();
+    size_t forms() const { return index.size(); }
+
+private:
+    Emitter &out;
+    std::vector<std::pair<uint64_t, uint64_t>> index;
+};
+
+// Read side: maps the file and checks the header, trailer and index, which
+// is all that happens up front. Forms are decoded on demand.
+class LcbFile {
+public:
+    explicit LcbFile(const std::string &path);
+
+    size_t forms() const { return count; }
+    // Decodes form i into terms and returns its root. Binders get names
+    // derived from their depth that cannot clash with the form's free names.
+    TermId load_form(size_t i, TermTable &terms) const;
+
+private:
+    MappedFile file;
+    uint64_t index_offset = 0;
+    uint64_t count = 0;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only mmap of a whole file. The bytes are paged in by the kernel on
+// demand and never copied into the heap, so views into the mapping stay
+// valid for as long as the MappedFile lives.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return addr; }
+    size_t size() const { return length; }
+    std::string_view view() const { return {addr, length}; }
+
+private:
+    const char *addr = nullptr;
+    size_t length = 0;
+};
+
+#endif
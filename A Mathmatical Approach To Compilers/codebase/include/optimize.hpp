@@ -0,0 +1,49 @@
+#ifndef OPTIMIZE_HPP
+#define OPTIMIZE_HPP
+
+#include "lambda.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// β/η simplification of a translated form, run between translation and
+// emission with --optimize. Rewrites bottom-up, building the result in the
+// same TermTable (the input nodes are left in place, unreferenced):
+//
+//   ((λx.b) v), x not in b       -> b          dead let binding
+//   ((λx.b) v), x used once      -> b[x:=v]    inlined, unless that would
+//                                              move a non-value under a λ
+//   ((λx.b) v), v a value        -> b[x:=v]    only if the printed result is
+//                                              no longer than the redex
+//   λx.(f x), x not in f         -> f          f a variable, builtin or
+//                                              numeral
+//
+// Values are variables, abstractions, builtins and numerals, so no rule
+// copies a computation or moves one somewhere it could run more often.
+// Substitution renames a binder (x -> x_1, ...) when it would capture a
+// free variable of the substituted term.
+//
+// Every rewrite costs one unit of fuel; once the form's fuel is spent the
+// rest of it is left as translated. Fuel bounds compile time on forms that
+// keep exposing new redexes.
+struct OptimizeOptions {
+    size_t fuel = 10000;            // rewrites per form
+    bool builtin_names = false;     // size builtins by their prelude names
+};
+
+// Returns the root of the simplified form.
+TermId optimize_term(TermTable &terms, TermId root, const OptimizeOptions &opts);
+
+// Running totals over every call, for --stats.
+struct OptimizeStats {
+    size_t beta = 0;        // redexes reduced by substitution
+    size_t inlined = 0;     // of which the binding was used once
+    size_t dead = 0;        // bindings dropped unused
+    size_t eta = 0;
+    size_t out_of_fuel = 0; // forms that stopped on their fuel budget
+    uint64_t bytes_before = 0;
+    uint64_t bytes_after = 0;
+};
+OptimizeStats optimize_stats();
+void reset_optimize_stats();
+
+#endif
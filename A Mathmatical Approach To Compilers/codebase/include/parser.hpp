@@ -1,7 +1,10 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include "arena.hpp"
+#include "mapped_file.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
@@ -12,38 +15,55 @@ struct SExpr {
     std::vector<std::shared_ptr<SExpr>> list;
     SExpr(std::string a);
     SExpr(std::vector<std::shared_ptr<SExpr>> v);
+    ~SExpr();
+    SExpr(const SExpr &) = default;
+    SExpr(SExpr &&) = default;
+    SExpr &operator=(const SExpr &) = default;
+    SExpr &operator=(SExpr &&) = default;
 };
 
 class Parser {
 public:
     Parser(std::string in);
+    // Borrows the mapping: tokens are slices of it, so it must outlive the parser.
+    Parser(const MappedFile &file);
+    // Borrows a slice of a larger input whose first byte sits at line:col.
+    Parser(std::string_view in, int line, int col);
+    Parser(const Parser &) = delete;
+    Parser &operator=(const Parser &) = delete;
+    // Returns a list node holding every top-level form in the input.
     std::shared_ptr<SExpr> parse();
+    // Same, but builds into an arena; the returned id is also arena.root().
+    AstArena::Id parse(AstArena &arena);
 
 private:
+    // Tokens are views into the input; positions are plain byte offsets and
+    // only turned into line/col when an error message needs them.
     struct Token {
         enum Kind { LPAREN, RPAREN, NUMBER, SYMBOL, END } kind;
-        std::string text;
-        int line;
-        int col;
+        std::string_view text;
+        size_t offset;
     };
     class Tokenizer {
     public:
         Tokenizer(std::string input);
+        Tokenizer(std::string_view input, int line = 1, int col = 1);
         Token next();
-        int line() const { return _line; }
-        int col() const { return _col; }
+        std::string location(size_t offset) const;
     private:
-        std::string s;
+        std::string owned;
+        std::string_view s;
         size_t i;
-        int _line;
-        int _col;
+        int origin_line = 1;
+        int origin_col = 1;
         void skip_ws();
-        void advance();
     };
     Token cur;
     Tokenizer tz;
     void consume();
     std::shared_ptr<SExpr> parseOne();
+    void parseOne(AstArena &arena, std::vector<AstNode> &pending);
+    [[noreturn]] void unexpected() const;
 };
 
 #endif
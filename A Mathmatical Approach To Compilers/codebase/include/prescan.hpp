@@ -0,0 +1,37 @@
+#ifndef PRESCAN_HPP
+#define PRESCAN_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Structural pre-scan: finds the byte ranges of the top-level forms of a
+// whole input so they can be tokenized and parsed on several threads.
+//
+// The input is classified 64 bytes at a time into bitmasks of '(', ')',
+// whitespace and newlines (with AVX2 or SSE2 where the CPU has them, byte
+// by byte otherwise). Only the paren bits are then walked to track depth,
+// so a run of 64 bytes inside a list with no parens costs a single test.
+// Top-level atoms are the runs of non-delimiter bytes starting at depth
+// zero. The tokenizer can split one such run further ("42y" is a number and
+// a symbol), so a range holds one or more whole forms, never part of one.
+struct FormRange {
+    size_t begin;
+    size_t end;
+    int line;   // position of begin, as Parser(std::string_view, line, col) takes it
+    int col;
+};
+
+enum class PrescanIsa { Auto, Avx2, Sse2, Scalar };
+
+// Appends the forms of text to forms. Returns false, with forms left
+// incomplete, when a ')' has no matching '(' or a list is not closed;
+// parsing the input sequentially then reports the error.
+// An Isa the CPU lacks falls back to the next one down.
+bool scan_forms(std::string_view text, std::vector<FormRange> &forms, PrescanIsa isa = PrescanIsa::Auto);
+
+// The instruction set scan_forms uses for isa on this CPU.
+PrescanIsa prescan_isa(PrescanIsa isa = PrescanIsa::Auto);
+const char *prescan_isa_name(PrescanIsa isa);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include "lambda.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Instrumentation behind --profile=json|csv. It is off unless
+// enable_profiling() is called before compilation starts. While it is off,
+// each hook costs one test of a global flag: the replaced operator new
+// and delete go straight to malloc and free, and PhaseScope does nothing.
+//
+// When on, it records:
+//   • per phase: self time, allocations, bytes allocated and frees, with
+//     the phase taken from the innermost PhaseScope on the allocating
+//     thread (nested scopes do not count toward their parents)
+//   • per form: translate time, output bytes and a prefix of its text
+//   • .lc output bytes for each builtin and each numeral value, counted
+//     by the printers (cache hits and .lcb records are not broken down)
+enum class Phase : uint8_t {
+    Other,      // outside any scope: startup, option parsing, reporting
+    Read,       // reading the input file
+    Parse,
+    Fold,
+    Lower,      // AST -> λ-term DAG, and form cache lookups
+    Optimize,
+    Print,      // λ-terms -> .lc text or .lcb records
+    Write,      // writing the output file
+    COUNT
+};
+
+constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::COUNT);
+
+const char *phase_name(Phase p);
+
+enum class ProfileFormat { Json, Csv };
+
+namespace profile_detail {
+extern bool enabled;
+}
+
+// Set once, before any compiling thread starts.
+void enable_profiling();
+inline bool profiling() { return profile_detail::enabled; }
+
+// Attributes allocations and time on this thread to a phase for its
+// lifetime, then restores the enclosing one.
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase p) {
+        if (profiling()) enter(p);
+    }
+    ~PhaseScope() {
+        if (active) leave();
+    }
+    PhaseScope(const PhaseScope &) = delete;
+    PhaseScope &operator=(const PhaseScope &) = delete;
+
+private:
+    bool active = false;
+    Phase saved = Phase::Other;
+    uint64_t start_ns = 0;
+    uint64_t saved_child_ns = 0;
+
+    void enter(Phase p);
+    void leave();
+};
+
+// Monotonic clock for per-form times.
+uint64_t profile_now_ns();
+
+// Called by the translator once per form (from any thread).
+void record_form(std::string label, uint64_t nanos, uint64_t output_bytes, bool cached);
+// Adds one form's builtin and numeral byte counts to the totals.
+void record_output(const PrintProfile &p);
+
+// Writes everything recorded so far. Forms are listed slowest first.
+void write_profile(std::ostream &out, ProfileFormat format, const std::string &input);
+
+#endif
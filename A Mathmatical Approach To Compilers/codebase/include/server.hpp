@@ -0,0 +1,35 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+#include <vector>
+
+// Resident compiler (--serve PATH) and its thin client (--connect PATH).
+//
+// The server listens on a Unix domain socket and compiles requests with
+// the options it was started with; numeral text, --cache entries and each
+// connection thread's term table stay warm between requests. Every
+// connection gets its own thread and may send any number of requests.
+//
+// Requests and responses are a header line followed by a body of the
+// length it gives:
+//
+//   SOURCE <n>\n<source>         compile .lctest source text
+//   FILE <n>\n<path>             compile a file the server reads itself
+//   STATS 0\n                    request count and latency percentiles
+//   SHUTDOWN 0\n                 stop accepting and exit
+//
+//   OK <n>\n<.lc text or stats>
+//   ERROR <line> <col> <n>\n<message>     line/col 0 when not positional
+//
+// Output is .lc text only. With --prelude each response carries the
+// definitions it uses, as a file compiled on its own would.
+int run_server(const std::string &socket_path, bool use_arena);
+
+// Sends each input (a path, or - for source on stdin) and writes the IR
+// next to the file as .lc, or to stdout for -. stats and shutdown send the
+// matching request instead. Returns the process exit status.
+int run_client(const std::string &socket_path, const std::vector<std::string> &inputs,
+               bool stats, bool shutdown);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own
+// newest task (LIFO, cache-warm) and, when empty, steals the oldest task
+// from a sibling (FIFO, largest remaining chunk). Tasks submitted from a
+// worker land on that worker's deque; outside submissions are spread
+// round-robin.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+    // Blocks until every submitted task has finished. Call from outside the pool.
+    void wait_idle();
+    // Runs body(begin, end) over [0, n) in grain-sized chunks and waits.
+    // The first exception thrown by any chunk is rethrown here.
+    void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+    // Index of the calling worker thread, or -1 outside the pool.
+    static int worker_index();
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_queue{0};
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> unfinished{0};
+    std::mutex sleep_m;
+    std::condition_variable work_cv;
+    std::condition_variable idle_cv;
+    bool stopping = false;
+
+    bool try_pop(size_t self, std::function<void()> &task);
+    void run(size_t self);
+};
+
+#endif
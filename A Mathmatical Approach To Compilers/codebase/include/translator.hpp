@@ -2,17 +2,23 @@
 #define TRANSLATOR_HPP
 
 #include "parser.hpp"
+#include "emitter.hpp"
+#include "lambda.hpp"
+#include "lcb.hpp"
+#include "form_cache.hpp"
+#include <iostream>
 #include <string>
 
 // Position in Compiler Pipeline:
-//   Source (.lctest) -> AST (S-expressions) -> λ-calculus IR -> Backend (.lc)
+//   Source (.lctest) -> AST (S-expressions) -> λ-term DAG -> Backend (.lc)
 //
 // Translation Strategy:
 //   Variables        -> Bound variable names
 //   (lambda (x) e)   -> λx. e  (with currying for multiple args)
 //   (f a b)          -> ((f a) b)  (left-associative application)
 //   (+ a b)          -> (ADD a b) with Church encodings
-//   Numbers          -> Church numerals (with CSE caching)
+//   Numbers          -> Church numerals (with CSE caching), or base-16
+//                       LMUL/LADD chains with --numerals=compact
 //   Booleans         -> Church booleans (λt.λf.t / λt.λf.f)
 //   Let-bindings     -> Lambda abstraction + application
 //   Lists            -> Church pairs and nil
@@ -20,7 +26,16 @@
 //
 // Optimizations:
 //   • Numeral caching prevents recomputation of large Church numerals
-//   • CSE reduces IR size and compilation time
+//   • λ-terms are hash-consed, so equal subterms are built once (lambda.hpp)
+//   • --fold evaluates literal arithmetic, comparisons and conditions on
+//     the AST before lowering (fold.hpp)
+//   • --optimize β/η-reduces each form's λ-DAG within a fuel budget,
+//     inlining single-use and small bindings (optimize.hpp)
+//   • --cache DIR keeps each form's IR on disk and reuses it while the
+//     form and options are unchanged (form_cache.hpp)
+//   • --cse prints repeated closed subterms once, bound by a let-style redex
+//   • --prelude defines each builtin used once per file ("ADD := ...") and
+//     refers to it by name
 //   • Curried functions enable partial application
 //
 //  Language Constructs:
@@ -40,8 +55,56 @@
 //   (let ((x 5)) x)   -> ((λx.x) (λf.λx.f (f (f (f (f x))))))
 // ============================================================
 
+enum class NumeralMode {
+    Unary,      // λf.λx.f (f ... x): size linear in the value
+    Compact,    // large values built from small numerals with LMUL/LADD
+};
+
+struct TranslateOptions {
+    bool cse = false;   // bind repeated subterms once per form
+    NumeralMode numerals = NumeralMode::Unary;
+    bool prelude = false;   // print builtins by name; see write_prelude
+    bool fold = false;      // constant-fold the AST first (fold.hpp)
+    bool optimize = false;  // β/η-simplify each form (optimize.hpp)
+    size_t optimize_fuel = 10000;
+};
+
+// Set once before translation starts; read by every translating thread.
+void set_translate_options(const TranslateOptions &opts);
+const TranslateOptions &translate_options();
+
+// With a cache set, translate and translate_binary copy a form's IR from
+// it when the form and options are unchanged, and store it otherwise
+// (form_cache.hpp). The cache must outlive translation; nullptr disables it.
+void set_form_cache(FormCache *cache);
+
+// Lowers one expression into terms and returns its root.
+TermId translate_term(const std::shared_ptr<SExpr> &sexpr, TermTable &terms);
+TermId translate_term(const AstArena &arena, AstArena::Id node, TermTable &terms);
+
+// Streams the IR for one expression into out. Returns the builtins it
+// refers to by name, with the prelude option (0 otherwise).
+BuiltinSet translate(const std::shared_ptr<SExpr> &sexpr, Emitter &out);
+BuiltinSet translate(const AstArena &arena, AstArena::Id node, Emitter &out);
+// Encodes one expression as an .lcb record (see lcb.hpp) instead of text.
+void translate_binary(const std::shared_ptr<SExpr> &sexpr, std::string &record);
+void translate_binary(const AstArena &arena, AstArena::Id node, std::string &record);
+// Convenience wrappers returning the IR as a string.
 std::string translate(const std::shared_ptr<SExpr> &sexpr);
-void print_cache_stats();
+std::string translate(const AstArena &arena, AstArena::Id node);
+
+// With the prelude option, translation records the builtins each form
+// refers to. write_prelude appends a "NAME := text" line for every builtin
+// used since the last call, plus the builtins those depend on, each after
+// its dependencies. Builtins written once are not written again, so calling
+// it ahead of every form defines each name just before its first use.
+// Returns the number of definitions written.
+size_t write_prelude(Emitter &out);
+// The same for one output file of its own: writes the definitions of used
+// that are not in written yet, and adds them to written.
+size_t write_prelude(Emitter &out, BuiltinSet used, BuiltinSet &written);
+
+void print_cache_stats(std::ostream &out = std::cout);
 void clear_cache();
 
 #endif
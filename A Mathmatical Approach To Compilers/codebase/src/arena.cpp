@@ -0,0 +1,109 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: arena AST storage and atom interning (tokens -> flat AST)
+***************************************************************************************/
+
+#include "arena.hpp"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t ID_BITS = 0xFFFFFFFFull;
+
+} // namespace
+
+size_t SymbolTable::find(std::string_view text, uint64_t h) const {
+    size_t mask = slots.size() - 1;
+    uint64_t tag = h & ~ID_BITS;
+    size_t i = static_cast<size_t>(h) & mask;
+    for (; slots[i] != 0; i = (i + 1) & mask) {
+        if ((slots[i] & ~ID_BITS) == tag && names[(slots[i] & ID_BITS) - 1] == text) break;
+    }
+    return i;
+}
+
+void SymbolTable::rehash(size_t slot_count) {
+    slots.assign(slot_count, 0);
+    size_t mask = slot_count - 1;
+    for (size_t id = 0; id < names.size(); id++) {
+        uint64_t h = hash(names[id]);
+        size_t i = static_cast<size_t>(h) & mask;
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = (h & ~ID_BITS) | (id + 1);
+    }
+}
+
+uint32_t SymbolTable::intern(std::string_view text) {
+    if (slots.size() < 2 * (names.size() + 1)) rehash(slots.empty() ? 1024 : 2 * slots.size());
+    uint64_t h = hash(text);
+    size_t slot = find(text, h);
+    if (slots[slot] != 0) return static_cast<uint32_t>((slots[slot] & ID_BITS) - 1);
+    if (names.size() >= ID_BITS - 1) {
+        throw std::runtime_error("symbol table exceeded 2^32 symbols");
+    }
+
+    char *dst;
+    if (text.size() > CHUNK_SIZE / 4) {
+        // large atoms get a block of their own so the current chunk keeps filling
+        large.emplace_back(new char[text.size()]);
+        dst = large.back().get();
+    } else {
+        if (chunks.empty() || text.size() > CHUNK_SIZE - chunk_used) {
+            chunks.emplace_back(new char[CHUNK_SIZE]);
+            chunk_used = 0;
+        }
+        dst = chunks.back().get() + chunk_used;
+        chunk_used += text.size();
+    }
+    std::memcpy(dst, text.data(), text.size());
+    pool_bytes += text.size();
+
+    std::string_view stored(dst, text.size());
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(stored);
+    slots[slot] = (h & ~ID_BITS) | (uint64_t(id) + 1);
+    return id;
+}
+
+void SymbolTable::clear() {
+    slots.clear();
+    slots.shrink_to_fit();
+    names.clear();
+    names.shrink_to_fit();
+    chunks.clear();
+    large.clear();
+    chunk_used = CHUNK_SIZE;
+    pool_bytes = 0;
+}
+
+AstNode AstArena::make_list(const AstNode *children, uint32_t count) {
+    if (nodes.size() + count > UINT32_MAX) {
+        throw std::runtime_error("AST arena exceeded 2^32 nodes");
+    }
+    uint32_t first = static_cast<uint32_t>(nodes.size());
+    nodes.insert(nodes.end(), children, children + count);
+    return {false, first, count};
+}
+
+AstArena::Id AstArena::push(const AstNode &node) {
+    nodes.push_back(node);
+    return static_cast<Id>(nodes.size() - 1);
+}
+
+void AstArena::erase_child(Id id, uint32_t i) {
+    AstNode &list = nodes[id];
+    for (uint32_t k = list.first + i; k + 1 < list.first + list.count; k++) {
+        nodes[k] = nodes[k + 1];
+    }
+    list.count--;
+}
+
+void AstArena::clear() {
+    nodes.clear();
+    nodes.shrink_to_fit();
+    symbols.clear();
+    root_id = 0;
+}
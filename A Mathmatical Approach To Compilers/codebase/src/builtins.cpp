@@ -0,0 +1,110 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: Church encodings of the source language builtins
+***************************************************************************************/
+
+#include "builtins.hpp"
+
+static const std::string_view TEXT[BUILTIN_COUNT] = {
+    //ops
+    "(λm.λn.λf.λx. m f (n f x))",                      // LADD    addition
+    "(λm.λn.λf. m (n f))",                             // LMUL    multiplication
+    "(λm.λn. n PRED m)",                               // LSUB    subtraction
+    "(λm.λn. m (n PRED) m)",                           // LDIV    division
+
+    //bools
+    "(λt.λf.t)",                                       // LTRUE
+    "(λt.λf.f)",                                       // LFALSE
+    "(λp.λq. p q p)",                                  // LAND    AND
+    "(λp.λq. p p q)",                                  // LOR     OR
+    "(λp.λa.λb. p b a)",                               // LNOT    NOT
+
+    //comparison
+    "(λm.λn. ISZERO (SUB m n))",                       // LEQ     <=
+    "(λm.λn. NOT (LEQ n m))",                          // LLT     <
+    "(λm.λn. LT n m)",                                 // LGT     >
+    "(λm.λn. LEQ n m)",                                // LGEQ    >=
+
+    //help ops
+    "(λn.λf.λx. f (n f x))",                           // LSUCC   successor
+    "(λn.λf.λx. n (λg.λh. h (g f)) (λu.x) (λu.u))",    // LPRED   predecessor
+    "(λn. n (λx.FALSE) TRUE)",                         // LISZERO ? == 0
+
+    // recursion
+    "(λf. (λx. f (x x)) (λx. f (x x)))",               // Y_COMBINATOR
+
+    //pairs
+    "(λx.λy.λf. f x y)",                               // LPAIR   create pair
+    "(λp. p (λx.λy.x))",                               // LFIRST  first element
+    "(λp. p (λx.λy.y))",                               // LSECOND second element
+
+    //lists
+    "(λx.TRUE)",                                       // LNIL    empty list
+    "(λh.λt.λf. f h t)",                               // LCONS   cons
+    "FIRST",                                           // LHEAD   list head
+    "SECOND",                                          // LTAIL   list tail
+    "(λl. l (λh.λt.FALSE))",                           // LISNIL  ? == empty
+
+    "(λm.λn. AND (LEQ m n) (LEQ n m))",                // LEQUAL  =
+};
+
+static const std::string_view NAME[BUILTIN_COUNT] = {
+    "ADD", "MUL", "SUB", "DIV",
+    "TRUE", "FALSE", "AND", "OR", "NOT",
+    "LEQ", "LT", "GT", "GEQ",
+    "SUCC", "PRED", "ISZERO",
+    "Y",
+    "PAIR", "FIRST", "SECOND",
+    "NIL", "CONS", "HEAD", "TAIL", "ISNIL",
+    "EQ",
+};
+
+std::string_view builtin_text(Builtin b) {
+    return TEXT[static_cast<size_t>(b)];
+}
+
+std::string_view builtin_name(Builtin b) {
+    return NAME[static_cast<size_t>(b)];
+}
+
+bool builtin_from_name(std::string_view name, Builtin &b) {
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        if (NAME[i] == name) {
+            b = static_cast<Builtin>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+BuiltinSet builtin_deps(Builtin b) {
+    switch (b) {
+    case Builtin::LSUB:
+    case Builtin::LDIV:    return builtin_bit(Builtin::LPRED);
+    case Builtin::LEQ:     return builtin_bit(Builtin::LISZERO) | builtin_bit(Builtin::LSUB);
+    case Builtin::LLT:     return builtin_bit(Builtin::LNOT) | builtin_bit(Builtin::LEQ);
+    case Builtin::LGT:     return builtin_bit(Builtin::LLT);
+    case Builtin::LGEQ:    return builtin_bit(Builtin::LEQ);
+    case Builtin::LISZERO: return builtin_bit(Builtin::LFALSE) | builtin_bit(Builtin::LTRUE);
+    case Builtin::LNIL:    return builtin_bit(Builtin::LTRUE);
+    case Builtin::LHEAD:   return builtin_bit(Builtin::LFIRST);
+    case Builtin::LTAIL:   return builtin_bit(Builtin::LSECOND);
+    case Builtin::LISNIL:  return builtin_bit(Builtin::LFALSE);
+    case Builtin::LEQUAL:  return builtin_bit(Builtin::LAND) | builtin_bit(Builtin::LEQ);
+    default:               return 0;
+    }
+}
+
+BuiltinSet builtin_closure(BuiltinSet set, BuiltinSet done, std::vector<Builtin> &order) {
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        Builtin b = static_cast<Builtin>(i);
+        if (!(set & builtin_bit(b)) || (done & builtin_bit(b))) continue;
+        // the dependency graph is acyclic and only a few levels deep
+        done = builtin_closure(builtin_deps(b), done, order);
+        order.push_back(b);
+        done |= builtin_bit(b);
+    }
+    return done;
+}
@@ -0,0 +1,1070 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: native backend: λ-term IR -> C via closure conversion and lifting,
+*                 with a push/enter runtime and a copying collector
+***************************************************************************************/
+
+#include "cbackend.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Types, registers and the allocation and stack primitives the generated
+// functions use. The program goes between this and RUNTIME_TAIL.
+const char *const RUNTIME_HEAD = R"RT(#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Heap objects are two header words and NF fields:
+ *   CLO   code, captured variables        THK   code, captured variables
+ *   ITER  count k, f, x  (f^k x)          IND   the value an updated thunk has
+ *   NUM   machine numeral                 PAP   numeral, arguments so far
+ *   PRIM  native builtin                  FREE  name nothing defines
+ *   SUCC, INT, TRUE, FALSE, PAIR          readback markers; an INT is the
+ *                                         count SUCC leaves, and unlike a
+ *                                         NUM cannot be applied
+ * BH marks a thunk that is being evaluated. */
+enum { T_CLO, T_THK, T_ITER, T_IND, T_NUM, T_PAP, T_PRIM, T_FREE,
+       T_SUCC, T_INT, T_TRUE, T_FALSE, T_PAIR, T_FWD };
+#define BH ((uintptr_t)0x80)
+#define HDR(tag, n) ((uintptr_t)(tag) | ((uintptr_t)(n) << 8))
+#define TAG(o) ((int)((o)->hdr & 0x7f))
+#define NF(o) ((size_t)((o)->hdr >> 8))
+#define F(o, i) (((struct Obj **)((o) + 1))[i])
+
+typedef struct Obj {
+    uintptr_t hdr;
+    union {
+        void (*code)(void);
+        struct Obj *ind;
+        uint64_t num;
+    } u;
+} Obj;
+
+enum { P_ADD, P_MUL, P_SUB, P_DIV, P_SUCC, P_PRED, P_ISZERO,
+       P_LEQ, P_LT, P_GT, P_GEQ, P_EQ, P_COUNT };
+
+enum { F_ARG, F_UPDATE, F_PRIM, F_ADDONE };
+typedef struct {
+    int kind;
+    int op;
+    Obj *a, *b, *c;
+} Frame;
+
+static struct {
+    Obj *self, *arg, *next;       /* the code being run and what to enter next */
+    uintptr_t *hp, *hlim, *heap, *mark;
+    size_t heap_words, target_words, max_words, peak_words;
+    Frame *stack;
+    size_t sp, cap;
+    Obj **roots;
+    size_t nroots, root_cap;
+    uint64_t steps, limit, max_steps, updates, collections, allocated;
+    jmp_buf fail;
+    char error[256];
+} rt;
+
+static void rt_gc(size_t need);
+static int rt_show(const char *label, int line, Obj *t);
+
+/* A function reserves everything it allocates before it reads a register,
+ * so a collection can only happen at that point. */
+#define RESERVE(words) do { if ((size_t)(rt.hlim - rt.hp) < (size_t)(words)) rt_gc(words); } while (0)
+
+static Obj *rt_new(uintptr_t hdr, size_t n) {
+    Obj *o = (Obj *)rt.hp;
+    rt.hp += 2 + n;
+    o->hdr = hdr;
+    return o;
+}
+
+static void rt_push(int kind, Obj *a) {
+    Frame *f;
+    if (rt.sp == rt.cap) {
+        rt.cap = rt.cap ? rt.cap * 2 : 1024;
+        rt.stack = (Frame *)realloc(rt.stack, rt.cap * sizeof(Frame));
+        if (!rt.stack) {
+            fputs("out of memory\n", stderr);
+            exit(2);
+        }
+    }
+    f = &rt.stack[rt.sp++];
+    f->kind = kind;
+    f->op = 0;
+    f->a = a;
+    f->b = f->c = NULL;
+}
+
+/* ---- program ---- */
+)RT";
+
+// The collector, the push/enter loop, readback and main.
+const char *const RUNTIME_TAIL = R"RT(
+/* ---- runtime ---- */
+static const int rt_arity[P_COUNT] = {2, 2, 2, 2, 1, 1, 1, 2, 2, 2, 2, 2};
+static Obj rt_small[256];
+static Obj rt_succ_marker = {HDR(T_SUCC, 0), {.num = 0}};
+static Obj rt_zero_marker = {HDR(T_INT, 0), {.num = 0}};
+static Obj rt_true_marker = {HDR(T_TRUE, 0), {.num = 0}};
+static Obj rt_false_marker = {HDR(T_FALSE, 0), {.num = 0}};
+static Obj rt_pair_marker = {HDR(T_PAIR, 0), {.num = 0}};
+
+static void rt_fail(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(rt.error, sizeof rt.error, fmt, ap);
+    va_end(ap);
+    longjmp(rt.fail, 1);
+}
+
+static Obj *rt_num(uint64_t n) {
+    Obj *o;
+    if (n < 256) return &rt_small[n];
+    RESERVE(2);
+    o = rt_new(HDR(T_NUM, 0), 0);
+    o->u.num = n;
+    return o;
+}
+
+/* ---- copying collector ---- */
+static uintptr_t *rt_to;
+
+static Obj *rt_evacuate(Obj *o) {
+    Obj *copy;
+    size_t words;
+    if (!o || (uintptr_t *)o < rt.heap || (uintptr_t *)o >= rt.heap + rt.heap_words) return o;
+    if (TAG(o) == T_FWD) return o->u.ind;
+    if (TAG(o) == T_IND) return rt_evacuate(o->u.ind);   /* values are never IND */
+    words = 2 + NF(o);
+    copy = (Obj *)rt_to;
+    memcpy(copy, o, words * sizeof(uintptr_t));
+    rt_to += words;
+    o->hdr = T_FWD;
+    o->u.ind = copy;
+    return copy;
+}
+
+static void rt_gc(size_t need) {
+    size_t words = rt.heap_words > rt.target_words ? rt.heap_words : rt.target_words;
+    uintptr_t *to, *scan;
+    size_t i;
+    if (words > rt.max_words) words = rt.max_words;
+    to = (uintptr_t *)malloc(words * sizeof(uintptr_t));
+    if (!to) rt_fail("out of memory");
+    rt.allocated += (uint64_t)(rt.hp - rt.mark);
+    rt.collections++;
+
+    rt_to = to;
+    rt.self = rt_evacuate(rt.self);
+    rt.arg = rt_evacuate(rt.arg);
+    rt.next = rt_evacuate(rt.next);
+    for (i = 0; i < rt.sp; i++) {
+        rt.stack[i].a = rt_evacuate(rt.stack[i].a);
+        rt.stack[i].b = rt_evacuate(rt.stack[i].b);
+        rt.stack[i].c = rt_evacuate(rt.stack[i].c);
+    }
+    for (i = 0; i < rt.nroots; i++) rt.roots[i] = rt_evacuate(rt.roots[i]);
+    for (i = 0; i < rt_ncafs; i++) {
+        if (TAG(rt_cafs[i]) == T_IND) rt_cafs[i]->u.ind = rt_evacuate(rt_cafs[i]->u.ind);
+    }
+    for (scan = to; scan < rt_to;) {
+        Obj *o = (Obj *)scan;
+        size_t n = NF(o);
+        switch (TAG(o)) {
+        case T_PAP:
+            o->u.ind = rt_evacuate(o->u.ind);
+            /* fall through */
+        case T_CLO:
+        case T_THK:
+        case T_ITER:
+        case T_PAIR:
+            for (i = 0; i < n; i++) F(o, i) = rt_evacuate(F(o, i));
+            break;
+        default:
+            break;
+        }
+        scan += 2 + n;
+    }
+
+    free(rt.heap);
+    rt.heap = to;
+    rt.heap_words = words;
+    rt.hp = rt.mark = rt_to;
+    rt.hlim = to + words;
+    if (words > rt.peak_words) rt.peak_words = words;
+    if (((size_t)(rt.hp - to) + need) * 2 > words) rt.target_words = words * 2;
+    if ((size_t)(rt.hlim - rt.hp) < need) {
+        if (words >= rt.max_words) {
+            rt_fail("heap limit of %llu MB exhausted",
+                    (unsigned long long)(rt.max_words * sizeof(uintptr_t) >> 20));
+        }
+        rt_gc(need);
+    }
+}
+
+/* ---- evaluation ---- */
+static Obj *rt_prim(int op, uint64_t m, uint64_t n) {
+    switch (op) {
+    case P_ADD: return rt_num(m + n);
+    case P_MUL: return rt_num(m * n);
+    case P_SUB: return rt_num(m > n ? m - n : 0);
+    case P_DIV: return rt_num(n == 0 ? m : 0);   /* the encoding is m (n PRED) m */
+    case P_SUCC: return rt_num(m + 1);
+    case P_PRED: return rt_num(m > 0 ? m - 1 : 0);
+    case P_ISZERO: return rt_bool[m == 0];
+    case P_LEQ: return rt_bool[m <= n];
+    case P_LT: return rt_bool[m < n];
+    case P_GT: return rt_bool[m > n];
+    case P_GEQ: return rt_bool[m >= n];
+    default: return rt_bool[m == n];
+    }
+}
+
+static void rt_step(void) {
+    if (++rt.steps > rt.limit) {
+        rt_fail("step budget of %llu exhausted", (unsigned long long)rt.max_steps);
+    }
+}
+
+/* Runs rt.next against the stack until a value is left with no frames. */
+static Obj *rt_eval(void) {
+    for (;;) {
+        Obj *o = rt.next;
+        int applied = rt.sp > 0 && rt.stack[rt.sp - 1].kind == F_ARG;
+        switch (TAG(o)) {
+        case T_IND:
+            rt.next = o->u.ind;
+            continue;
+        case T_THK:
+            if (o->hdr & BH) rt_fail("infinite loop: a value depends on itself");
+            o->hdr |= BH;
+            rt_push(F_UPDATE, o);
+            rt.self = o;
+            rt.arg = NULL;
+            o->u.code();
+            continue;
+        case T_ITER:
+            if (o->hdr & BH) rt_fail("infinite loop: a value depends on itself");
+            o->hdr |= BH;
+            rt_push(F_UPDATE, o);
+            if (o->u.num == 0) {
+                rt.next = F(o, 1);
+                continue;
+            }
+            RESERVE(4);
+            o = rt.stack[rt.sp - 1].a;
+            {
+                Obj *rest = rt_new(HDR(T_ITER, 2), 2);
+                rest->u.num = o->u.num - 1;
+                F(rest, 0) = F(o, 0);
+                F(rest, 1) = F(o, 1);
+                rt.next = F(o, 0);
+                rt_push(F_ARG, rest);
+            }
+            continue;
+        case T_CLO:
+            if (!applied) break;
+            rt_step();
+            rt.self = o;
+            rt.arg = rt.stack[--rt.sp].a;
+            o->u.code();
+            continue;
+        case T_NUM:
+            if (!applied) break;
+            if (rt.sp < 2 || rt.stack[rt.sp - 2].kind != F_ARG) {
+                Obj *pap;
+                RESERVE(3);
+                pap = rt_new(HDR(T_PAP, 1), 1);
+                pap->u.ind = rt.next;
+                F(pap, 0) = rt.stack[--rt.sp].a;
+                rt.next = pap;
+                continue;
+            }
+            rt_step();
+            if (o->u.num == 0) {
+                rt.sp -= 2;
+                rt.next = rt.stack[rt.sp].a;
+                continue;
+            }
+            RESERVE(4);
+            {
+                Obj *rest = rt_new(HDR(T_ITER, 2), 2);
+                rest->u.num = rt.next->u.num - 1;
+                F(rest, 0) = rt.stack[rt.sp - 1].a;
+                F(rest, 1) = rt.stack[rt.sp - 2].a;
+                rt.sp -= 2;
+                rt.next = F(rest, 0);
+                rt_push(F_ARG, rest);
+            }
+            continue;
+        case T_PAP:
+            if (!applied) break;
+            {
+                size_t i;
+                for (i = NF(o); i-- > 0;) rt_push(F_ARG, F(o, i));
+            }
+            rt.next = o->u.ind;
+            continue;
+        case T_PRIM: {
+            int op = (int)o->u.num;
+            int arity = rt_arity[op];
+            if (rt.sp >= (size_t)arity && rt.stack[rt.sp - 1].kind == F_ARG &&
+                (arity == 1 || rt.stack[rt.sp - 2].kind == F_ARG)) {
+                Obj *a = rt.stack[rt.sp - 1].a;
+                Obj *b = arity == 2 ? rt.stack[rt.sp - 2].a : NULL;
+                rt.sp -= (size_t)arity;
+                rt_push(F_PRIM, a);
+                rt.stack[rt.sp - 1].op = op;
+                rt.stack[rt.sp - 1].b = b;
+                rt.next = a;
+            } else {
+                rt.next = rt_fallback[op];
+            }
+            continue;
+        }
+        case T_SUCC:
+            if (!applied) break;
+            rt.next = rt.stack[rt.sp - 1].a;
+            rt.stack[rt.sp - 1].kind = F_ADDONE;
+            rt.stack[rt.sp - 1].a = NULL;
+            continue;
+        case T_PAIR:
+            if (!applied) break;
+            if (NF(o) >= 2) rt_fail("stuck: a readback marker was used as a function");
+            RESERVE(4);
+            o = rt.next;
+            {
+                size_t i, n = NF(o);
+                Obj *p = rt_new(HDR(T_PAIR, n + 1), n + 1);
+                p->u.num = 0;
+                for (i = 0; i < n; i++) F(p, i) = F(o, i);
+                F(p, n) = rt.stack[--rt.sp].a;
+                rt.next = p;
+            }
+            continue;
+        case T_FREE:
+            if (!applied) break;
+            rt_fail("free variable '%s' applied to an argument", rt_free_names[o->u.num]);
+            break;
+        case T_INT:
+            if (!applied) break;
+            rt_fail("a native number was applied to an argument");
+            break;
+        default:
+            if (!applied) break;
+            rt_fail("stuck: a readback marker was used as a function");
+            break;
+        }
+
+        /* o is a value: hand it to the innermost frame */
+        if (rt.sp == 0) return o;
+        {
+            Frame *f = &rt.stack[rt.sp - 1];
+            switch (f->kind) {
+            case F_UPDATE:
+                f->a->hdr = HDR(T_IND, NF(f->a));
+                f->a->u.ind = o;
+                rt.updates++;
+                rt.sp--;
+                break;
+            case F_ADDONE:
+                if (TAG(o) != T_INT) rt_fail("native successor applied to a non-number");
+                rt.sp--;
+                RESERVE(2);
+                {
+                    Obj *n = rt_new(HDR(T_INT, 0), 0);
+                    n->u.num = rt.next->u.num + 1;
+                    rt.next = n;
+                }
+                break;
+            default: {
+                int op = f->op;
+                Obj *a = f->a, *b = f->b;
+                uint64_t m;
+                if (TAG(o) != T_NUM) {
+                    /* not a machine numeral: run the encoding instead */
+                    rt.sp--;
+                    if (b) rt_push(F_ARG, b);
+                    rt_push(F_ARG, a);
+                    rt.next = rt_fallback[op];
+                    break;
+                }
+                if (rt_arity[op] == 2 && !f->c) {
+                    f->c = o;
+                    rt.next = b;
+                    break;
+                }
+                m = f->c ? f->c->u.num : o->u.num;
+                rt.sp--;
+                rt.next = rt_prim(op, m, o->u.num);
+                break;
+            }
+            }
+        }
+    }
+}
+
+/* Forces t applied to args (args[0] first); NULL with rt.error set if it
+ * gets stuck, loops or runs out of steps or heap. */
+static Obj *rt_run(Obj *t, int argc, Obj *const *args) {
+    Obj *v;
+    int i;
+    rt.sp = 0;
+    for (i = argc; i-- > 0;) rt_push(F_ARG, args[i]);
+    rt.next = t;
+    rt.limit = rt.max_steps ? rt.steps + rt.max_steps : UINT64_MAX;
+    if (setjmp(rt.fail)) {
+        size_t k;
+        /* thunks left half-evaluated can be forced again by a later run */
+        for (k = 0; k < rt.sp; k++) {
+            if (rt.stack[k].kind == F_UPDATE) rt.stack[k].a->hdr &= ~BH;
+        }
+        rt.sp = 0;
+        rt.self = rt.arg = rt.next = NULL;
+        return NULL;
+    }
+    v = rt_eval();
+    rt.self = rt.arg = rt.next = NULL;
+    return v;
+}
+
+/* ---- readback, as --eval does it ---- */
+typedef struct {
+    char *s;
+    size_t len, cap;
+} Buf;
+
+static void buf_add(Buf *b, const char *s) {
+    size_t n = strlen(s);
+    if (b->len + n + 1 > b->cap) {
+        b->cap = (b->len + n + 1) * 2;
+        b->s = (char *)realloc(b->s, b->cap);
+        if (!b->s) {
+            fputs("out of memory\n", stderr);
+            exit(2);
+        }
+    }
+    memcpy(b->s + b->len, s, n + 1);
+    b->len += n;
+}
+
+/* Readback keeps its objects in numbered roots, as any run can move them. */
+static size_t rt_root(Obj *o) {
+    if (rt.nroots == rt.root_cap) {
+        rt.root_cap = rt.root_cap ? rt.root_cap * 2 : 64;
+        rt.roots = (Obj **)realloc(rt.roots, rt.root_cap * sizeof(Obj *));
+        if (!rt.roots) {
+            fputs("out of memory\n", stderr);
+            exit(2);
+        }
+    }
+    rt.roots[rt.nroots] = o;
+    return rt.nroots++;
+}
+
+static int rt_is_nil(size_t t) {
+    /* NIL = λx.TRUE, so NIL p t f gives t for any p */
+    Obj *args[3] = {&rt_pair_marker, &rt_true_marker, &rt_false_marker};
+    Obj *r = rt_run(rt.roots[t], 3, args);
+    return r && TAG(r) == T_TRUE;
+}
+
+static Obj *rt_as_pair(size_t t) {
+    Obj *args[1] = {&rt_pair_marker};
+    Obj *r = rt_run(rt.roots[t], 1, args);
+    return r && TAG(r) == T_PAIR && NF(r) == 2 ? r : NULL;
+}
+
+static void rt_readback(size_t t, Buf *out);
+
+static void rt_readback_value(size_t t, Obj *v, Buf *out) {
+    Obj *numeral[2] = {&rt_succ_marker, &rt_zero_marker};
+    Obj *boolean[2] = {&rt_true_marker, &rt_false_marker};
+    char text[32];
+    Obj *r, *p;
+    size_t base, pair;
+
+    if (TAG(v) == T_FREE) {
+        buf_add(out, "<free ");
+        buf_add(out, rt_free_names[v->u.num]);
+        buf_add(out, ">");
+        return;
+    }
+    if (TAG(v) == T_NUM) {
+        snprintf(text, sizeof text, "%llu", (unsigned long long)v->u.num);
+        buf_add(out, v->u.num == 0 ? "0/false" : text);
+        return;
+    }
+    if (TAG(v) != T_CLO && TAG(v) != T_PAP) {
+        buf_add(out, "<marker>");
+        return;
+    }
+    r = rt_run(rt.roots[t], 2, numeral);
+    if (r && TAG(r) == T_INT) {
+        snprintf(text, sizeof text, "%llu", (unsigned long long)r->u.num);
+        buf_add(out, r->u.num == 0 ? "0/false" : text);
+        return;
+    }
+    r = rt_run(rt.roots[t], 2, boolean);
+    if (r && (TAG(r) == T_TRUE || TAG(r) == T_FALSE)) {
+        buf_add(out, TAG(r) == T_TRUE ? "true" : "false");
+        return;
+    }
+    if (rt_is_nil(t)) {
+        buf_add(out, "()");
+        return;
+    }
+    p = rt_as_pair(t);
+    if (!p) {
+        buf_add(out, "<function>");
+        return;
+    }
+    buf_add(out, "(");
+    base = rt.nroots;
+    pair = rt_root(p);
+    for (;;) {
+        size_t rest;
+        rt_readback(rt_root(F(rt.roots[pair], 0)), out);
+        rest = rt_root(F(rt.roots[pair], 1));
+        if (rt_is_nil(rest)) break;
+        p = rt_as_pair(rest);
+        if (!p) {
+            buf_add(out, " . ");
+            rt_readback(rest, out);
+            break;
+        }
+        rt.roots[pair] = p;
+        rt.nroots = pair + 1;
+        buf_add(out, " ");
+    }
+    rt.nroots = base;
+    buf_add(out, ")");
+}
+
+static void rt_readback(size_t t, Buf *out) {
+    Obj *v = rt_run(rt.roots[t], 0, NULL);
+    if (!v) {
+        buf_add(out, "<error: ");
+        buf_add(out, rt.error);
+        buf_add(out, ">");
+        return;
+    }
+    rt_readback_value(t, v, out);
+}
+
+static int rt_show(const char *label, int line, Obj *t) {
+    size_t base = rt.nroots;
+    size_t slot = rt_root(t);
+    Buf out = {NULL, 0, 0};
+    Obj *v = rt_run(t, 0, NULL);
+    printf("  %s %d: ", label, line);
+    if (!v) {
+        printf("error: %s\n", rt.error);
+        rt.nroots = base;
+        return 1;
+    }
+    buf_add(&out, "");
+    rt_readback_value(slot, v, &out);
+    puts(out.s);
+    free(out.s);
+    rt.nroots = base;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    struct timespec start, end;
+    double ms;
+    int i, failures, stats = 0;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            stats = 1;
+        } else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+            rt.max_steps = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--stats] [--max-steps N]\n", argv[0]);
+            return 2;
+        }
+    }
+    for (i = 0; i < 256; i++) {
+        rt_small[i].hdr = HDR(T_NUM, 0);
+        rt_small[i].u.num = (uint64_t)i;
+    }
+    rt.max_words = ((size_t)1 << 30) / sizeof(uintptr_t);
+    rt.heap_words = rt.target_words = rt.peak_words = (size_t)1 << 20;
+    rt.heap = (uintptr_t *)malloc(rt.heap_words * sizeof(uintptr_t));
+    if (!rt.heap) {
+        fputs("out of memory\n", stderr);
+        return 2;
+    }
+    rt.hp = rt.mark = rt.heap;
+    rt.hlim = rt.heap + rt.heap_words;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    puts("Evaluation:");
+    failures = rt_program();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+    rt.allocated += (uint64_t)(rt.hp - rt.mark);
+
+    if (stats) {
+        printf("\n=== Native Statistics ===\n");
+        printf("Run time:        %.3f ms\n", ms);
+        printf("Reductions:      %llu\n", (unsigned long long)rt.steps);
+        printf("Thunk updates:   %llu\n", (unsigned long long)rt.updates);
+        printf("Allocated:       %.2f MB\n", (double)rt.allocated * sizeof(uintptr_t) / (1 << 20));
+        printf("Collections:     %llu (largest heap %.2f MB)\n", (unsigned long long)rt.collections,
+               (double)rt.peak_words * sizeof(uintptr_t) / (1 << 20));
+        printf("==============================\n");
+    } else {
+        printf("  Time:   %.2f ms\n", ms);
+    }
+    return failures == 0 ? 0 : 1;
+}
+)RT";
+
+constexpr TermId NO_TERM = UINT32_MAX;
+
+// Runtime operation (P_ADD ...) of each builtin that has one, else -1.
+int primitive_op(Builtin b) {
+    switch (b) {
+    case Builtin::LADD:    return 0;
+    case Builtin::LMUL:    return 1;
+    case Builtin::LSUB:    return 2;
+    case Builtin::LDIV:    return 3;
+    case Builtin::LSUCC:   return 4;
+    case Builtin::LPRED:   return 5;
+    case Builtin::LISZERO: return 6;
+    case Builtin::LEQ:     return 7;
+    case Builtin::LLT:     return 8;
+    case Builtin::LGT:     return 9;
+    case Builtin::LGEQ:    return 10;
+    case Builtin::LEQUAL:  return 11;
+    default:               return -1;
+    }
+}
+
+constexpr int PRIMITIVE_COUNT = 12;
+const char *const PRIMITIVE_NAMES[PRIMITIVE_COUNT] = {
+    "P_ADD", "P_MUL", "P_SUB", "P_DIV", "P_SUCC", "P_PRED", "P_ISZERO",
+    "P_LEQ", "P_LT", "P_GT", "P_GEQ", "P_EQ",
+};
+
+std::string c_string(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20 || u == 0x7f || c == '?') {
+            // octal escapes, which also keeps "??" trigraphs out
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\%03o", u);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+class CGenerator {
+public:
+    CGenerator(LcProgram &program, NativeNumerals numerals);
+    NativeStats write(const char *label, std::ostream &out);
+
+private:
+    // A lifted function: the body of a λ, which takes the argument, or a
+    // suspended term. captures are the free variables it is closed over,
+    // in the order of its environment record.
+    struct Function {
+        bool lambda;
+        TermId term;
+        std::vector<uint32_t> captures;
+    };
+
+    // A variable in scope: environment field `field` of self, or the
+    // argument when field is -1.
+    struct Local {
+        uint32_t symbol;
+        int field;
+    };
+
+    // Code of the function being written, before its prologue.
+    struct Body {
+        std::string code;
+        size_t words = 0;
+        unsigned temps = 0;
+        bool self = false;
+        bool arg = false;
+    };
+
+    std::string atom(TermId id, const std::vector<Local> &scope, Body &body);
+    std::string local(const std::vector<Local> &scope, uint32_t symbol, Body &body) const;
+    size_t function(bool lambda, TermId term, std::vector<uint32_t> captures);
+    void write_function(size_t index);
+    std::string global(std::string_view name);
+    std::string number(uint64_t n);
+    std::string primitive(Builtin b);
+    bool lowered(Builtin b) const;
+    bool numeral(TermId id, uint32_t &n);
+
+    LcProgram &program;
+    TermTable &terms;
+    bool machine;
+
+    TermId builtin_terms[BUILTIN_COUNT];
+    std::unordered_map<TermId, Builtin> inlined;        // builtin text -> builtin
+    std::unordered_map<uint32_t, TermId> church;        // Church mode: numeral -> its term
+    std::unordered_map<std::string, TermId> definitions;
+    std::vector<std::vector<uint32_t>> free_vars;       // sorted free symbols of each term
+    std::unordered_map<TermId, uint32_t> numerals;      // numeral value, or NO_TERM
+
+    std::map<std::tuple<bool, TermId, std::vector<uint32_t>>, size_t> function_ids;
+    std::vector<Function> functions;
+    std::unordered_map<std::string, std::string> globals;
+    std::unordered_map<uint64_t, std::string> numbers;
+    std::string primitives[PRIMITIVE_COUNT];
+    std::string fallbacks[PRIMITIVE_COUNT];
+    std::string bools[2];
+    std::vector<std::string> cafs;
+    std::vector<std::string> free_names;
+    std::ostringstream prototypes, statics, code;
+    NativeStats stats;
+};
+
+CGenerator::CGenerator(LcProgram &p, NativeNumerals numerals_mode)
+    : program(p), terms(p.terms), machine(numerals_mode == NativeNumerals::Machine) {
+    for (const auto &def : program.definitions) definitions[def.name] = def.term;
+
+    // the builtin texts go into the same table, so an inlined copy of one
+    // is the very node read here
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        Builtin b = static_cast<Builtin>(i);
+        size_t first = program.expressions.size();
+        read_lc(builtin_text(b), program);
+        builtin_terms[i] = program.expressions[first].term;
+        program.expressions.resize(first);
+        if (terms[builtin_terms[i]].kind == TermKind::Lam) inlined.emplace(builtin_terms[i], b);
+    }
+    if (!machine) {
+        size_t n = terms.size();
+        for (TermId id = 0; id < n; id++) {
+            if (terms[id].kind != TermKind::Num || church.count(terms[id].a)) continue;
+            TermId body = terms.var("x");
+            for (uint32_t k = 0; k < terms[id].a; k++) body = terms.app(terms.var("f"), body);
+            church.emplace(terms[id].a, terms.lam("f", terms.lam("x", body)));
+        }
+    }
+
+    // children come before parents, so one pass in id order will do
+    free_vars.resize(terms.size());
+    for (TermId id = 0; id < terms.size(); id++) {
+        const Term &t = terms[id];
+        std::vector<uint32_t> &fv = free_vars[id];
+        if (t.kind == TermKind::Var) {
+            fv.push_back(t.a);
+        } else if (t.kind == TermKind::Lam) {
+            fv = free_vars[t.b];
+            fv.erase(std::remove(fv.begin(), fv.end(), t.a), fv.end());
+        } else if (t.kind == TermKind::App) {
+            const std::vector<uint32_t> &f = free_vars[t.a], &x = free_vars[t.b];
+            std::set_union(f.begin(), f.end(), x.begin(), x.end(), std::back_inserter(fv));
+        }
+    }
+}
+
+// λf.λx.f (f ... x) with n applications, or a Num node.
+bool CGenerator::numeral(TermId id, uint32_t &n) {
+    const Term &t = terms[id];
+    if (t.kind == TermKind::Num) {
+        n = t.a;
+        return true;
+    }
+    if (t.kind != TermKind::Lam || terms[t.b].kind != TermKind::Lam) return false;
+    auto it = numerals.find(id);
+    if (it == numerals.end()) {
+        uint32_t f = t.a, x = terms[t.b].a, count = 0;
+        TermId body = terms[t.b].b;
+        // with f == x the inner binder shadows f, so only λx.λx.x qualifies
+        while (f != x && terms[body].kind == TermKind::App && terms[terms[body].a].kind == TermKind::Var &&
+               terms[terms[body].a].a == f) {
+            body = terms[body].b;
+            count++;
+        }
+        bool is_numeral = terms[body].kind == TermKind::Var && terms[body].a == x;
+        it = numerals.emplace(id, is_numeral ? count : NO_TERM).first;
+    }
+    if (it->second == NO_TERM) return false;
+    n = it->second;
+    return true;
+}
+
+// The encodings of SUB, LEQ, ... refer to other builtins by name. Running
+// one natively is only the same if those names still mean the builtins.
+bool CGenerator::lowered(Builtin b) const {
+    if (!machine || primitive_op(b) < 0) return false;
+    std::vector<Builtin> deps;
+    builtin_closure(builtin_deps(b), 0, deps);
+    for (Builtin d : deps) {
+        auto it = definitions.find(std::string(builtin_name(d)));
+        if (it != definitions.end() && it->second != builtin_terms[static_cast<size_t>(d)]) return false;
+    }
+    return true;
+}
+
+std::string CGenerator::local(const std::vector<Local> &scope, uint32_t symbol, Body &body) const {
+    for (size_t k = scope.size(); k-- > 0;) {
+        if (scope[k].symbol != symbol) continue;
+        if (scope[k].field < 0) {
+            body.arg = true;
+            return "arg";
+        }
+        body.self = true;
+        return "F(self, " + std::to_string(scope[k].field) + ")";
+    }
+    return {};
+}
+
+// C expression for the object a term becomes in scope. Closed λs and
+// suspensions are statics; the others are allocated into body.
+std::string CGenerator::atom(TermId id, const std::vector<Local> &scope, Body &body) {
+    const Term &t = terms[id];
+    if (machine) {
+        uint32_t n;
+        if (numeral(id, n)) return number(n);
+        auto it = inlined.find(id);
+        if (it != inlined.end() && lowered(it->second)) return primitive(it->second);
+    }
+    switch (t.kind) {
+    case TermKind::Var: {
+        std::string ref = local(scope, t.a, body);
+        return ref.empty() ? global(terms.name(t.a)) : ref;
+    }
+    case TermKind::Const:
+        // like the evaluator, by name, so a definition of that name wins
+        return global(builtin_name(static_cast<Builtin>(t.a)));
+    case TermKind::Num:
+        return atom(church.at(t.a), scope, body);
+    case TermKind::Lam:
+    case TermKind::App:
+        break;
+    }
+
+    bool lambda = t.kind == TermKind::Lam;
+    std::vector<uint32_t> captures;
+    for (uint32_t symbol : free_vars[id]) {
+        Body probe;
+        if (!local(scope, symbol, probe).empty()) captures.push_back(symbol);
+    }
+    size_t f = function(lambda, id, captures);
+    if (captures.empty()) return "&s" + std::to_string(f);
+
+    std::string tmp = "t" + std::to_string(body.temps++);
+    std::string n = std::to_string(captures.size());
+    body.code += "    Obj *" + tmp + " = rt_new(HDR(" + (lambda ? "T_CLO" : "T_THK") + ", " + n + "), " + n + ");\n";
+    body.code += "    " + tmp + "->u.code = f" + std::to_string(f) + ";\n";
+    for (size_t i = 0; i < captures.size(); i++) {
+        body.code += "    F(" + tmp + ", " + std::to_string(i) + ") = " + local(scope, captures[i], body) + ";\n";
+    }
+    body.words += 2 + captures.size();
+    return tmp;
+}
+
+size_t CGenerator::function(bool lambda, TermId term, std::vector<uint32_t> captures) {
+    auto key = std::make_tuple(lambda, term, captures);
+    auto it = function_ids.find(key);
+    if (it != function_ids.end()) return it->second;
+    size_t id = functions.size();
+    functions.push_back({lambda, term, std::move(captures)});
+    function_ids.emplace(std::move(key), id);
+    prototypes << "static void f" << id << "(void);\n";
+    if (functions[id].captures.empty()) {
+        // lifted: one static closure, or one memoised thunk shared by every use
+        statics << "static Obj s" << id << " = {HDR(" << (lambda ? "T_CLO" : "T_THK") << ", 0), {.code = f"
+                << id << "}};\n";
+        if (!lambda) cafs.push_back("&s" + std::to_string(id));
+        stats.statics++;
+    }
+    return id;
+}
+
+// Unwinds the body's application spine: allocates what the arguments
+// need, pushes them innermost last and leaves the head to be entered.
+void CGenerator::write_function(size_t index) {
+    Function fn = functions[index];     // functions grows while this one is written
+    std::vector<Local> scope;
+    for (size_t i = 0; i < fn.captures.size(); i++) scope.push_back({fn.captures[i], static_cast<int>(i)});
+    TermId t = fn.term;
+    if (fn.lambda) {
+        scope.push_back({terms[t].a, -1});
+        t = terms[t].b;
+    }
+    Body body;
+    std::string pushes;
+    while (terms[t].kind == TermKind::App) {
+        pushes += "    rt_push(F_ARG, " + atom(terms[t].b, scope, body) + ");\n";
+        t = terms[t].a;
+    }
+    std::string head = atom(t, scope, body);
+
+    code << "static void f" << index << "(void) {\n";
+    if (body.words) code << "    RESERVE(" << body.words << ");\n";
+    if (body.self) code << "    Obj *self = rt.self;\n";
+    if (body.arg) code << "    Obj *arg = rt.arg;\n";
+    code << body.code << pushes << "    rt.next = " << head << ";\n}\n";
+}
+
+// Definitions first, then builtins, then a FREE marker, as the evaluator
+// resolves names. A definition is a static thunk, so definitions can
+// refer to each other in any order.
+std::string CGenerator::global(std::string_view name) {
+    std::string key(name);
+    auto it = globals.find(key);
+    if (it != globals.end()) return it->second;
+
+    std::string ref;
+    TermId term = NO_TERM;
+    Builtin b;
+    auto def = definitions.find(key);
+    if (def != definitions.end()) {
+        term = def->second;
+    } else if (builtin_from_name(name, b)) {
+        if (lowered(b)) {
+            ref = primitive(b);
+        } else {
+            term = builtin_terms[static_cast<size_t>(b)];
+        }
+    }
+    if (term != NO_TERM) {
+        ref = "&s" + std::to_string(function(false, term, {}));
+    } else if (ref.empty()) {
+        size_t k = free_names.size();
+        free_names.push_back(key);
+        statics << "static Obj free" << k << " = {HDR(T_FREE, 0), {.num = " << k << "}};\n";
+        ref = "&free" + std::to_string(k);
+    }
+    globals.emplace(key, ref);
+    return ref;
+}
+
+std::string CGenerator::number(uint64_t n) {
+    auto it = numbers.find(n);
+    if (it != numbers.end()) return it->second;
+    std::string name = "n" + std::to_string(n);
+    statics << "static Obj " << name << " = {HDR(T_NUM, 0), {.num = " << n << "}};\n";
+    return numbers.emplace(n, "&" + name).first->second;
+}
+
+std::string CGenerator::primitive(Builtin b) {
+    int op = primitive_op(b);
+    if (!primitives[op].empty()) return primitives[op];
+    std::string name = std::string("p_") + (PRIMITIVE_NAMES[op] + 2);
+    statics << "static Obj " << name << " = {HDR(T_PRIM, 0), {.num = " << PRIMITIVE_NAMES[op] << "}};\n";
+    primitives[op] = "&" + name;
+    // the encoding itself, for arguments that are not machine numerals
+    fallbacks[op] = "&s" + std::to_string(function(true, builtin_terms[static_cast<size_t>(b)], {}));
+    if (bools[0].empty()) {
+        Body none;
+        bools[0] = atom(builtin_terms[static_cast<size_t>(Builtin::LFALSE)], {}, none);
+        bools[1] = atom(builtin_terms[static_cast<size_t>(Builtin::LTRUE)], {}, none);
+    }
+    stats.primitives++;
+    return primitives[op];
+}
+
+NativeStats CGenerator::write(const char *label, std::ostream &out) {
+    std::vector<std::string> roots;
+    for (const auto &expr : program.expressions) {
+        Body none;
+        roots.push_back(atom(expr.term, {}, none));
+    }
+    for (size_t next = 0; next < functions.size(); next++) write_function(next);
+    stats.functions = functions.size();
+
+    out << "/* λ-calculus program lowered to C; run it to print what --eval prints. */\n";
+    out << RUNTIME_HEAD << prototypes.str() << statics.str() << code.str();
+
+    out << "\nstatic Obj *const rt_cafs[] = {";
+    for (const std::string &c : cafs) out << c << ", ";
+    out << "NULL};\nstatic const size_t rt_ncafs = " << cafs.size() << ";\n";
+    out << "static const char *const rt_free_names[] = {";
+    for (const std::string &n : free_names) out << c_string(n) << ", ";
+    out << "NULL};\nstatic Obj *const rt_fallback[P_COUNT] = {";
+    bool any = false;
+    for (int op = 0; op < PRIMITIVE_COUNT; op++) {
+        if (fallbacks[op].empty()) continue;
+        out << (any ? ", " : "") << "[" << PRIMITIVE_NAMES[op] << "] = " << fallbacks[op];
+        any = true;
+    }
+    out << (any ? "" : "NULL") << "};\n";
+    out << "static Obj *const rt_bool[2] = {" << (bools[0].empty() ? "NULL" : bools[0]) << ", "
+        << (bools[1].empty() ? "NULL" : bools[1]) << "};\n";
+
+    out << "\nstatic int rt_program(void) {\n    int failures = 0;\n";
+    for (size_t i = 0; i < roots.size(); i++) {
+        out << "    failures += rt_show(" << c_string(label) << ", " << program.expressions[i].line << ", "
+            << roots[i] << ");\n";
+    }
+    out << "    return failures;\n}\n" << RUNTIME_TAIL;
+    return stats;
+}
+
+} // namespace
+
+NativeStats write_c_program(LcProgram &program, const char *label, NativeNumerals numerals,
+                            std::ostream &out) {
+    CGenerator generator(program, numerals);
+    return generator.write(label, out);
+}
+
+bool build_native(const std::string &c_path, const std::string &exe_path, std::string &error) {
+    const char *env = std::getenv("CC");
+    std::string cc = env && *env ? env : "cc";
+    std::vector<std::string> args = {cc, "-O2", "-o", exe_path, c_path};
+    std::vector<char *> argv;
+    for (std::string &a : args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = std::string("fork failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (pid == 0) {
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) {
+        error = std::string("waitpid failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        error = "could not run " + cc + " (set CC to a C compiler)";
+        return false;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        error = cc + " failed on " + c_path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,731 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: combinator backend: bracket abstraction of the λ-term IR to S, K, I, B, C,
+*                 S', B*, C' (λ-DAG -> combinator DAG) and an in-place graph reducer
+***************************************************************************************/
+
+#include "combinators.hpp"
+#include "builtins.hpp"
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+enum Rule : uint8_t { S, K, I, B, C, S1, B1, C1, NUMERAL, RULE_COUNT };
+
+const char *const RULE_NAMES[RULE_COUNT] = {"S", "K", "I", "B", "C", "S'", "B*", "C'", "numeral"};
+const unsigned RULE_ARITY[RULE_COUNT] = {3, 2, 1, 3, 3, 4, 4, 4, 2};
+
+// Compiled terms. Comb a = Rule; Var a = depth of its binder; App a =
+// function, b = argument; Num a = value; Global a = global id. level is
+// one more than the deepest free variable, 0 for a closed term.
+enum class CombKind : uint8_t { Comb, Var, App, Num, Global };
+
+struct Comb {
+    CombKind kind;
+    uint32_t a;
+    uint32_t b;
+    bool operator==(const Comb &o) const { return kind == o.kind && a == o.a && b == o.b; }
+};
+
+struct CombHash {
+    size_t operator()(const Comb &c) const {
+        uint64_t h = (static_cast<uint64_t>(c.a) << 32) | c.b;
+        h ^= static_cast<uint64_t>(c.kind) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+constexpr uint32_t NONE = UINT32_MAX;
+
+// Runtime graph. App nodes are rewritten in place into their contractum:
+// another App, an Ind pointing at it, or an Int once a native successor
+// has counted its argument. Global is replaced by an Ind on first use.
+struct Node {
+    enum Kind : uint8_t { App, Ind, Comb, Num, Int, Succ, True, False, Pair, Global, Free } kind;
+    uint8_t rule;      // Comb
+    uint32_t id;       // Global, Free: the global id
+    uint64_t n;        // Num, Int
+    Node *a;           // App: function; Ind: target
+    Node *b;           // App: argument
+};
+
+} // namespace
+
+struct SkiProgram::Impl {
+    EvalOptions opts;
+    SkiStats stats;
+
+    std::vector<Comb> combs;
+    std::vector<uint32_t> levels;
+    std::unordered_map<Comb, uint32_t, CombHash> unique;
+
+    struct Global {
+        std::string name;
+        uint32_t root = NONE;
+        Node *node = nullptr;
+    };
+    std::vector<Global> globals;
+    std::unordered_map<std::string, uint32_t> global_ids;
+    std::vector<uint32_t> defined;      // globals in the order they were defined
+    std::vector<std::pair<uint32_t, int>> exprs;    // root, line
+    LcProgram builtin_terms;
+
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_used = BLOCK_SIZE;
+    std::vector<Node *> instances;
+    std::vector<Node *> stack;
+    struct Dump {
+        Node *node;     // the App applying the native successor
+        size_t base;
+    };
+    std::vector<Dump> dumps;
+    Node *succ_marker = nullptr, *zero_marker = nullptr, *true_marker = nullptr, *false_marker = nullptr,
+         *pair_marker = nullptr;
+
+    explicit Impl(EvalOptions o) : opts(o) {}
+
+    // --- combinator terms ---------------------------------------------
+
+    uint32_t make(CombKind kind, uint32_t a, uint32_t b = 0) {
+        Comb c{kind, a, b};
+        auto it = unique.find(c);
+        if (it != unique.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(combs.size());
+        combs.push_back(c);
+        uint32_t level = 0;
+        if (kind == CombKind::Var) level = a + 1;
+        if (kind == CombKind::App) level = std::max(levels[a], levels[b]);
+        levels.push_back(level);
+        unique.emplace(c, id);
+        return id;
+    }
+
+    uint32_t comb(Rule r) { return make(CombKind::Comb, r); }
+    uint32_t app(uint32_t f, uint32_t x) { return make(CombKind::App, f, x); }
+    uint32_t app(uint32_t f, uint32_t x, uint32_t y) { return app(app(f, x), y); }
+    uint32_t app(uint32_t f, uint32_t x, uint32_t y, uint32_t z) { return app(app(f, x, y), z); }
+
+    // x = r p
+    bool match(uint32_t x, Rule r, uint32_t &p) {
+        const Comb &c = combs[x];
+        if (c.kind != CombKind::App || combs[c.a].kind != CombKind::Comb || combs[c.a].a != r) return false;
+        p = c.b;
+        return true;
+    }
+
+    // x = r p q
+    bool match(uint32_t x, Rule r, uint32_t &p, uint32_t &q) {
+        const Comb &c = combs[x];
+        if (c.kind != CombKind::App || !match(c.a, r, p)) return false;
+        q = c.b;
+        return true;
+    }
+
+    // S a b, simplified by Turner's rules
+    uint32_t join(uint32_t a, uint32_t b) {
+        uint32_t p, q, r;
+        if (match(a, K, p)) {
+            if (match(b, K, q)) return app(comb(K), app(p, q));
+            if (b == comb(I)) return p;
+            if (match(b, B, q, r)) return app(comb(B1), p, q, r);
+            return app(comb(B), p, b);
+        }
+        if (match(b, K, q)) {
+            if (match(a, B, p, r)) return app(comb(C1), p, r, q);
+            return app(comb(C), a, q);
+        }
+        if (match(a, B, p, q)) return app(comb(S1), p, q, b);
+        return app(comb(S), a, b);
+    }
+
+    // [x]e for the variable bound at depth, which nothing in e is deeper than.
+    // Walks e with an explicit stack rather than recursing, as a term can be
+    // as deep as the program; a node is joined once both its halves are
+    // abstracted, function half first.
+    uint32_t abstract(uint32_t e, uint32_t depth) {
+        std::unordered_map<uint32_t, uint32_t> memo;
+        auto known = [&](uint32_t x) {
+            if (levels[x] <= depth) return app(comb(K), x);
+            if (combs[x].kind == CombKind::Var) return comb(I);
+            auto it = memo.find(x);
+            return it != memo.end() ? it->second : NONE;
+        };
+        uint32_t r = known(e);
+        if (r != NONE) return r;
+        std::vector<uint32_t> work = {e};
+        while (!work.empty()) {
+            uint32_t x = work.back();
+            uint32_t f = combs[x].a, arg = combs[x].b;
+            uint32_t a = known(f);
+            if (a == NONE) {
+                work.push_back(f);
+                continue;
+            }
+            uint32_t b = known(arg);
+            if (b == NONE) {
+                work.push_back(arg);
+                continue;
+            }
+            memo.emplace(x, join(a, b));
+            work.pop_back();
+        }
+        return memo.at(e);
+    }
+
+    uint32_t global_id(std::string_view name) {
+        auto it = global_ids.find(std::string(name));
+        if (it != global_ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(globals.size());
+        globals.push_back({std::string(name)});
+        global_ids.emplace(std::string(name), id);
+        return id;
+    }
+
+    // --- compilation --------------------------------------------------
+
+    // Per term, the names it leaves free. A term none of whose free names
+    // is bound where it appears compiles the same everywhere, so it is
+    // compiled once (builtin texts and numerals especially).
+    struct Compilation {
+        const TermTable &terms;
+        std::vector<std::vector<uint32_t>> free;
+        std::vector<uint32_t> memo;
+        std::vector<uint32_t> scope;
+        struct Frame {
+            TermId id;
+            bool context_free;
+            uint32_t f;     // App: the compiled function, once it is done
+        };
+        std::vector<Frame> stack{};
+    };
+
+    void free_names(Compilation &cx) {
+        const TermTable &terms = cx.terms;
+        cx.free.resize(terms.size());
+        cx.memo.assign(terms.size(), NONE);
+        for (TermId id = 0; id < terms.size(); id++) {
+            const Term &t = terms[id];
+            std::vector<uint32_t> &out = cx.free[id];
+            if (t.kind == TermKind::Var) {
+                out.push_back(t.a);
+            } else if (t.kind == TermKind::Lam) {
+                for (uint32_t s : cx.free[t.b]) {
+                    if (s != t.a) out.push_back(s);
+                }
+            } else if (t.kind == TermKind::App) {
+                const std::vector<uint32_t> &x = cx.free[t.a], &y = cx.free[t.b];
+                std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(out));
+            }
+        }
+    }
+
+    // Compiles id outright when it is a leaf or already compiled in this
+    // context; otherwise pushes its Frame (and a λ's parameter) and returns
+    // NONE.
+    uint32_t open(Compilation &cx, TermId id) {
+        const Term &t = cx.terms[id];
+        bool context_free = std::none_of(cx.free[id].begin(), cx.free[id].end(), [&](uint32_t s) {
+            return std::find(cx.scope.rbegin(), cx.scope.rend(), s) != cx.scope.rend();
+        });
+        if (context_free && cx.memo[id] != NONE) return cx.memo[id];
+        uint32_t r = NONE;
+        switch (t.kind) {
+        case TermKind::Var:
+            for (size_t k = cx.scope.size(); k-- > 0;) {
+                if (cx.scope[k] == t.a) {
+                    r = make(CombKind::Var, static_cast<uint32_t>(k));
+                    break;
+                }
+            }
+            if (r == NONE) r = make(CombKind::Global, global_id(cx.terms.name(t.a)));
+            break;
+        case TermKind::Lam:
+            cx.scope.push_back(t.a);
+            cx.stack.push_back({id, context_free, NONE});
+            return NONE;
+        case TermKind::App:
+            cx.stack.push_back({id, context_free, NONE});
+            return NONE;
+        case TermKind::Const:
+            r = make(CombKind::Global, global_id(builtin_name(static_cast<Builtin>(t.a))));
+            break;
+        case TermKind::Num:
+            r = make(CombKind::Num, t.a);
+            break;
+        }
+        if (context_free) cx.memo[id] = r;
+        return r;
+    }
+
+    // Compiles without recursion: every Lam or App still waiting on a
+    // subterm is a Frame on an explicit stack, so nesting depth is bounded
+    // by memory rather than the native stack. Subterms are compiled in the
+    // order a recursive walk would take, function before argument.
+    uint32_t compile(Compilation &cx, TermId id) {
+        uint32_t r = open(cx, id);
+        for (;;) {
+            while (r == NONE) {
+                const Term &t = cx.terms[cx.stack.back().id];
+                r = open(cx, t.kind == TermKind::Lam ? t.b : t.a);
+            }
+            for (;;) {
+                if (cx.stack.empty()) return r;
+                Compilation::Frame &top = cx.stack.back();
+                const Term &t = cx.terms[top.id];
+                if (t.kind == TermKind::Lam) {
+                    cx.scope.pop_back();
+                    r = abstract(r, static_cast<uint32_t>(cx.scope.size()));
+                } else if (top.f == NONE) {
+                    top.f = r;
+                    r = open(cx, t.b);
+                    break;
+                } else {
+                    r = app(top.f, r);
+                }
+                if (top.context_free) cx.memo[top.id] = r;
+                cx.stack.pop_back();
+            }
+        }
+    }
+
+    void define(uint32_t global, uint32_t root) {
+        if (globals[global].root == NONE) defined.push_back(global);
+        globals[global].root = root;
+    }
+
+    void compile_program(const LcProgram &program) {
+        Compilation cx{program.terms, {}, {}, {}};
+        free_names(cx);
+        for (const LcDefinition &def : program.definitions) define(global_id(def.name), compile(cx, def.term));
+        for (const LcExpression &e : program.expressions) exprs.push_back({compile(cx, e.term), e.line});
+
+        // names nothing defines fall back to the builtin of that name, whose
+        // text can refer to further builtins
+        for (size_t g = 0; g < globals.size(); g++) {
+            Builtin b;
+            if (globals[g].root != NONE || !builtin_from_name(globals[g].name, b)) continue;
+            size_t first = builtin_terms.expressions.size();
+            read_lc(builtin_text(b), builtin_terms);
+            Compilation bx{builtin_terms.terms, {}, {}, {}};
+            free_names(bx);
+            define(static_cast<uint32_t>(g), compile(bx, builtin_terms.expressions[first].term));
+        }
+    }
+
+    // --- .ski text ----------------------------------------------------
+
+    void write(std::ostream &out) {
+        std::vector<uint32_t> refs(combs.size(), 0);
+        std::vector<bool> seen(combs.size(), false);
+        std::vector<uint32_t> pending;
+        auto root = [&](uint32_t id) {
+            refs[id]++;
+            pending.push_back(id);
+        };
+        for (uint32_t g : defined) root(globals[g].root);
+        for (const auto &e : exprs) root(e.first);
+        size_t reachable = 0;
+        while (!pending.empty()) {
+            uint32_t id = pending.back();
+            pending.pop_back();
+            if (seen[id]) continue;
+            seen[id] = true;
+            reachable++;
+            if (combs[id].kind == CombKind::App) {
+                for (uint32_t child : {combs[id].a, combs[id].b}) {
+                    refs[child]++;
+                    pending.push_back(child);
+                }
+            }
+        }
+
+        // a term used more than once is named when writing it out in full
+        // would cost more than the name; ids put children before parents
+        std::vector<uint64_t> length(combs.size(), 0);
+        std::vector<uint32_t> names(combs.size(), NONE);
+        std::vector<uint32_t> hoisted;
+        constexpr uint64_t NAME_LENGTH = 6;
+        auto length_of = [&](uint32_t id) { return names[id] != NONE ? NAME_LENGTH : length[id]; };
+        for (uint32_t id = 0; id < combs.size(); id++) {
+            if (!seen[id]) continue;
+            const Comb &c = combs[id];
+            if (c.kind != CombKind::App) {
+                length[id] = atom(id).size();
+                continue;
+            }
+            bool paren = combs[c.b].kind == CombKind::App && names[c.b] == NONE;
+            length[id] = std::min<uint64_t>(length_of(c.a) + length_of(c.b) + 1 + (paren ? 2 : 0), UINT64_MAX / 4);
+            if (refs[id] >= 2 && length[id] > 2 * NAME_LENGTH) {
+                names[id] = static_cast<uint32_t>(hoisted.size());
+                hoisted.push_back(id);
+            }
+        }
+        stats.nodes = reachable;
+        stats.shared = hoisted.size();
+
+        std::string line;
+        for (uint32_t id : hoisted) {
+            line = "_" + std::to_string(names[id]) + " := ";
+            print(id, names, line);
+            out << line << '\n';
+        }
+        for (uint32_t g : defined) {
+            line = globals[g].name + " := ";
+            print(globals[g].root, names, line);
+            out << line << '\n';
+        }
+        for (const auto &e : exprs) {
+            line.clear();
+            print(e.first, names, line);
+            out << line << '\n';
+        }
+    }
+
+    std::string atom(uint32_t id) const {
+        const Comb &c = combs[id];
+        switch (c.kind) {
+        case CombKind::Comb: return RULE_NAMES[c.a];
+        case CombKind::Num: return std::to_string(c.a);
+        case CombKind::Global: return globals[c.a].name;
+        default: return "?";
+        }
+    }
+
+    // Application is left-nested, so only an argument that is itself an
+    // application needs parentheses. Walks with a stack rather than
+    // recursing, as a spine can be as long as the program.
+    void print(uint32_t top, const std::vector<uint32_t> &names, std::string &out) const {
+        struct Item {
+            uint32_t id;
+            uint8_t state;
+            bool paren;
+        };
+        std::vector<Item> work = {{top, 0, false}};
+        while (!work.empty()) {
+            Item &item = work.back();
+            const Comb &c = combs[item.id];
+            if (item.id != top && names[item.id] != NONE) {
+                out += "_" + std::to_string(names[item.id]);
+                work.pop_back();
+            } else if (c.kind != CombKind::App) {
+                out += atom(item.id);
+                work.pop_back();
+            } else if (item.state == 0) {
+                if (item.paren) out += '(';
+                item.state = 1;
+                work.push_back({c.a, 0, false});
+            } else if (item.state == 1) {
+                out += ' ';
+                item.state = 2;
+                bool paren = combs[c.b].kind == CombKind::App && (c.b == top || names[c.b] == NONE);
+                work.push_back({c.b, 0, paren});
+            } else {
+                if (item.paren) out += ')';
+                work.pop_back();
+            }
+        }
+    }
+
+    // --- heap ---------------------------------------------------------
+
+    Node *alloc(Node::Kind kind) {
+        size_t n = sizeof(Node);
+        if (block_used + n > BLOCK_SIZE) {
+            if ((blocks.size() + 1) * BLOCK_SIZE > opts.max_heap_bytes) {
+                throw EvalError("heap limit of " + std::to_string(opts.max_heap_bytes >> 20) + " MB exhausted");
+            }
+            blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            block_used = 0;
+        }
+        void *p = blocks.back().get() + block_used;
+        block_used += n;
+        stats.heap_bytes += n;
+        return new (p) Node{kind, 0, 0, 0, nullptr, nullptr};
+    }
+
+    Node *make_app(Node *f, Node *x) {
+        Node *n = alloc(Node::App);
+        n->a = f;
+        n->b = x;
+        return n;
+    }
+
+    Node *make_value(Node::Kind kind, uint64_t n = 0) {
+        Node *v = alloc(kind);
+        v->n = n;
+        return v;
+    }
+
+    // One node per combinator term, built the first time anything is
+    // reduced; ids put children first.
+    void instantiate() {
+        if (!instances.empty() || combs.empty()) return;
+        succ_marker = make_value(Node::Succ);
+        zero_marker = make_value(Node::Int, 0);
+        true_marker = make_value(Node::True);
+        false_marker = make_value(Node::False);
+        pair_marker = make_value(Node::Pair);
+        instances.resize(combs.size());
+        for (uint32_t id = 0; id < combs.size(); id++) {
+            const Comb &c = combs[id];
+            Node *n = nullptr;
+            switch (c.kind) {
+            case CombKind::Comb:
+                n = alloc(Node::Comb);
+                n->rule = static_cast<uint8_t>(c.a);
+                break;
+            case CombKind::Var:
+                break;      // abstracted away everywhere it can be reached
+            case CombKind::App:
+                n = make_app(instances[c.a], instances[c.b]);
+                break;
+            case CombKind::Num:
+                n = make_value(Node::Num, c.a);
+                break;
+            case CombKind::Global:
+                n = alloc(Node::Global);
+                n->id = c.a;
+                break;
+            }
+            instances[id] = n;
+        }
+    }
+
+    // --- reduction ----------------------------------------------------
+
+    Node *follow(Node *n) {
+        for (size_t hops = 0; n->kind == Node::Ind; hops++) {
+            if (hops > (size_t(1) << 24)) throw EvalError("infinite loop: a value depends on itself");
+            n = n->a;
+        }
+        return n;
+    }
+
+    [[noreturn]] void stuck(const Node *head) {
+        switch (head->kind) {
+        case Node::Free:
+            throw EvalError("free variable '" + globals[head->id].name + "' applied to an argument");
+        case Node::Int:
+            throw EvalError("a native number was applied to an argument");
+        default:
+            throw EvalError("stuck: a readback marker was used as a function");
+        }
+    }
+
+    struct Whnf {
+        Node *head;
+        size_t argc;
+        Node *args[2];
+    };
+
+    // Reduces root to weak head normal form in place.
+    Whnf reduce(Node *root) {
+        stack.clear();
+        dumps.clear();
+        size_t base = 0;
+        uint64_t limit = stats.rewrites + opts.max_steps;
+        Node *n = root;
+        for (;;) {
+            n = follow(n);
+            if (n->kind == Node::App) {
+                if (stack.size() >= (size_t(1) << 28)) throw EvalError("infinite loop: a value depends on itself");
+                stack.push_back(n);
+                // shortcut indirections so chains of them are walked once
+                n->a = follow(n->a);
+                n = n->a;
+                continue;
+            }
+            size_t avail = stack.size() - base;
+            auto arg = [&](size_t i) { return stack[stack.size() - 1 - i]->b; };
+
+            if (n->kind == Node::Global) {
+                Global &g = globals[n->id];
+                if (!g.node) {
+                    if (g.root != NONE) {
+                        g.node = instances[g.root];
+                    } else {
+                        g.node = alloc(Node::Free);
+                        g.node->id = n->id;
+                    }
+                }
+                if (follow(g.node) == n) throw EvalError("infinite loop: a value depends on itself");
+                n->kind = Node::Ind;
+                n->a = g.node;
+                continue;
+            }
+            unsigned rule = n->kind == Node::Num ? unsigned(NUMERAL) : n->rule;
+            if ((n->kind == Node::Comb || n->kind == Node::Num) && avail >= RULE_ARITY[rule]) {
+                unsigned arity = RULE_ARITY[rule];
+                if (++stats.rewrites > limit) {
+                    throw EvalError("step budget of " + std::to_string(opts.max_steps) + " exhausted");
+                }
+                stats.rule_counts[rule]++;
+                Node *r = stack[stack.size() - arity];
+                Node *x = arg(0), *y = arity > 1 ? arg(1) : nullptr, *z = arity > 2 ? arg(2) : nullptr;
+                Node *w = arity > 3 ? arg(3) : nullptr;
+                auto indirect = [&](Node *target) {
+                    target = follow(target);
+                    if (target == r) throw EvalError("infinite loop: a value depends on itself");
+                    r->kind = Node::Ind;
+                    r->a = target;
+                    r->b = nullptr;
+                };
+                switch (rule) {
+                case I: indirect(x); break;
+                case K: indirect(x); break;
+                case S: r->a = make_app(x, z); r->b = make_app(y, z); break;
+                case B: r->a = x; r->b = make_app(y, z); break;
+                case C: r->a = make_app(x, z); r->b = y; break;
+                case S1: r->a = make_app(x, make_app(y, w)); r->b = make_app(z, w); break;
+                case B1: r->a = x; r->b = make_app(y, make_app(z, w)); break;
+                case C1: r->a = make_app(x, make_app(y, w)); r->b = z; break;
+                case NUMERAL:
+                    if (n->n == 0) {
+                        indirect(y);
+                    } else {
+                        r->a = x;
+                        r->b = make_app(make_app(make_value(Node::Num, n->n - 1), x), y);
+                    }
+                    break;
+                }
+                stack.resize(stack.size() - arity);
+                n = r;
+                continue;
+            }
+            if (n->kind == Node::Succ && avail >= 1) {
+                // count the argument first, then overwrite this application with it plus one
+                Node *r = stack.back();
+                stack.pop_back();
+                dumps.push_back({r, base});
+                base = stack.size();
+                n = r->b;
+                continue;
+            }
+            bool value = n->kind == Node::Comb || n->kind == Node::Num || n->kind == Node::Succ ||
+                         (n->kind == Node::Pair && avail <= 2) || avail == 0;
+            if (!value) stuck(n);
+            if (dumps.empty()) {
+                Whnf result{n, avail, {nullptr, nullptr}};
+                if (avail >= 1) result.args[0] = arg(0);
+                if (avail >= 2) result.args[1] = arg(1);
+                return result;
+            }
+            if (n->kind != Node::Int || avail != 0) throw EvalError("native successor applied to a non-number");
+            Dump d = dumps.back();
+            dumps.pop_back();
+            d.node->kind = Node::Int;
+            d.node->n = n->n + 1;
+            d.node->a = d.node->b = nullptr;
+            base = d.base;
+            n = d.node;
+        }
+    }
+
+    // --- readback -----------------------------------------------------
+
+    bool attempt(Node *t, std::initializer_list<Node *> args, Whnf &out) {
+        for (Node *a : args) t = make_app(t, a);
+        try {
+            out = reduce(t);
+            return true;
+        } catch (const EvalError &) {
+            return false;
+        }
+    }
+
+    static bool is_function(const Whnf &w) {
+        if (w.head->kind == Node::Comb) return w.argc < RULE_ARITY[w.head->rule];
+        return w.head->kind == Node::Num;
+    }
+
+    bool is_nil(Node *t) {
+        // NIL = λx.TRUE, so NIL p t f gives t for any p
+        Whnf r;
+        return attempt(t, {pair_marker, true_marker, false_marker}, r) && r.head->kind == Node::True && r.argc == 0;
+    }
+
+    bool as_pair(Node *t, Whnf &r) {
+        return attempt(t, {pair_marker}, r) && r.head->kind == Node::Pair && r.argc == 2;
+    }
+
+    std::string readback(Node *t) {
+        Whnf w;
+        try {
+            w = reduce(t);
+        } catch (const EvalError &e) {
+            return std::string("<error: ") + e.what() + ">";
+        }
+        return readback(t, w);
+    }
+
+    std::string readback(Node *t, const Whnf &w) {
+        if (w.head->kind == Node::Free && w.argc == 0) return "<free " + globals[w.head->id].name + ">";
+        if (!is_function(w)) return "<marker>";
+
+        Whnf r;
+        if (attempt(t, {succ_marker, zero_marker}, r) && r.head->kind == Node::Int && r.argc == 0) {
+            return r.head->n == 0 ? "0/false" : std::to_string(r.head->n);
+        }
+        if (attempt(t, {true_marker, false_marker}, r) && r.argc == 0) {
+            if (r.head->kind == Node::True) return "true";
+            if (r.head->kind == Node::False) return "false";
+        }
+        if (is_nil(t)) return "()";
+
+        Whnf p;
+        if (!as_pair(t, p)) return "<function>";
+        std::string out = "(";
+        for (;;) {
+            Node *head = p.args[0], *rest = p.args[1];
+            out += readback(head);
+            if (is_nil(rest)) break;
+            if (!as_pair(rest, p)) {
+                out += " . " + readback(rest);
+                break;
+            }
+            out += ' ';
+        }
+        return out + ")";
+    }
+};
+
+SkiProgram::SkiProgram(EvalOptions opts) : m(std::make_unique<Impl>(opts)) {}
+
+SkiProgram::~SkiProgram() = default;
+
+void SkiProgram::compile(const LcProgram &program) {
+    m->compile_program(program);
+}
+
+void SkiProgram::write(std::ostream &out) {
+    m->write(out);
+}
+
+size_t SkiProgram::expressions() const {
+    return m->exprs.size();
+}
+
+std::string SkiProgram::evaluate(size_t i) {
+    m->instantiate();
+    Node *t = m->instances[m->exprs[i].first];
+    Impl::Whnf w = m->reduce(t);
+    return m->readback(t, w);
+}
+
+const SkiStats &SkiProgram::stats() const {
+    return m->stats;
+}
+
+const char *SkiProgram::rule_name(size_t rule) {
+    return rule < RULE_COUNT ? RULE_NAMES[rule] : "?";
+}
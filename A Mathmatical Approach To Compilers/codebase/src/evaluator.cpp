@@ -0,0 +1,469 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: call-by-need evaluator for the λ-term IR (λ-DAG -> values)
+***************************************************************************************/
+
+#include "evaluator.hpp"
+#include "lc_reader.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// de Bruijn code. Var a = index; Global a = global id; Lam a = body;
+// App a = function, b = argument. Code is immutable once built and shared
+// freely, e.g. every occurrence of a numeral uses the same nodes.
+enum class CodeKind : uint8_t { Var, Global, Lam, App };
+
+struct Code {
+    CodeKind kind;
+    uint32_t a;
+    uint32_t b;
+};
+
+constexpr uint32_t NO_CODE = UINT32_MAX;
+
+struct Env;
+struct Value;
+
+// A suspended (code, env) pair. value is set by the first evaluation and
+// every later use takes it from there; active marks a thunk that is being
+// evaluated, so forcing it again means it depends on itself.
+struct Thunk {
+    uint32_t code;
+    bool active;
+    Env *env;
+    Value *value;
+};
+
+struct Env {
+    Thunk *head;
+    Env *next;
+};
+
+// Weak head normal forms. Succ, True, False and Pair are the native
+// markers used for readback; Free is a name nothing defines.
+struct Value {
+    enum Kind : uint8_t { Closure, Int, Succ, True, False, Pair, Free } kind;
+    uint8_t argc;
+    uint32_t code;     // Closure: the Lam node; Free: the global id
+    Env *env;
+    uint64_t n;        // Int
+    Thunk *args[2];    // Pair
+};
+
+struct Frame {
+    enum Kind : uint8_t { Arg, Update, AddOne } kind;
+    Thunk *t;
+};
+
+} // namespace
+
+struct Evaluator::Machine {
+    EvalOptions opts;
+    EvalStats stats;
+
+    std::vector<Code> codes;
+    std::unordered_map<uint32_t, uint32_t> numerals;
+
+    struct Global {
+        std::string name;
+        uint32_t code = NO_CODE;
+        Thunk *thunk = nullptr;
+    };
+    std::vector<Global> globals;
+    std::unordered_map<std::string, uint32_t> global_ids;
+    LcProgram builtin_terms;
+
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_used = BLOCK_SIZE;
+
+    std::vector<Frame> stack;
+    Thunk *succ_marker, *zero_marker, *true_marker, *false_marker, *pair_marker;
+
+    explicit Machine(EvalOptions o) : opts(o) {
+        succ_marker = evaluated(make_value(Value::Succ));
+        zero_marker = evaluated(make_int(0));
+        true_marker = evaluated(make_value(Value::True));
+        false_marker = evaluated(make_value(Value::False));
+        pair_marker = evaluated(make_value(Value::Pair));
+    }
+
+    // --- heap ---------------------------------------------------------
+
+    template <typename T> T *alloc() {
+        size_t n = (sizeof(T) + 7) & ~size_t(7);
+        if (block_used + n > BLOCK_SIZE) {
+            if ((blocks.size() + 1) * BLOCK_SIZE > opts.max_heap_bytes) {
+                throw EvalError("heap limit of " + std::to_string(opts.max_heap_bytes >> 20) +
+                                " MB exhausted");
+            }
+            blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            block_used = 0;
+        }
+        void *p = blocks.back().get() + block_used;
+        block_used += n;
+        stats.heap_bytes += n;
+        return static_cast<T *>(p);
+    }
+
+    Thunk *make_thunk(uint32_t code, Env *env) {
+        stats.thunks++;
+        return new (alloc<Thunk>()) Thunk{code, false, env, nullptr};
+    }
+
+    Thunk *evaluated(Value *v) {
+        Thunk *t = make_thunk(NO_CODE, nullptr);
+        t->value = v;
+        return t;
+    }
+
+    Env *bind(Thunk *t, Env *next) {
+        stats.env_cells++;
+        return new (alloc<Env>()) Env{t, next};
+    }
+
+    Value *make_value(Value::Kind kind) {
+        stats.values++;
+        return new (alloc<Value>()) Value{kind, 0, 0, nullptr, 0, {nullptr, nullptr}};
+    }
+
+    Value *make_int(uint64_t n) {
+        Value *v = make_value(Value::Int);
+        v->n = n;
+        return v;
+    }
+
+    // --- compilation --------------------------------------------------
+
+    uint32_t emit(CodeKind kind, uint32_t a, uint32_t b = 0) {
+        codes.push_back({kind, a, b});
+        return static_cast<uint32_t>(codes.size() - 1);
+    }
+
+    uint32_t global_id(std::string_view name) {
+        auto it = global_ids.find(std::string(name));
+        if (it != global_ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(globals.size());
+        globals.push_back({std::string(name)});
+        global_ids.emplace(std::string(name), id);
+        return id;
+    }
+
+    // λf.λx.f (f ... x), built once per value
+    uint32_t numeral(uint32_t n) {
+        auto it = numerals.find(n);
+        if (it != numerals.end()) return it->second;
+        uint32_t f = emit(CodeKind::Var, 1);
+        uint32_t body = emit(CodeKind::Var, 0);
+        for (uint32_t i = 0; i < n; i++) body = emit(CodeKind::App, f, body);
+        uint32_t code = emit(CodeKind::Lam, emit(CodeKind::Lam, body));
+        numerals.emplace(n, code);
+        return code;
+    }
+
+    // Compiles without recursion, so a term's depth is bounded by memory
+    // rather than the native stack: every Lam or App whose children are
+    // still being compiled waits on an explicit stack, and finished code is
+    // handed up through a second one. Children are compiled function first,
+    // so the code comes out in the same order a recursive walk would emit.
+    uint32_t compile(const TermTable &terms, TermId root) {
+        struct Pending {
+            TermId id;
+            bool expanded;
+        };
+        std::vector<uint32_t> scope;
+        std::vector<Pending> work{{root, false}};
+        std::vector<uint32_t> done;
+        while (!work.empty()) {
+            Pending p = work.back();
+            work.pop_back();
+            const Term &t = terms[p.id];
+            if (p.expanded) {
+                if (t.kind == TermKind::Lam) {
+                    scope.pop_back();
+                    done.back() = emit(CodeKind::Lam, done.back());
+                } else {
+                    uint32_t x = done.back();
+                    done.pop_back();
+                    done.back() = emit(CodeKind::App, done.back(), x);
+                }
+                continue;
+            }
+            switch (t.kind) {
+            case TermKind::Var:
+                done.push_back(variable(terms, t.a, scope));
+                break;
+            case TermKind::Lam:
+                scope.push_back(t.a);
+                work.push_back({p.id, true});
+                work.push_back({t.b, false});
+                break;
+            case TermKind::App:
+                work.push_back({p.id, true});
+                work.push_back({t.b, false});
+                work.push_back({t.a, false});
+                break;
+            case TermKind::Const:
+                done.push_back(emit(CodeKind::Global, global_id(builtin_name(static_cast<Builtin>(t.a)))));
+                break;
+            case TermKind::Num:
+                done.push_back(numeral(t.a));
+                break;
+            }
+        }
+        return done.back();
+    }
+
+    uint32_t variable(const TermTable &terms, uint32_t sym, const std::vector<uint32_t> &scope) {
+        for (size_t k = scope.size(); k-- > 0;) {
+            if (scope[k] == sym) return emit(CodeKind::Var, static_cast<uint32_t>(scope.size() - 1 - k));
+        }
+        return emit(CodeKind::Global, global_id(terms.name(sym)));
+    }
+
+    // Globals are resolved on first use, so definitions may refer to names
+    // defined after them. A name with no definition falls back to the
+    // builtin of that name, and failing that evaluates to a Free marker.
+    Thunk *global_thunk(uint32_t id) {
+        if (globals[id].thunk) return globals[id].thunk;
+        Builtin b;
+        if (globals[id].code == NO_CODE && builtin_from_name(globals[id].name, b)) {
+            size_t first = builtin_terms.expressions.size();
+            read_lc(builtin_text(b), builtin_terms);
+            // compiling can add globals, so no reference into globals is held
+            uint32_t code = compile(builtin_terms.terms, builtin_terms.expressions[first].term);
+            globals[id].code = code;
+        }
+        Global &g = globals[id];
+        if (g.code == NO_CODE) {
+            Value *v = make_value(Value::Free);
+            v->code = id;
+            g.thunk = evaluated(v);
+        } else {
+            g.thunk = make_thunk(g.code, nullptr);
+        }
+        return g.thunk;
+    }
+
+    // --- reduction ----------------------------------------------------
+
+    Thunk *argument(uint32_t code, Env *env) {
+        const Code c = codes[code];
+        if (c.kind == CodeKind::Var) {
+            Env *e = env;
+            for (uint32_t k = c.a; k > 0; k--) e = e->next;
+            return e->head;
+        }
+        if (c.kind == CodeKind::Global) return global_thunk(c.a);
+        return make_thunk(code, env);
+    }
+
+    [[noreturn]] void stuck(const Value *v) {
+        switch (v->kind) {
+        case Value::Free:
+            throw EvalError("free variable '" + globals[v->code].name + "' applied to an argument");
+        case Value::Int:
+            throw EvalError("a native number was applied to an argument");
+        default:
+            throw EvalError("stuck: a readback marker was used as a function");
+        }
+    }
+
+    // Forces t applied to args (outermost first) to weak head normal form.
+    Value *run(Thunk *t, std::initializer_list<Thunk *> args) {
+        stack.clear();
+        for (auto it = args.end(); it != args.begin();) {
+            stack.push_back({Frame::Arg, *--it});
+        }
+        uint64_t limit = stats.steps + opts.max_steps;
+        Value *v = nullptr;
+        uint32_t code = NO_CODE;
+        Env *env = nullptr;
+
+        auto enter = [&](Thunk *th) {
+            if (th->value) {
+                v = th->value;
+                return false;
+            }
+            if (th->active) throw EvalError("infinite loop: a value depends on itself");
+            th->active = true;
+            stack.push_back({Frame::Update, th});
+            code = th->code;
+            env = th->env;
+            return true;
+        };
+        auto beta = [&](Thunk *arg, Env *closure_env, uint32_t body) {
+            if (++stats.steps > limit) {
+                throw EvalError("step budget of " + std::to_string(opts.max_steps) + " exhausted");
+            }
+            env = bind(arg, closure_env);
+            code = body;
+        };
+
+        try {
+            bool evaluating = enter(t);
+            for (;;) {
+                if (evaluating) {
+                    // by value: resolving a global can compile more code
+                    const Code c = codes[code];
+                    switch (c.kind) {
+                    case CodeKind::Var: {
+                        Env *e = env;
+                        for (uint32_t k = c.a; k > 0; k--) e = e->next;
+                        evaluating = enter(e->head);
+                        break;
+                    }
+                    case CodeKind::Global:
+                        evaluating = enter(global_thunk(c.a));
+                        break;
+                    case CodeKind::App: {
+                        Thunk *arg = argument(c.b, env);
+                        stack.push_back({Frame::Arg, arg});
+                        code = c.a;
+                        break;
+                    }
+                    case CodeKind::Lam:
+                        // a λ meeting its argument reduces without allocating a closure
+                        if (!stack.empty() && stack.back().kind == Frame::Arg) {
+                            Thunk *arg = stack.back().t;
+                            stack.pop_back();
+                            beta(arg, env, c.a);
+                        } else {
+                            v = make_value(Value::Closure);
+                            v->code = code;
+                            v->env = env;
+                            evaluating = false;
+                        }
+                        break;
+                    }
+                    continue;
+                }
+
+                if (stack.empty()) return v;
+                Frame f = stack.back();
+                stack.pop_back();
+                switch (f.kind) {
+                case Frame::Update:
+                    f.t->value = v;
+                    f.t->active = false;
+                    stats.updates++;
+                    break;
+                case Frame::AddOne:
+                    if (v->kind != Value::Int) throw EvalError("native successor applied to a non-number");
+                    v = make_int(v->n + 1);
+                    break;
+                case Frame::Arg:
+                    if (v->kind == Value::Closure) {
+                        beta(f.t, v->env, codes[v->code].a);
+                        evaluating = true;
+                    } else if (v->kind == Value::Succ) {
+                        stack.push_back({Frame::AddOne, nullptr});
+                        evaluating = enter(f.t);
+                    } else if (v->kind == Value::Pair && v->argc < 2) {
+                        Value *p = make_value(Value::Pair);
+                        p->args[0] = v->args[0];
+                        p->argc = static_cast<uint8_t>(v->argc + 1);
+                        p->args[v->argc] = f.t;
+                        v = p;
+                    } else {
+                        stuck(v);
+                    }
+                    break;
+                }
+            }
+        } catch (...) {
+            // thunks left half-evaluated can be forced again by a later run
+            for (const Frame &f : stack) {
+                if (f.kind == Frame::Update) f.t->active = false;
+            }
+            stack.clear();
+            throw;
+        }
+    }
+
+    // --- readback -----------------------------------------------------
+
+    Value *attempt(Thunk *t, std::initializer_list<Thunk *> args) {
+        try {
+            return run(t, args);
+        } catch (const EvalError &) {
+            return nullptr;
+        }
+    }
+
+    bool is_nil(Thunk *t) {
+        // NIL = λx.TRUE, so NIL p t f gives t for any p
+        Value *r = attempt(t, {pair_marker, true_marker, false_marker});
+        return r && r->kind == Value::True;
+    }
+
+    Value *as_pair(Thunk *t) {
+        Value *r = attempt(t, {pair_marker});
+        return r && r->kind == Value::Pair && r->argc == 2 ? r : nullptr;
+    }
+
+    std::string readback(Thunk *t) {
+        Value *v;
+        try {
+            v = run(t, {});
+        } catch (const EvalError &e) {
+            return std::string("<error: ") + e.what() + ">";
+        }
+        return readback(t, v);
+    }
+
+    std::string readback(Thunk *t, Value *v) {
+        if (v->kind == Value::Free) return "<free " + globals[v->code].name + ">";
+        if (v->kind != Value::Closure) return "<marker>";
+
+        Value *r = attempt(t, {succ_marker, zero_marker});
+        if (r && r->kind == Value::Int) {
+            return r->n == 0 ? "0/false" : std::to_string(r->n);
+        }
+        r = attempt(t, {true_marker, false_marker});
+        if (r && r->kind == Value::True) return "true";
+        if (r && r->kind == Value::False) return "false";
+        if (is_nil(t)) return "()";
+
+        Value *p = as_pair(t);
+        if (!p) return "<function>";
+        std::string out = "(";
+        for (;;) {
+            out += readback(p->args[0]);
+            Thunk *rest = p->args[1];
+            if (is_nil(rest)) break;
+            p = as_pair(rest);
+            if (!p) {
+                out += " . " + readback(rest);
+                break;
+            }
+            out += ' ';
+        }
+        return out + ")";
+    }
+};
+
+Evaluator::Evaluator(EvalOptions opts) : m(std::make_unique<Machine>(opts)) {}
+
+Evaluator::~Evaluator() = default;
+
+void Evaluator::define(std::string_view name, const TermTable &terms, TermId root) {
+    uint32_t id = m->global_id(name);
+    uint32_t code = m->compile(terms, root);
+    m->globals[id].code = code;
+    m->globals[id].thunk = nullptr;
+}
+
+std::string Evaluator::evaluate(const TermTable &terms, TermId root) {
+    Thunk *t = m->make_thunk(m->compile(terms, root), nullptr);
+    Value *v = m->run(t, {});
+    return m->readback(t, v);
+}
+
+const EvalStats &Evaluator::stats() const {
+    return m->stats;
+}
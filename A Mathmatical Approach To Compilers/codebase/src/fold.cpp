@@ -0,0 +1,382 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: constant folding over the parsed program (AST -> smaller AST)
+***************************************************************************************/
+
+#include "fold.hpp"
+#include "translator.hpp"
+#include <atomic>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+static std::atomic<size_t> folded_total{0};
+
+namespace {
+
+struct Const {
+    bool is_bool;
+    uint64_t v;   // the number, or 0/1 for a boolean
+};
+using MaybeConst = std::optional<Const>;
+
+// Mutable views over the two AST representations, mirroring the read-only
+// ones in translator.cpp.
+struct SExprRef {
+    SExpr *e;
+    bool is_atom() const { return e->is_atom; }
+    std::string_view atom() const { return e->atom; }
+    size_t size() const { return e->list.size(); }
+    SExprRef operator[](size_t i) const { return {e->list[i].get()}; }
+
+    void set_atom(const std::string &text) {
+        e->is_atom = true;
+        e->atom = text;
+        e->list.clear();
+    }
+    void become_child(size_t i) {
+        std::shared_ptr<SExpr> child = e->list[i];
+        SExpr moved = std::move(*child);
+        *e = std::move(moved);
+    }
+    void erase_child(size_t i) { e->list.erase(e->list.begin() + static_cast<std::ptrdiff_t>(i)); }
+};
+
+struct ArenaRef {
+    AstArena *a;
+    AstArena::Id id;
+    bool is_atom() const { return (*a)[id].is_atom; }
+    std::string_view atom() const { return a->atom(id); }
+    size_t size() const { return (*a)[id].count; }
+    ArenaRef operator[](size_t i) const { return {a, a->child(id, static_cast<uint32_t>(i))}; }
+
+    void set_atom(const std::string &text) { a->replace(id, a->make_atom(text)); }
+    void become_child(size_t i) { a->replace(id, (*a)[a->child(id, static_cast<uint32_t>(i))]); }
+    void erase_child(size_t i) { a->erase_child(id, static_cast<uint32_t>(i)); }
+};
+
+MaybeConst literal(std::string_view a) {
+    if (a == "true" || a == "TRUE") return Const{true, 1};
+    if (a == "false" || a == "FALSE") return Const{true, 0};
+    if (a.empty()) return std::nullopt;
+    uint64_t v = 0;
+    for (char c : a) {
+        if (c < '0' || c > '9') return std::nullopt;
+        uint64_t d = static_cast<uint64_t>(c - '0');
+        if (v > (UINT64_MAX - d) / 10) return std::nullopt;
+        v = v * 10 + d;
+    }
+    return Const{false, v};
+}
+
+std::string text(const Const &c) {
+    if (c.is_bool) return c.v ? "true" : "false";
+    return std::to_string(c.v);
+}
+
+bool is_num(const MaybeConst &c) { return c && !c->is_bool; }
+bool is_bool(const MaybeConst &c) { return c && c->is_bool; }
+
+// Forms whose head is syntax rather than a variable, so a let-bound
+// constant of the same name is never substituted into the head.
+bool is_keyword(std::string_view h) {
+    static const std::string_view KEYWORDS[] = {
+        "+", "*", "-", "/", "=", "eq", "<", ">", "<=", "leq", ">=", "geq",
+        "and", "or", "not", "lambda", "λ", "let", "if", "cons", "car", "head",
+        "cdr", "tail", "null?", "nil?", "pair", "first", "fst", "second", "snd",
+        "rec", "recursive", "succ", "pred", "zero?",
+    };
+    for (std::string_view k : KEYWORDS) {
+        if (h == k) return true;
+    }
+    return false;
+}
+
+// Forms are folded without recursion, as translator.cpp lowers them: every
+// open list is a Frame on an explicit stack and each child's value is
+// handed back to its parent's frame, so nesting depth is bounded by memory.
+enum class Form : uint8_t {
+    Children,   // an application: every element folded, nothing computed
+    Operator,   // a keyword applied to arguments, computed once all are folded
+    Lambda,     // the body folded with the parameters shadowing constants
+    Let,        // each binding value in turn, then the body
+};
+
+template <typename Node>
+struct Frame {
+    Node n;
+    Form form;
+    size_t step = 0;        // children folded so far
+    size_t mark = 0;        // scope size before the form's bindings
+    std::vector<MaybeConst> args{};     // Operator: the arguments; Let: the body
+    std::vector<bool> constant{};       // Let: which bindings were constant
+};
+
+template <typename Node>
+class Folder {
+public:
+    size_t folded = 0;
+
+    MaybeConst fold(Node n) {
+        std::vector<Frame<Node>> stack;
+        for (;;) {
+            // descend to the next atom, or list with nothing to fold, opening frames
+            MaybeConst value;
+            if (n.is_atom()) {
+                value = fold_atom(n);
+            } else if (open_list(n, stack)) {
+                if (next_child(stack.back(), n)) continue;
+                value = finish(stack.back());
+                stack.pop_back();
+            }
+            // hand the value up until some frame still has a child to fold
+            for (;;) {
+                if (stack.empty()) return value;
+                Frame<Node> &f = stack.back();
+                accept_child(f, value);
+                if (next_child(f, n)) break;
+                value = finish(f);
+                stack.pop_back();
+            }
+        }
+    }
+
+private:
+    // innermost binding last; a non-constant entry shadows outer constants
+    std::vector<std::pair<std::string, MaybeConst>> scope;
+
+    MaybeConst fold_atom(Node n) {
+        MaybeConst c = literal(n.atom());
+        if (c) return c;
+        for (size_t k = scope.size(); k-- > 0;) {
+            if (scope[k].first != n.atom()) continue;
+            if (!scope[k].second) return std::nullopt;
+            c = scope[k].second;
+            n.set_atom(text(*c));
+            folded++;
+            return c;
+        }
+        return std::nullopt;
+    }
+
+    // Pushes the frame that folds list n, or returns false when there is
+    // nothing to fold in it (the empty list, a malformed lambda or let).
+    bool open_list(Node n, std::vector<Frame<Node>> &stack) {
+        if (n.size() == 0) return false;
+        Frame<Node> f{n, Form::Children};
+        std::string_view head = n[0].is_atom() ? n[0].atom() : std::string_view();
+        if (!n[0].is_atom() || !is_keyword(head)) {
+            stack.push_back(std::move(f));
+            return true;
+        }
+        f.mark = scope.size();
+        if (head == "lambda" || head == "λ") {
+            if (n.size() < 3) return false;
+            Node params = n[1];
+            if (params.is_atom()) {
+                scope.emplace_back(std::string(params.atom()), std::nullopt);
+            } else {
+                for (size_t i = 0; i < params.size(); i++) {
+                    if (!params[i].is_atom()) return false;
+                }
+                for (size_t i = 0; i < params.size(); i++) {
+                    scope.emplace_back(std::string(params[i].atom()), std::nullopt);
+                }
+            }
+            f.form = Form::Lambda;
+        } else if (head == "let") {
+            if (n.size() != 3 || n[1].is_atom() || n[1].size() == 0) return false;
+            Node bindings = n[1];
+            for (size_t i = 0; i < bindings.size(); i++) {
+                Node b = bindings[i];
+                if (b.is_atom() || b.size() != 2 || !b[0].is_atom()) return false;
+            }
+            f.form = Form::Let;
+        } else {
+            f.form = Form::Operator;
+        }
+        stack.push_back(std::move(f));
+        return true;
+    }
+
+    // The child the frame folds next; false once it has folded them all.
+    static bool next_child(const Frame<Node> &f, Node &child) {
+        const Node &n = f.n;
+        switch (f.form) {
+        case Form::Children:
+            if (f.step >= n.size()) return false;
+            child = n[f.step];
+            return true;
+        case Form::Operator:
+            if (f.step + 1 >= n.size()) return false;
+            child = n[f.step + 1];
+            return true;
+        case Form::Lambda:
+            if (f.step >= 1) return false;
+            child = n[2];
+            return true;
+        case Form::Let: {
+            // bindings nest like let*: each value sees the bindings before it
+            Node bindings = n[1];
+            if (f.step > bindings.size()) return false;
+            child = f.step < bindings.size() ? bindings[f.step][1] : n[2];
+            return true;
+        }
+        }
+        return false;
+    }
+
+    void accept_child(Frame<Node> &f, const MaybeConst &value) {
+        size_t k = f.step++;
+        if (f.form == Form::Operator) {
+            f.args.push_back(value);
+        } else if (f.form == Form::Let) {
+            Node bindings = f.n[1];
+            if (k < bindings.size()) {
+                scope.emplace_back(std::string(bindings[k][0].atom()), value);
+                f.constant.push_back(value.has_value());
+            } else {
+                f.args.push_back(value);
+            }
+        }
+    }
+
+    MaybeConst finish(Frame<Node> &f) {
+        switch (f.form) {
+        case Form::Children:
+            return std::nullopt;
+        case Form::Lambda:
+            scope.resize(f.mark);
+            return std::nullopt;
+        case Form::Let: {
+            scope.resize(f.mark);
+            // every use of a constant binding has been substituted
+            Node bindings = f.n[1];
+            for (size_t i = bindings.size(); i-- > 0;) {
+                if (!f.constant[i]) continue;
+                bindings.erase_child(i);
+                folded++;
+            }
+            if (bindings.size() == 0) f.n.become_child(2);
+            return f.args[0];
+        }
+        case Form::Operator:
+            return apply(f.n, f.n[0].atom(), f.args);
+        }
+        return std::nullopt;
+    }
+
+    // Folds keyword form n once its arguments have been folded to args.
+    MaybeConst apply(Node n, std::string_view head, const std::vector<MaybeConst> &args) {
+        size_t arity = args.size();
+
+        if (head == "if") {
+            if (arity != 3 || !is_bool(args[0])) return std::nullopt;
+            size_t branch = args[0]->v ? 2 : 3;
+            MaybeConst result = args[branch - 1];
+            n.become_child(branch);
+            folded++;
+            return result;
+        }
+        if ((head == "+" || head == "*") && arity >= 2) {
+            uint64_t acc = 0, operands = 0;
+            for (size_t i = 0; i < arity; i++) {
+                if (!is_num(args[i])) return std::nullopt;
+                uint64_t v = args[i]->v;
+                if (i == 0) {
+                    acc = v;
+                } else if (head == "+") {
+                    if (acc > UINT64_MAX - v) return std::nullopt;
+                    acc += v;
+                } else {
+                    if (v != 0 && acc > UINT64_MAX / v) return std::nullopt;
+                    acc *= v;
+                }
+                operands = operands > UINT64_MAX - v ? UINT64_MAX : operands + v;
+            }
+            return replace(n, Const{false, acc}, operands);
+        }
+        if (head == "-" && arity == 2 && is_num(args[0]) && is_num(args[1])) {
+            uint64_t a = args[0]->v, b = args[1]->v;
+            return replace(n, Const{false, a > b ? a - b : 0});
+        }
+        if (arity == 2 && is_num(args[0]) && is_num(args[1])) {
+            uint64_t a = args[0]->v, b = args[1]->v;
+            if (head == "=" || head == "eq") return replace(n, Const{true, a == b});
+            if (head == "<") return replace(n, Const{true, a < b});
+            if (head == ">") return replace(n, Const{true, a > b});
+            if (head == "<=" || head == "leq") return replace(n, Const{true, a <= b});
+            if (head == ">=" || head == "geq") return replace(n, Const{true, a >= b});
+        }
+        if ((head == "and" || head == "or") && arity >= 2) return fold_connective(n, head == "and", args);
+        if (arity == 1 && head == "not" && is_bool(args[0])) return replace(n, Const{true, !args[0]->v});
+        if (arity == 1 && is_num(args[0])) {
+            uint64_t v = args[0]->v;
+            if (head == "succ" && v < UINT64_MAX) return replace(n, Const{false, v + 1});
+            if (head == "pred") return replace(n, Const{false, v > 0 ? v - 1 : 0});
+            if (head == "zero?") return replace(n, Const{true, v == 0});
+        }
+        return std::nullopt;
+    }
+
+    // A unary numeral is as long as its value, so in unary mode a result is
+    // only folded while it is small or no bigger than its operands were.
+    MaybeConst replace(Node n, Const c, uint64_t operands = 0) {
+        if (!c.is_bool && translate_options().numerals == NumeralMode::Unary) {
+            const uint64_t UNARY_FOLD_LIMIT = 1024;
+            if (c.v > UINT32_MAX || (c.v > UNARY_FOLD_LIMIT && c.v > operands)) return std::nullopt;
+        }
+        n.set_atom(text(c));
+        folded++;
+        return c;
+    }
+
+    // AND false x = false and AND true x = x for any x (OR dually), so a
+    // run of literal operands folds even when the last one is unknown.
+    MaybeConst fold_connective(Node n, bool is_and, const std::vector<MaybeConst> &args) {
+        for (size_t i = 0; i < args.size(); i++) {
+            if (!is_bool(args[i])) {
+                if (i + 1 != args.size()) return std::nullopt;
+                n.become_child(i + 1);
+                folded++;
+                return args[i];
+            }
+            if (args[i]->v != is_and) return replace(n, *args[i]);
+        }
+        return replace(n, Const{true, is_and});
+    }
+};
+
+template <typename Node>
+size_t fold_program(Node program) {
+    size_t folded = 0;
+    for (size_t i = 0; i < program.size(); i++) {
+        Folder<Node> folder;
+        folder.fold(program[i]);
+        folded += folder.folded;
+    }
+    folded_total.fetch_add(folded, std::memory_order_relaxed);
+    return folded;
+}
+
+} // namespace
+
+size_t fold_constants(const std::shared_ptr<SExpr> &program) {
+    return fold_program(SExprRef{program.get()});
+}
+
+size_t fold_constants(AstArena &arena, AstArena::Id program) {
+    return fold_program(ArenaRef{&arena, program});
+}
+
+size_t folded_nodes() {
+    return folded_total.load();
+}
+
+void reset_fold_stats() {
+    folded_total = 0;
+}
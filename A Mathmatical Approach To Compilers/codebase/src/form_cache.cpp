@@ -0,0 +1,227 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: persistent per-form cache of translated IR (--cache DIR)
+***************************************************************************************/
+
+#include "form_cache.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'C', 'F', 'C'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 4 + 4 + 4 + 8 + 8 + 8;
+
+void put_u32(std::string &out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void put_u64(std::string &out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+uint64_t get_le(const char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+bool all_of(const std::string &s, size_t from, const char *chars) {
+    return from < s.size() && s.find_first_not_of(chars, from) == std::string::npos;
+}
+
+// Only files the cache wrote itself are ever deleted, so pointing --cache
+// at a directory that holds anything else leaves those files alone: an
+// entry is named by 16 lowercase hex digits and starts with the magic.
+bool is_entry(const fs::directory_entry &e) {
+    std::string name = e.path().filename().string();
+    std::error_code ec;
+    if (name.size() != 16 || !all_of(name, 0, "0123456789abcdef") || !e.is_regular_file(ec)) {
+        return false;
+    }
+    std::ifstream in(e.path(), std::ios::binary);
+    char magic[4];
+    return in.read(magic, 4) && std::equal(MAGIC, MAGIC + 4, magic);
+}
+
+// A temporary file of store(): ".tmp.<pid>.<n>".
+bool is_temporary(const std::string &name) {
+    if (name.rfind(".tmp.", 0) != 0) return false;
+    size_t dot = name.find('.', 5);
+    return dot != std::string::npos && all_of(name.substr(0, dot), 5, "0123456789") &&
+           all_of(name, dot + 1, "0123456789");
+}
+
+} // namespace
+
+uint64_t form_cache_hash(std::string_view s) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (char c : s) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+FormCache::FormCache(std::string directory, uint64_t max_bytes)
+    : dir(std::move(directory)), limit(max_bytes) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (!fs::is_directory(dir)) {
+        throw std::runtime_error("cannot create cache directory '" + dir + "'");
+    }
+}
+
+std::string FormCache::path_for(std::string_view key) const {
+    static const char HEX[] = "0123456789abcdef";
+    uint64_t h = form_cache_hash(key);
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; i--, h >>= 4) name[static_cast<size_t>(i)] = HEX[h & 15];
+    return (fs::path(dir) / name).string();
+}
+
+bool FormCache::lookup(std::string_view key, std::string &ir, BuiltinSet &builtins) {
+    std::string path = path_for(key);
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    uint64_t file_size = in ? static_cast<uint64_t>(in.tellg()) : 0;
+    in.seekg(0);
+    char header[HEADER_SIZE];
+    bool ok = in && in.read(header, HEADER_SIZE) &&
+              std::equal(MAGIC, MAGIC + 4, header) && get_le(header + 4, 4) == VERSION;
+    uint64_t key_len = ok ? get_le(header + 12, 8) : 0;
+    uint64_t ir_len = ok ? get_le(header + 20, 8) : 0;
+    // the lengths must account for the file exactly before either is
+    // trusted with an allocation
+    ok = ok && key_len == key.size() && key_len <= file_size - HEADER_SIZE &&
+         ir_len == file_size - HEADER_SIZE - key_len;
+    if (ok) {
+        std::string stored_key(key.size(), '\0');
+        ok = in.read(&stored_key[0], static_cast<std::streamsize>(key.size())) && stored_key == key;
+    }
+    if (ok) {
+        ir.resize(ir_len);
+        ok = (ir_len == 0 || in.read(&ir[0], static_cast<std::streamsize>(ir_len))) &&
+             form_cache_hash(ir) == get_le(header + 28, 8);
+    }
+    if (!ok) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    builtins = static_cast<BuiltinSet>(get_le(header + 8, 4));
+    hits.fetch_add(1, std::memory_order_relaxed);
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void FormCache::store(std::string_view key, std::string_view ir, BuiltinSet builtins) {
+    std::string entry;
+    entry.reserve(HEADER_SIZE + key.size() + ir.size());
+    entry.append(MAGIC, 4);
+    put_u32(entry, VERSION);
+    put_u32(entry, builtins);
+    put_u64(entry, key.size());
+    put_u64(entry, ir.size());
+    put_u64(entry, form_cache_hash(ir));
+    entry.append(key.data(), key.size());
+    entry.append(ir.data(), ir.size());
+
+    // unique per process and thread; rename() then publishes it atomically
+    static std::atomic<uint64_t> next_tmp{0};
+    std::string tmp = (fs::path(dir) / (".tmp." + std::to_string(getpid()) + "." +
+                                        std::to_string(next_tmp.fetch_add(1)))).string();
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(entry.data(), static_cast<std::streamsize>(entry.size()))) {
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            return;     // a cache that cannot be written only costs speed
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, path_for(key), ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+    stored.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FormCache::trim() {
+    std::string lock_path = (fs::path(dir) / ".lock").string();
+    int fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+    if (flock(fd, LOCK_EX) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    struct Entry {
+        fs::file_time_type mtime;
+        uint64_t size;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    auto stale = fs::file_time_type::clock::now() - std::chrono::hours(1);
+    for (const auto &e : fs::directory_iterator(dir, ec)) {
+        std::string name = e.path().filename().string();
+        if (is_temporary(name)) {
+            // left behind by a writer that died before its rename
+            std::error_code tec;
+            if (e.last_write_time(tec) < stale) fs::remove(e.path(), tec);
+            continue;
+        }
+        if (!is_entry(e)) continue;
+        std::error_code sec;
+        uint64_t size = e.file_size(sec);
+        auto mtime = e.last_write_time(sec);
+        if (sec) continue;
+        entries.push_back({mtime, size, e.path()});
+        total += size;
+    }
+
+    if (total > limit) {
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+        uint64_t target = limit / 4 * 3;
+        for (const Entry &e : entries) {
+            if (total <= target) break;
+            std::error_code rec;
+            if (fs::remove(e.path, rec)) {
+                total -= e.size;
+                evicted.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    bytes.store(total, std::memory_order_relaxed);
+
+    flock(fd, LOCK_UN);
+    ::close(fd);
+}
+
+FormCacheStats FormCache::stats() const {
+    FormCacheStats st;
+    st.hits = hits.load();
+    st.misses = misses.load();
+    st.stored = stored.load();
+    st.evicted = evicted.load();
+    st.bytes = bytes.load();
+    st.limit = limit;
+    return st;
+}
@@ -0,0 +1,83 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: chunked top-level form splitter for streaming compilation (stream -> forms)
+***************************************************************************************/
+
+#include "form_reader.hpp"
+#include <cctype>
+
+FormReader::FormReader(std::istream &input, size_t chunk_size)
+    : in(input), chunk(chunk_size) {}
+
+bool FormReader::fill() {
+    if (eof) return false;
+    size_t old = buf.size();
+    buf.resize(old + chunk);
+    in.read(&buf[old], static_cast<std::streamsize>(chunk));
+    size_t got = static_cast<size_t>(in.gcount());
+    buf.resize(old + got);
+    total += got;
+    if (got < chunk) eof = true;
+    if (buf.capacity() > peak) peak = buf.capacity();
+    return got > 0;
+}
+
+void FormReader::track(size_t from, size_t to) {
+    for (size_t k = from; k < to; k++) {
+        if (buf[k] == '\n') {
+            cur_line++;
+            cur_col = 1;
+        } else {
+            cur_col++;
+        }
+    }
+}
+
+bool FormReader::next(std::string_view &form) {
+    // drop consumed input once there is a chunk's worth of it, so the
+    // memmove is amortised over many small forms
+    if (pos >= chunk) {
+        buf.erase(0, pos);
+        pos = 0;
+    }
+
+    for (;;) {
+        size_t start = pos;
+        while (pos < buf.size() && std::isspace((unsigned char)buf[pos])) pos++;
+        track(start, pos);
+        if (pos < buf.size()) break;
+        buf.clear();
+        pos = 0;
+        if (!fill()) return false;
+    }
+    form_line = cur_line;
+    form_col = cur_col;
+
+    // A list runs to its matching ')', an atom to the next delimiter. A stray
+    // ')' or an unterminated list is handed over as-is so the parser reports it.
+    size_t end = pos + 1;
+    if (buf[pos] == '(') {
+        int depth = 1;
+        while (depth > 0) {
+            if (end == buf.size() && !fill()) break;
+            char c = buf[end++];
+            if (c == '(') depth++;
+            else if (c == ')') depth--;
+        }
+    } else if (buf[pos] != ')') {
+        for (;;) {
+            if (end == buf.size() && !fill()) break;
+            char c = buf[end];
+            if (std::isspace((unsigned char)c) || c == '(' || c == ')') break;
+            end++;
+        }
+    }
+
+    track(pos, end);
+    form = std::string_view(buf.data() + pos, end - pos);
+    if (form.size() > largest) largest = form.size();
+    pos = end;
+    return true;
+}
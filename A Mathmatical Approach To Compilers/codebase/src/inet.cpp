@@ -0,0 +1,987 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: interaction-net reducer: λ-terms as nets of λ/application agents, fans
+*                 and erasers, reduced to normal form on several threads with lock-free
+*                 wiring and work-stealing redex deques
+***************************************************************************************/
+
+#include "inet.hpp"
+#include "builtins.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+namespace {
+
+// What sits at one end of a wire: the principal port of an agent (its
+// tag, label and location), an eraser, or a variable cell standing for a
+// wire whose far end has not been settled yet.
+using Port = uint64_t;
+
+enum Tag : uint64_t { NONE = 0, VAR = 1, ERA = 2, CON = 3, DUP = 4, FIX = 5 };
+
+constexpr uint32_t MAX_LABEL = (1u << 29) - 1;
+
+Port make_port(Tag tag, uint32_t label, uint32_t loc) {
+    return static_cast<uint64_t>(loc) << 32 | static_cast<uint64_t>(label) << 3 | tag;
+}
+Port var_port(uint32_t v) { return make_port(VAR, 0, v); }
+Tag tag_of(Port p) { return static_cast<Tag>(p & 7); }
+uint32_t label_of(Port p) { return static_cast<uint32_t>(p >> 3) & MAX_LABEL; }
+uint32_t loc_of(Port p) { return static_cast<uint32_t>(p >> 32); }
+
+struct Redex {
+    Port a;
+    Port b;
+};
+
+// Chase-Lev work-stealing deque (Lê et al., "Correct and efficient
+// work-stealing for weak memory models"). The owner pushes and pops at
+// the bottom; other threads steal from the top.
+class RedexDeque {
+public:
+    RedexDeque() {
+        rings.push_back(std::make_unique<Ring>(1 << 12));
+        ring.store(rings.back().get());
+    }
+
+    // Only while no thread is reducing.
+    void clear() {
+        top.store(0);
+        bottom.store(0);
+    }
+
+    void push(Redex r) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring *a = ring.load(std::memory_order_relaxed);
+        if (b - t >= a->capacity) a = grow(a, t, b);
+        a->put(b, r);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    bool pop(Redex &r) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring *a = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        r = a->get(b);
+        if (t < b) return true;
+        // the last one: race any thief for it
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    bool steal(Redex &r) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        Ring *a = ring.load(std::memory_order_acquire);
+        r = a->get(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<uint64_t>[]> cells;
+
+        explicit Ring(int64_t n) : capacity(n), cells(new std::atomic<uint64_t>[2 * n]) {}
+        void put(int64_t i, Redex r) {
+            std::atomic<uint64_t> *c = &cells[2 * (i & (capacity - 1))];
+            c[0].store(r.a, std::memory_order_relaxed);
+            c[1].store(r.b, std::memory_order_relaxed);
+        }
+        Redex get(int64_t i) const {
+            const std::atomic<uint64_t> *c = &cells[2 * (i & (capacity - 1))];
+            return {c[0].load(std::memory_order_relaxed), c[1].load(std::memory_order_relaxed)};
+        }
+    };
+
+    Ring *grow(Ring *old, int64_t t, int64_t b) {
+        rings.push_back(std::make_unique<Ring>(old->capacity * 2));
+        Ring *a = rings.back().get();
+        for (int64_t i = t; i < b; i++) a->put(i, old->get(i));
+        ring.store(a, std::memory_order_release);
+        return a;
+    }
+
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+    std::atomic<Ring *> ring;
+    std::vector<std::unique_ptr<Ring>> rings;   // outgrown rings stay for thieves still reading them
+};
+
+// Zero-filled cells reserved up front; the kernel commits pages as they
+// are first touched, so a small net costs only what it uses.
+class Region {
+public:
+    Region() = default;
+    Region(const Region &) = delete;
+    Region &operator=(const Region &) = delete;
+    ~Region() {
+        if (cells) ::munmap(cells, capacity * sizeof(std::atomic<uint64_t>));
+    }
+
+    void reserve(size_t n) {
+        void *p = ::mmap(nullptr, n * sizeof(std::atomic<uint64_t>), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        cells = static_cast<std::atomic<uint64_t> *>(p);
+        capacity = n;
+    }
+
+    // Zeroes the first n cells again.
+    void clear(size_t n) {
+        std::memset(static_cast<void *>(cells), 0, std::min(n, capacity) * sizeof(std::atomic<uint64_t>));
+    }
+
+    std::atomic<uint64_t> &operator[](size_t i) { return cells[i]; }
+
+private:
+    std::atomic<uint64_t> *cells = nullptr;
+    size_t capacity = 0;
+};
+
+// Runs body on a thread with a stack of stack_bytes, for readbacks as deep
+// as the normal form (a numeral n is n applications deep). The pages are
+// only committed as the recursion reaches them.
+template <typename Body>
+void run_with_stack(size_t stack_bytes, Body body) {
+    struct Call {
+        Body *body;
+        std::exception_ptr error;
+    } call{&body, nullptr};
+    auto entry = [](void *arg) -> void * {
+        Call *c = static_cast<Call *>(arg);
+        try {
+            (*c->body)();
+        } catch (...) {
+            c->error = std::current_exception();
+        }
+        return nullptr;
+    };
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack_bytes);
+    pthread_t thread;
+    int failed = pthread_create(&thread, &attr, entry, &call);
+    pthread_attr_destroy(&attr);
+    if (failed) {
+        body();
+        return;
+    }
+    pthread_join(thread, nullptr);
+    if (call.error) std::rethrow_exception(call.error);
+}
+
+// Where a port is held: a cell (2 * agent + aux port), the root, or a
+// parked pair.
+constexpr uint64_t NO_HOLDER = UINT64_MAX;
+constexpr uint64_t ROOT_HOLDER = UINT64_MAX - 1;
+constexpr uint64_t PARKED_HOLDER = UINT64_MAX - 2;
+
+// λf.(λx.f (x x)) (λx.f (x x)) under any names
+bool is_fixpoint(const TermTable &terms, const Term &t) {
+    if (t.kind != TermKind::Lam) return false;
+    const Term &body = terms[t.b];
+    if (body.kind != TermKind::App || body.a != body.b) return false;
+    const Term &half = terms[body.a];
+    if (half.kind != TermKind::Lam || half.a == t.a) return false;
+    const Term &call = terms[half.b];
+    if (call.kind != TermKind::App) return false;
+    const Term &f = terms[call.a], &xx = terms[call.b];
+    if (f.kind != TermKind::Var || f.a != t.a || xx.kind != TermKind::App) return false;
+    const Term &x1 = terms[xx.a], &x2 = terms[xx.b];
+    return x1.kind == TermKind::Var && x1.a == half.a && xx.a == xx.b && x2.a == half.a;
+}
+
+} // namespace
+
+struct NetReducer::Impl {
+    const LcProgram &program;
+    EvalOptions opts;
+    InetStats stats;
+
+    // Two cells per agent, its auxiliary ports. Its principal port is
+    // wherever a Port naming it is stored.
+    Region agents;
+    Region vars;
+    size_t agent_limit;
+    size_t var_limit;
+    std::atomic<uint64_t> agent_top{0};
+    std::atomic<uint64_t> var_top{0};
+    static constexpr uint32_t BLOCK = 256;
+
+    struct Worker {
+        RedexDeque redexes;
+        std::vector<uint32_t> free_agents;
+        std::vector<uint32_t> free_vars;
+        uint64_t agent_next = 0, agent_end = 0;
+        uint64_t var_next = 0, var_end = 0;
+        std::vector<Redex> parked;     // fixpoints met by an application
+        uint64_t annihilations = 0, commutations = 0, erasures = 0, unfolds = 0, steals = 0;
+        uint64_t unreported = 0;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // active pairs pushed and not yet interacted; zero once the net is normal
+    std::atomic<int64_t> pending{0};
+    std::atomic<uint64_t> reported{0};
+    enum Failure : int { OK, OUT_OF_STEPS, OUT_OF_HEAP };
+    std::atomic<int> failure{OK};
+    struct Abort {};
+
+    // --- building -----------------------------------------------------
+
+    // A λ, a definition or a free name, and the variable cells of its uses
+    struct Binder {
+        std::vector<uint32_t> uses;
+    };
+    std::vector<Binder> binders;
+    using Scope = std::vector<std::pair<uint32_t, size_t>>;    // symbol, binder
+    struct BuildFrame {
+        TermId id;
+        uint32_t agent;     // λ: its agent
+        size_t binder;      // λ: its parameter
+        Port f;             // application: the function's port, once it is built
+    };
+    std::vector<std::pair<std::string, size_t>> globals;        // name, binder
+    std::unordered_map<std::string, size_t> global_binders;
+    std::unordered_map<uint32_t, std::string> free_names;        // agent standing for each free name
+    std::unordered_map<std::string, TermId> definitions;
+    LcProgram builtin_terms;
+    std::unordered_map<std::string, TermId> builtin_roots;
+    std::atomic<uint32_t> next_label{1};
+    std::vector<Redex> dormant;     // parked pairs nothing demanded yet
+    Port root = NONE;
+
+    Impl(const LcProgram &p, EvalOptions o, unsigned threads) : program(p), opts(o) {
+        agent_limit = std::min<uint64_t>(opts.max_heap_bytes / 24, UINT32_MAX);
+        var_limit = agent_limit;
+        agents.reserve(2 * agent_limit);
+        vars.reserve(var_limit);
+        for (const LcDefinition &def : program.definitions) definitions[def.name] = def.term;
+        set_threads(threads);
+    }
+
+    void set_threads(unsigned threads) {
+        workers.clear();
+        for (unsigned t = 0; t < std::max(1u, threads); t++) workers.push_back(std::make_unique<Worker>());
+    }
+
+    [[noreturn]] void fail(Failure why) {
+        int expected = OK;
+        failure.compare_exchange_strong(expected, why);
+        throw Abort{};
+    }
+
+    uint32_t alloc_agent(Worker &w) {
+        if (!w.free_agents.empty()) {
+            uint32_t a = w.free_agents.back();
+            w.free_agents.pop_back();
+            return a;
+        }
+        if (w.agent_next == w.agent_end) {
+            uint64_t start = agent_top.fetch_add(BLOCK, std::memory_order_relaxed);
+            if (start + BLOCK > agent_limit) fail(OUT_OF_HEAP);
+            w.agent_next = start;
+            w.agent_end = start + BLOCK;
+        }
+        return static_cast<uint32_t>(w.agent_next++);
+    }
+
+    void free_agent(Worker &w, uint32_t a) {
+        agents[2 * a].store(NONE, std::memory_order_relaxed);
+        agents[2 * a + 1].store(NONE, std::memory_order_relaxed);
+        w.free_agents.push_back(a);
+    }
+
+    uint32_t alloc_var(Worker &w) {
+        uint32_t v;
+        if (!w.free_vars.empty()) {
+            v = w.free_vars.back();
+            w.free_vars.pop_back();
+        } else {
+            if (w.var_next == w.var_end) {
+                uint64_t start = var_top.fetch_add(BLOCK, std::memory_order_relaxed);
+                if (start + BLOCK > var_limit) fail(OUT_OF_HEAP);
+                w.var_next = start;
+                w.var_end = start + BLOCK;
+            }
+            v = static_cast<uint32_t>(w.var_next++);
+        }
+        vars[v].store(NONE, std::memory_order_relaxed);
+        return v;
+    }
+
+    void set(uint32_t a, Port aux1, Port aux2) {
+        agents[2 * a].store(aux1, std::memory_order_relaxed);
+        agents[2 * a + 1].store(aux2, std::memory_order_relaxed);
+    }
+
+    void push_redex(Worker &w, Port a, Port b) {
+        if (tag_of(a) == ERA && tag_of(b) == ERA) return;
+        pending.fetch_add(1);
+        w.redexes.push({a, b});
+    }
+
+    // Follows variable cells whose far end is already known, taking them
+    // over as this thread is their last holder.
+    Port enter(Worker &w, Port p) {
+        while (tag_of(p) == VAR) {
+            Port next = vars[loc_of(p)].exchange(NONE);
+            if (next == NONE) break;
+            w.free_vars.push_back(loc_of(p));
+            p = next;
+        }
+        return p;
+    }
+
+    // Connects a to b. Two principal ports make an active pair. Otherwise
+    // b is left in a's variable cell; if the other end of that wire got
+    // there first, this thread takes what it left and connects that to b.
+    void link(Worker &w, Port a, Port b) {
+        for (;;) {
+            if (tag_of(a) != VAR && tag_of(b) == VAR) std::swap(a, b);
+            if (tag_of(a) != VAR) {
+                push_redex(w, a, b);
+                return;
+            }
+            b = enter(w, b);
+            Port other = vars[loc_of(a)].exchange(b);
+            if (other == NONE) return;
+            w.free_vars.push_back(loc_of(a));
+            a = other;
+        }
+    }
+
+    void interact(Worker &w, Port a, Port b) {
+        if (tag_of(a) == ERA || tag_of(b) == FIX) std::swap(a, b);
+        if (tag_of(a) == FIX && tag_of(b) == CON) {
+            // unfolding here would unfold again inside the copy, forever;
+            // wait until the result is known to be needed
+            w.parked.push_back({a, b});
+            return;
+        }
+        uint32_t x = loc_of(a);
+        Port a1 = agents[2 * x].load(std::memory_order_relaxed);
+        Port a2 = agents[2 * x + 1].load(std::memory_order_relaxed);
+        if (tag_of(b) == ERA) {
+            w.erasures++;
+            free_agent(w, x);
+            link(w, a1, ERA);
+            link(w, a2, ERA);
+            return;
+        }
+        uint32_t y = loc_of(b);
+        Port b1 = agents[2 * y].load(std::memory_order_relaxed);
+        Port b2 = agents[2 * y + 1].load(std::memory_order_relaxed);
+        if (tag_of(a) == tag_of(b) && label_of(a) == label_of(b)) {
+            w.annihilations++;
+            free_agent(w, x);
+            free_agent(w, y);
+            link(w, a1, b1);
+            link(w, a2, b2);
+            return;
+        }
+        // each agent passes through the other: two copies of each, their
+        // auxiliary ports wired crosswise
+        w.commutations++;
+        uint32_t x2 = alloc_agent(w), y2 = alloc_agent(w);
+        uint32_t v11 = alloc_var(w), v12 = alloc_var(w), v21 = alloc_var(w), v22 = alloc_var(w);
+        set(x, var_port(v11), var_port(v12));
+        set(x2, var_port(v21), var_port(v22));
+        set(y, var_port(v11), var_port(v21));
+        set(y2, var_port(v12), var_port(v22));
+        link(w, b1, a);
+        link(w, b2, make_port(tag_of(a), label_of(a), x2));
+        link(w, a1, b);
+        link(w, a2, make_port(tag_of(b), label_of(b), y2));
+    }
+
+    uint32_t fresh_label() {
+        uint32_t label = next_label.fetch_add(1, std::memory_order_relaxed);
+        if (label > MAX_LABEL) {
+            throw EvalError("too many shared variables to label their fans");
+        }
+        return label;
+    }
+
+    size_t new_binder() {
+        binders.emplace_back();
+        return binders.size() - 1;
+    }
+
+    Port use(Worker &w, size_t binder) {
+        uint32_t v = alloc_var(w);
+        binders[binder].uses.push_back(v);
+        return var_port(v);
+    }
+
+    // The port a binder's uses hang off: nothing, the one use, or a chain
+    // of fans, each with a label of its own.
+    Port share(Worker &w, size_t binder) {
+        const std::vector<uint32_t> &uses = binders[binder].uses;
+        if (uses.empty()) return ERA;
+        Port out = var_port(uses.back());
+        for (size_t i = uses.size() - 1; i-- > 0;) {
+            uint32_t a = alloc_agent(w);
+            set(a, var_port(uses[i]), out);
+            out = make_port(DUP, fresh_label(), a);
+        }
+        return out;
+    }
+
+    Port use_global(Worker &w, const std::string &name) {
+        auto it = global_binders.find(name);
+        if (it == global_binders.end()) {
+            it = global_binders.emplace(name, new_binder()).first;
+            globals.push_back({name, it->second});
+        }
+        return use(w, it->second);
+    }
+
+    // Builds a leaf outright. A λ or an application gets a Frame instead
+    // (a λ taking its agent and binding its parameter first) and NONE.
+    Port open(Worker &w, const TermTable &terms, TermId id, Scope &scope, std::vector<BuildFrame> &stack) {
+        Term t = terms[id];
+        switch (t.kind) {
+        case TermKind::Var:
+            for (size_t k = scope.size(); k-- > 0;) {
+                if (scope[k].first == t.a) return use(w, scope[k].second);
+            }
+            return use_global(w, std::string(terms.name(t.a)));
+        case TermKind::Lam: {
+            if (is_fixpoint(terms, t)) {
+                // λf. FIX f, unfolded only on demand
+                uint32_t a = alloc_agent(w), fix = alloc_agent(w);
+                size_t f = new_binder();
+                set(fix, use(w, f), ERA);
+                set(a, share(w, f), make_port(FIX, 0, fix));
+                return make_port(CON, 0, a);
+            }
+            uint32_t a = alloc_agent(w);
+            size_t binder = new_binder();
+            scope.push_back({t.a, binder});
+            stack.push_back({id, a, binder, NONE});
+            return NONE;
+        }
+        case TermKind::App:
+            stack.push_back({id, 0, 0, NONE});
+            return NONE;
+        case TermKind::Const:
+            return use_global(w, std::string(builtin_name(static_cast<Builtin>(t.a))));
+        case TermKind::Num:
+            return numeral(w, t.a);
+        }
+        return ERA;
+    }
+
+    // The port of term's root, for whatever uses it to hold. Built without
+    // recursion, so a term's depth is bounded by memory rather than the
+    // native stack: every λ or application still waiting on a subterm is a
+    // Frame on an explicit stack. Agents are taken in the order a recursive
+    // walk would take them, function before argument.
+    Port build(Worker &w, const TermTable &terms, TermId id, Scope &scope) {
+        std::vector<BuildFrame> stack;
+        Port r = open(w, terms, id, scope, stack);
+        for (;;) {
+            while (r == NONE) {
+                Term t = terms[stack.back().id];
+                r = open(w, terms, t.kind == TermKind::Lam ? t.b : t.a, scope, stack);
+            }
+            for (;;) {
+                if (stack.empty()) return r;
+                BuildFrame &top = stack.back();
+                Term t = terms[top.id];
+                if (t.kind == TermKind::Lam) {
+                    scope.pop_back();
+                    set(top.agent, share(w, top.binder), r);
+                    r = make_port(CON, 0, top.agent);
+                } else if (top.f == NONE) {
+                    top.f = r;
+                    r = open(w, terms, t.b, scope, stack);
+                    break;
+                } else {
+                    uint32_t a = alloc_agent(w), v = alloc_var(w);
+                    set(a, r, var_port(v));
+                    link(w, make_port(CON, 0, a), top.f);
+                    r = var_port(v);
+                }
+                stack.pop_back();
+            }
+        }
+    }
+
+    // λf.λx. f (f ... (f x))
+    Port numeral(Worker &w, uint32_t n) {
+        uint32_t lf = alloc_agent(w), lx = alloc_agent(w);
+        size_t f = new_binder(), x = new_binder();
+        Port body = use(w, x);
+        for (uint32_t i = 0; i < n; i++) {
+            Port fn = use(w, f);
+            uint32_t a = alloc_agent(w), v = alloc_var(w);
+            set(a, body, var_port(v));
+            link(w, make_port(CON, 0, a), fn);
+            body = var_port(v);
+        }
+        set(lx, share(w, x), body);
+        set(lf, share(w, f), make_port(CON, 0, lx));
+        return make_port(CON, 0, lf);
+    }
+
+    // Every definition and builtin the expression reaches is built once
+    // and shared by all of its uses, including its own.
+    void build_globals(Worker &w) {
+        std::vector<Port> bodies;
+        for (size_t g = 0; g < globals.size(); g++) {
+            std::string name = globals[g].first;
+            Scope scope;
+            auto def = definitions.find(name);
+            Builtin b;
+            if (def != definitions.end()) {
+                bodies.push_back(build(w, program.terms, def->second, scope));
+            } else if (builtin_from_name(name, b)) {
+                auto it = builtin_roots.find(name);
+                if (it == builtin_roots.end()) {
+                    size_t first = builtin_terms.expressions.size();
+                    read_lc(builtin_text(b), builtin_terms);
+                    it = builtin_roots.emplace(name, builtin_terms.expressions[first].term).first;
+                }
+                bodies.push_back(build(w, builtin_terms.terms, it->second, scope));
+            } else {
+                bodies.push_back(NONE);
+            }
+        }
+        for (size_t g = 0; g < globals.size(); g++) {
+            size_t binder = globals[g].second;
+            if (bodies[g] != NONE) {
+                link(w, share(w, binder), bodies[g]);
+                continue;
+            }
+            // a free name is the variable of a λ nothing applies
+            uint32_t a = alloc_agent(w);
+            set(a, share(w, binder), ERA);
+            free_names[a] = globals[g].first;
+        }
+    }
+
+    // --- reduction ----------------------------------------------------
+
+    // FIX f applied: (f (FIX f)) arg, with f shared by a fan
+    void unfold(Worker &w, Redex r) {
+        uint32_t fix = loc_of(r.a);
+        Port f = agents[2 * fix].load(std::memory_order_relaxed);
+        uint32_t fan = alloc_agent(w), call = alloc_agent(w);
+        uint32_t f1 = alloc_var(w), f2 = alloc_var(w), result = alloc_var(w);
+        set(fan, var_port(f1), var_port(f2));
+        set(fix, var_port(f2), ERA);
+        set(call, make_port(FIX, 0, fix), var_port(result));
+        link(w, make_port(CON, 0, call), var_port(f1));
+        link(w, r.b, var_port(result));
+        link(w, make_port(DUP, fresh_label(), fan), f);
+        w.unfolds++;
+    }
+
+    void report(Worker &w) {
+        uint64_t total = reported.fetch_add(w.unreported) + w.unreported;
+        w.unreported = 0;
+        if (total > opts.max_steps) fail(OUT_OF_STEPS);
+    }
+
+    bool steal(size_t self, Redex &r) {
+        for (size_t k = 1; k < workers.size(); k++) {
+            if (workers[(self + k) % workers.size()]->redexes.steal(r)) {
+                workers[self]->steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t self) {
+        Worker &w = *workers[self];
+        try {
+            Redex r;
+            for (;;) {
+                if (w.redexes.pop(r) || steal(self, r)) {
+                    interact(w, r.a, r.b);
+                    pending.fetch_sub(1);
+                    if (++w.unreported == 1024) {
+                        report(w);
+                        if (failure.load() != OK) break;
+                    }
+                    continue;
+                }
+                if (pending.load() == 0 || failure.load() != OK) break;
+                std::this_thread::yield();
+            }
+            reported.fetch_add(w.unreported);
+            w.unreported = 0;
+        } catch (const Abort &) {
+        }
+    }
+
+    void reduce() {
+        std::vector<std::thread> helpers;
+        for (size_t t = 1; t < workers.size(); t++) helpers.emplace_back([this, t] { run(t); });
+        run(0);
+        for (std::thread &t : helpers) t.join();
+    }
+
+    void reset() {
+        agents.clear(2 * std::min<uint64_t>(agent_top, agent_limit));
+        vars.clear(std::min<uint64_t>(var_top, var_limit));
+        agent_top = 0;
+        var_top = 0;
+        for (auto &w : workers) {
+            w->redexes.clear();
+            w->free_agents.clear();
+            w->free_vars.clear();
+            w->parked.clear();
+            w->agent_next = w->agent_end = w->var_next = w->var_end = 0;
+            w->unreported = 0;
+        }
+        pending = 0;
+        reported = 0;
+        failure = OK;
+        binders.clear();
+        globals.clear();
+        global_binders.clear();
+        free_names.clear();
+        dormant.clear();
+        next_label = 1;
+        root = NONE;
+    }
+
+    // --- the net at rest ----------------------------------------------
+
+    // Between rounds no thread is running: every cell is settled past the
+    // variables whose far end is known, and each wire's holders indexed.
+    std::vector<uint64_t> var_holders;          // the two cells holding each unsettled variable
+    std::vector<uint64_t> principal_holder;     // the cell holding each agent's principal port
+    std::unordered_map<uint32_t, size_t> parked_at;  // application agent -> its dormant pair
+
+    Port cell(uint64_t h) { return h == ROOT_HOLDER ? root : agents[h].load(); }
+
+    Port settle(Port p) {
+        for (uint64_t hops = 0; tag_of(p) == VAR; hops++) {
+            Port next = vars[loc_of(p)].load();
+            if (next == NONE) break;
+            // only a definition that is nothing but itself closes a wire on itself
+            if (hops > var_top) throw EvalError("infinite loop: a value depends on itself");
+            p = next;
+        }
+        return p;
+    }
+
+    void index() {
+        size_t used_agents = std::min<uint64_t>(agent_top, agent_limit);
+        size_t used_vars = std::min<uint64_t>(var_top, var_limit);
+        var_holders.assign(2 * used_vars, NO_HOLDER);
+        principal_holder.assign(used_agents, NO_HOLDER);
+        auto hold = [&](uint64_t h, Port p) {
+            if (tag_of(p) == VAR) {
+                uint64_t *slots = &var_holders[2 * loc_of(p)];
+                slots[slots[0] == NO_HOLDER ? 0 : 1] = h;
+            } else if (tag_of(p) >= CON) {
+                principal_holder[loc_of(p)] = h;
+            }
+        };
+        root = settle(root);
+        hold(ROOT_HOLDER, root);
+        for (uint64_t h = 0; h < 2 * used_agents; h++) {
+            Port p = agents[h].load();
+            if (p == NONE) continue;
+            p = settle(p);
+            agents[h].store(p);
+            hold(h, p);
+        }
+        parked_at.clear();
+        for (size_t i = 0; i < dormant.size(); i++) {
+            principal_holder[loc_of(dormant[i].a)] = PARKED_HOLDER;
+            principal_holder[loc_of(dormant[i].b)] = PARKED_HOLDER;
+            parked_at[loc_of(dormant[i].b)] = i;
+        }
+    }
+
+    // The cell at the other end of the variable held at h.
+    uint64_t other_holder(Port p, uint64_t h) {
+        uint32_t v = loc_of(p);
+        return var_holders[2 * v] == h ? var_holders[2 * v + 1] : var_holders[2 * v];
+    }
+
+    // Marks the dormant pairs the normal form needs: walking from the root
+    // the way readback does, an application whose function is a parked
+    // fixpoint is needed. Fans are passed without tracking their labels,
+    // which can only mark too much.
+    std::vector<bool> demanded() {
+        std::vector<bool> needed(dormant.size(), false);
+        size_t cells = 2 * principal_holder.size();
+        std::vector<bool> entered(principal_holder.size(), false);  // principal ports arrived at
+        std::vector<bool> seen(cells, false);                       // auxiliary ports arrived at
+        std::vector<uint64_t> work = {ROOT_HOLDER};                 // cells whose far end is needed
+        while (!work.empty()) {
+            uint64_t h = work.back();
+            work.pop_back();
+            Port p = cell(h);
+            if (tag_of(p) >= CON) {
+                uint32_t a = loc_of(p);
+                if (entered[a]) continue;
+                entered[a] = true;
+                if (tag_of(p) != CON) work.push_back(2 * uint64_t(a));      // a fan's copies, a fixpoint's function
+                if (tag_of(p) != FIX) work.push_back(2 * uint64_t(a) + 1);  // a λ's body
+                continue;
+            }
+            if (tag_of(p) != VAR) continue;
+            // an auxiliary port: follow results back to whatever produces them
+            for (uint64_t aux = other_holder(p, h); aux < cells && !seen[aux];) {
+                seen[aux] = true;
+                uint32_t a = static_cast<uint32_t>(aux / 2);
+                uint64_t ph = principal_holder[a];
+                if (free_names.count(a) || ph == NO_HOLDER) break;
+                bool parked = ph == PARKED_HOLDER;
+                if (parked || tag_of(cell(ph)) == CON) {
+                    if (aux % 2 == 0) break;            // a λ's variable
+                    work.push_back(2 * uint64_t(a));    // an application's argument
+                }
+                if (parked) {
+                    needed[parked_at.at(a)] = true;
+                    break;
+                }
+                aux = ph;
+            }
+        }
+        return needed;
+    }
+
+    // --- readback -----------------------------------------------------
+
+    // Walks the normal form from the root. Passing a fan from one of its
+    // auxiliary ports pushes which one on that label's stack; reaching a
+    // fan at its principal port pops it to pick the way out.
+    struct Reader {
+        Impl &m;
+        TermTable terms;
+        uint64_t visits = 0;
+        // The fan ports passed so far, per label, and a log to take back
+        // what reading an application's function did before reading its
+        // argument from the same place.
+        struct Stacks {
+            std::unordered_map<uint32_t, std::vector<uint8_t>> paths;
+            std::vector<std::pair<uint32_t, int>> log;     // label, port popped or -1 for a push
+
+            void push(uint32_t label, uint8_t port) {
+                paths[label].push_back(port);
+                log.push_back({label, -1});
+            }
+            bool pop(uint32_t label, uint8_t &port) {
+                std::vector<uint8_t> &path = paths[label];
+                if (path.empty()) return false;
+                port = path.back();
+                path.pop_back();
+                log.push_back({label, port});
+                return true;
+            }
+            void undo(size_t mark) {
+                for (; log.size() > mark; log.pop_back()) {
+                    std::vector<uint8_t> &path = paths[log.back().first];
+                    if (log.back().second < 0) {
+                        path.pop_back();
+                    } else {
+                        path.push_back(static_cast<uint8_t>(log.back().second));
+                    }
+                }
+            }
+        };
+
+        explicit Reader(Impl &impl) : m(impl) {}
+
+        [[noreturn]] static void inconsistent() {
+            throw EvalError("the normal form reads back inconsistently (fans crossed without Lamping's oracle)");
+        }
+
+        std::string name(uint32_t a) { return "_" + std::to_string(a); }
+
+        void visit() {
+            if (++visits > m.opts.max_steps) throw EvalError("the normal form is too large to read back");
+        }
+
+        // what the port held at h is wired to
+        TermId from(uint64_t h, Stacks &st) {
+            visit();
+            Port p = m.cell(h);
+            if (tag_of(p) >= CON) return principal(p, st);
+            if (tag_of(p) != VAR) inconsistent();
+            return aux(m.other_holder(p, h), st);
+        }
+
+        TermId principal(Port p, Stacks &st) {
+            uint32_t a = loc_of(p);
+            if (tag_of(p) == CON) {
+                TermId body = from(2 * uint64_t(a) + 1, st);
+                return terms.lam(name(a), body);
+            }
+            if (tag_of(p) == FIX) {
+                // a fixpoint nothing applied: Y f
+                TermId x = terms.var("x"), f = terms.var("f");
+                TermId half = terms.lam("x", terms.app(f, terms.app(x, x)));
+                TermId y = terms.lam("f", terms.app(half, half));
+                return terms.app(y, from(2 * uint64_t(a), st));
+            }
+            uint8_t i;
+            if (!st.pop(label_of(p), i)) inconsistent();
+            return from(2 * uint64_t(a) + i, st);
+        }
+
+        // arriving at auxiliary port h of an agent
+        TermId aux(uint64_t h, Stacks &st) {
+            visit();
+            if (h >= 2 * m.principal_holder.size()) inconsistent();
+            uint32_t a = static_cast<uint32_t>(h / 2);
+            uint8_t i = static_cast<uint8_t>(h % 2);
+            auto free = m.free_names.find(a);
+            if (free != m.free_names.end()) {
+                if (i != 0) inconsistent();
+                return terms.var(free->second);
+            }
+            uint64_t ph = m.principal_holder[a];
+            if (ph == NO_HOLDER || ph == PARKED_HOLDER) inconsistent();
+            Port self = m.cell(ph);
+            if (tag_of(self) == CON) {
+                if (i == 0) return terms.var(name(a));
+                // an application's result: its function sits at the principal port
+                size_t mark = st.log.size();
+                TermId f = aux(ph, st);
+                st.undo(mark);
+                return terms.app(f, from(2 * uint64_t(a), st));
+            }
+            if (tag_of(self) != DUP) inconsistent();
+            st.push(label_of(self), i);
+            return aux(ph, st);
+        }
+    };
+
+    std::string read_back() {
+        std::string result;
+        run_with_stack(size_t(1) << 30, [&] {
+            Reader r(*this);
+            Reader::Stacks st;
+            TermId t = r.from(ROOT_HOLDER, st);
+            Evaluator evaluator(opts);
+            result = evaluator.evaluate(r.terms, t);
+        });
+        return result;
+    }
+
+    // Reduces in rounds: every active pair on all threads, then the parked
+    // fixpoints the result needs, until none is needed.
+    void normalize() {
+        for (;;) {
+            auto start = std::chrono::steady_clock::now();
+            reduce();
+            stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            for (auto &worker : workers) {
+                stats.annihilations += worker->annihilations;
+                stats.commutations += worker->commutations;
+                stats.erasures += worker->erasures;
+                stats.unfolds += worker->unfolds;
+                stats.steals += worker->steals;
+                worker->annihilations = worker->commutations = worker->erasures = 0;
+                worker->unfolds = worker->steals = 0;
+                dormant.insert(dormant.end(), worker->parked.begin(), worker->parked.end());
+                worker->parked.clear();
+            }
+            stats.interactions = stats.annihilations + stats.commutations + stats.erasures + stats.unfolds;
+            uint64_t bytes = std::min<uint64_t>(agent_top, agent_limit) * 16 +
+                             std::min<uint64_t>(var_top, var_limit) * 8;
+            stats.heap_bytes = std::max(stats.heap_bytes, bytes);
+            switch (failure.load()) {
+            case OUT_OF_STEPS:
+                throw EvalError("step budget of " + std::to_string(opts.max_steps) + " exhausted");
+            case OUT_OF_HEAP:
+                throw EvalError("heap limit of " + std::to_string(opts.max_heap_bytes >> 20) + " MB exhausted");
+            default:
+                break;
+            }
+
+            index();
+            std::vector<bool> needed = demanded();
+            std::vector<Redex> later;
+            Worker &w = *workers[0];
+            try {
+                for (size_t i = 0; i < dormant.size(); i++) {
+                    if (needed[i]) {
+                        unfold(w, dormant[i]);
+                    } else {
+                        later.push_back(dormant[i]);
+                    }
+                }
+            } catch (const Abort &) {
+                throw EvalError("heap limit of " + std::to_string(opts.max_heap_bytes >> 20) + " MB exhausted");
+            }
+            if (later.size() == dormant.size()) return;
+            dormant.swap(later);
+        }
+    }
+
+    std::string evaluate(size_t i) {
+        reset();
+        Worker &w = *workers[0];
+        try {
+            Scope scope;
+            root = build(w, program.terms, program.expressions[i].term, scope);
+            build_globals(w);
+        } catch (const Abort &) {
+            throw EvalError("heap limit of " + std::to_string(opts.max_heap_bytes >> 20) + " MB exhausted");
+        }
+        stats.agents += w.agent_next;
+        normalize();
+        return read_back();
+    }
+};
+
+NetReducer::NetReducer(const LcProgram &program, EvalOptions opts, unsigned threads)
+    : m(std::make_unique<Impl>(program, opts, threads)) {}
+
+NetReducer::~NetReducer() = default;
+
+void NetReducer::set_threads(unsigned threads) {
+    m->set_threads(threads);
+}
+
+unsigned NetReducer::threads() const {
+    return static_cast<unsigned>(m->workers.size());
+}
+
+size_t NetReducer::expressions() const {
+    return m->program.expressions.size();
+}
+
+std::string NetReducer::evaluate(size_t i) {
+    return m->evaluate(i);
+}
+
+const InetStats &NetReducer::stats() const {
+    return m->stats;
+}
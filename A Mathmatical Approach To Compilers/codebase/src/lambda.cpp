@@ -0,0 +1,457 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: hash-consed λ-term IR and its .lc printer (AST -> λ-DAG -> text)
+***************************************************************************************/
+
+#include "lambda.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+
+namespace {
+
+// Slots for n nodes at most half full: a power of two, at least 1024.
+size_t slots_for(size_t n) {
+    size_t count = 1024;
+    while (count < 2 * n) count *= 2;
+    return count;
+}
+
+} // namespace
+
+TermId TermTable::make(TermKind kind, uint32_t a, uint32_t b) {
+    Term key{kind, a, b};
+    if (slots.size() < 2 * (nodes.size() + 1)) rehash(slots_for(nodes.size() + 1));
+    size_t mask = slots.size() - 1;
+    size_t i = TermHash{}(key) & mask;
+    for (; slots[i] != EMPTY; i = (i + 1) & mask) {
+        if (nodes[slots[i]] == key) return slots[i];
+    }
+    if (nodes.size() >= EMPTY) {
+        throw std::runtime_error("λ-term table exceeded 2^32 nodes");
+    }
+    TermId id = static_cast<TermId>(nodes.size());
+    nodes.push_back(key);
+    slots[i] = id;
+    return id;
+}
+
+void TermTable::rehash(size_t slot_count) {
+    slots.assign(slot_count, EMPTY);
+    size_t mask = slot_count - 1;
+    for (size_t id = 0; id < nodes.size(); id++) {
+        size_t i = TermHash{}(nodes[id]) & mask;
+        while (slots[i] != EMPTY) i = (i + 1) & mask;
+        slots[i] = static_cast<TermId>(id);
+    }
+}
+
+void TermTable::clear() {
+    // sized for the form just done, so a run of small forms after a large
+    // one does not keep clearing the large one's table
+    size_t count = slots_for(nodes.size());
+    nodes.clear();
+    if (slots.size() > count) {
+        slots.assign(count, EMPTY);
+    } else {
+        std::fill(slots.begin(), slots.end(), EMPTY);
+    }
+    symbols.clear();
+}
+
+// Church numeral strings shared by every translating thread. The key space
+// is split over shards so that concurrent lookups rarely touch the same
+// lock, and hits only take it in shared mode. Each shard keeps to its slice
+// of the byte budget with CLOCK eviction: a hit sets the entry's reference
+// bit, and the eviction hand clears bits until it finds an entry nobody
+// touched since the last sweep. Callers hold a shared_ptr, so evicting an
+// entry never invalidates text that is still being printed.
+class NumeralCache {
+public:
+    using Text = std::shared_ptr<const std::string>;
+
+    template <typename Build>
+    Text get(uint32_t n, Build build) {
+        Shard &shard = shards[n % SHARDS];
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.m);
+            auto it = shard.index.find(n);
+            if (it != shard.index.end()) {
+                Entry &e = *shard.ring[it->second];
+                e.referenced.store(true, std::memory_order_relaxed);
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return e.text;
+            }
+        }
+        Text value = std::make_shared<const std::string>(build(n));
+        misses.fetch_add(1, std::memory_order_relaxed);
+        size_t shard_budget = budget.load(std::memory_order_relaxed) / SHARDS;
+        if (value->size() > shard_budget) return value;
+
+        std::unique_lock<std::shared_mutex> lock(shard.m);
+        auto it = shard.index.find(n);
+        if (it != shard.index.end()) return shard.ring[it->second]->text;
+        while (!shard.ring.empty() && shard.bytes + value->size() > shard_budget) {
+            evict_one(shard);
+        }
+        shard.index.emplace(n, shard.ring.size());
+        shard.ring.push_back(std::make_unique<Entry>(n, value));
+        shard.bytes += value->size();
+        return value;
+    }
+
+    void set_budget(size_t bytes) { budget.store(bytes, std::memory_order_relaxed); }
+
+    NumeralCacheStats stats() {
+        NumeralCacheStats st;
+        for (auto &shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.m);
+            st.entries += shard.ring.size();
+            st.bytes += shard.bytes;
+        }
+        st.hits = hits.load();
+        st.misses = misses.load();
+        st.evictions = evictions.load();
+        st.budget = budget.load();
+        return st;
+    }
+
+    void clear() {
+        for (auto &shard : shards) {
+            std::unique_lock<std::shared_mutex> lock(shard.m);
+            shard.index.clear();
+            shard.ring.clear();
+            shard.hand = 0;
+            shard.bytes = 0;
+        }
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+    }
+
+private:
+    static constexpr size_t SHARDS = 16;
+    struct Entry {
+        Entry(uint32_t k, Text t) : key(k), text(std::move(t)) {}
+        uint32_t key;
+        Text text;
+        std::atomic<bool> referenced{false};
+    };
+    struct Shard {
+        std::shared_mutex m;
+        std::unordered_map<uint32_t, size_t> index;
+        std::vector<std::unique_ptr<Entry>> ring;
+        size_t hand = 0;
+        size_t bytes = 0;
+    };
+
+    // caller holds the shard's unique lock
+    void evict_one(Shard &shard) {
+        for (;;) {
+            if (shard.hand >= shard.ring.size()) shard.hand = 0;
+            Entry &e = *shard.ring[shard.hand];
+            if (e.referenced.exchange(false, std::memory_order_relaxed)) {
+                shard.hand++;
+                continue;
+            }
+            shard.bytes -= e.text->size();
+            shard.index.erase(e.key);
+            if (shard.hand != shard.ring.size() - 1) {
+                shard.ring[shard.hand] = std::move(shard.ring.back());
+                shard.index[shard.ring[shard.hand]->key] = shard.hand;
+            }
+            shard.ring.pop_back();
+            evictions.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    Shard shards[SHARDS];
+    std::atomic<size_t> budget{64u << 20};
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+    std::atomic<size_t> evictions{0};
+};
+
+static NumeralCache numeral_cache;
+
+// λf.λx.f (f (f x)) -- each application wraps the next, so n = 3 reads
+// as f applied three times rather than ((f f) f) x
+static std::string build_church_numeral(uint32_t n) {
+    std::string result;
+    if (n == 0) {
+        result = "λf.λx.x";
+    } else {
+        result = "λf.λx.";
+        result.reserve(result.size() + 4 * static_cast<size_t>(n));
+        for (uint32_t i = 1; i < n; ++i) {
+            result += "f (";
+        }
+        result += "f x";
+        result.append(n - 1, ')');
+    }
+    return result;
+}
+
+std::shared_ptr<const std::string> church_numeral_text(uint32_t n) {
+    return numeral_cache.get(n, build_church_numeral);
+}
+
+NumeralCacheStats numeral_cache_stats() {
+    return numeral_cache.stats();
+}
+
+void set_numeral_cache_limit(size_t bytes) {
+    numeral_cache.set_budget(bytes);
+}
+
+void clear_numeral_cache() {
+    numeral_cache.clear();
+}
+
+namespace {
+
+std::string_view const_text(Builtin b, bool by_name) {
+    return by_name ? builtin_name(b) : builtin_text(b);
+}
+
+// Shared by print_term and print_shared. When hoisted/names are set, any
+// hoisted node below the top is printed as its binding name instead.
+struct Printer {
+    const TermTable &terms;
+    Emitter &out;
+    const std::vector<char> *hoisted = nullptr;
+    const std::vector<std::string> *names = nullptr;
+    bool builtin_names = false;
+    PrintProfile *profile = nullptr;
+
+    // Output still to write, last first: a term, or literal text between
+    // the parts of an application. Kept on the heap so deep terms cannot
+    // overflow the stack.
+    struct Item {
+        TermId id;
+        const char *text;
+        bool top;
+    };
+    std::vector<Item> todo{};
+
+    void print(TermId root, bool top = false) {
+        todo.push_back({root, nullptr, top});
+        while (!todo.empty()) {
+            Item item = todo.back();
+            todo.pop_back();
+            if (item.text) {
+                out << item.text;
+                continue;
+            }
+            TermId id = item.id;
+            if (!item.top && hoisted && (*hoisted)[id]) {
+                out << (*names)[id];
+                continue;
+            }
+            const Term &t = terms[id];
+            switch (t.kind) {
+            case TermKind::Var:
+                out << terms.name(t.a);
+                break;
+            case TermKind::Lam:
+                out << "λ" << terms.name(t.a) << '.';
+                todo.push_back({t.b, nullptr, false});
+                break;
+            case TermKind::App:
+                out << '(';
+                todo.push_back({0, ")", false});
+                todo.push_back({t.b, nullptr, false});
+                todo.push_back({0, " ", false});
+                if (is_lambda(t.a)) {
+                    out << '(';
+                    todo.push_back({0, ")", false});
+                }
+                todo.push_back({t.a, nullptr, false});
+                break;
+            case TermKind::Const: {
+                std::string_view text = const_text(static_cast<Builtin>(t.a), builtin_names);
+                out << text;
+                if (profile) {
+                    profile->builtin_uses[t.a]++;
+                    profile->builtin_bytes[t.a] += text.size();
+                }
+                break;
+            }
+            case TermKind::Num: {
+                auto text = church_numeral_text(t.a);
+                out << *text;
+                if (profile) {
+                    PrintProfile::Numeral &n = profile->numerals[t.a];
+                    n.uses++;
+                    n.bytes += text->size();
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    // A numeral prints as its λ-abstraction, so it needs parentheses in
+    // function position too.
+    bool is_lambda(TermId id) const {
+        if (hoisted && (*hoisted)[id]) return false;
+        TermKind k = terms[id].kind;
+        return k == TermKind::Lam || k == TermKind::Num;
+    }
+};
+
+uint64_t sat_add(uint64_t a, uint64_t b) {
+    uint64_t r = a + b;
+    return r < a ? UINT64_MAX : r;
+}
+
+uint64_t sat_mul(uint64_t a, uint64_t b) {
+    if (a != 0 && b > UINT64_MAX / a) return UINT64_MAX;
+    return a * b;
+}
+
+} // namespace
+
+uint64_t church_numeral_length(uint32_t n) {
+    // "λf.λx." is 8 bytes, then "f (" per nested application, "f x" and
+    // the closing parens
+    return n == 0 ? 9 : 7 + 4 * static_cast<uint64_t>(n);
+}
+
+void print_term(const TermTable &terms, TermId root, Emitter &out, bool builtin_names,
+                PrintProfile *profile) {
+    Printer printer{terms, out};
+    printer.builtin_names = builtin_names;
+    printer.profile = profile;
+    printer.print(root, true);
+}
+
+size_t print_shared(const TermTable &terms, TermId root, Emitter &out, bool builtin_names,
+                    PrintProfile *profile) {
+    size_t n = static_cast<size_t>(root) + 1;
+
+    std::vector<char> reach(n, 0);
+    std::vector<TermId> stack{root};
+    reach[root] = 1;
+    while (!stack.empty()) {
+        const Term &t = terms[stack.back()];
+        stack.pop_back();
+        if (t.kind == TermKind::App && !reach[t.a]) {
+            reach[t.a] = 1;
+            stack.push_back(t.a);
+        }
+        if ((t.kind == TermKind::App || t.kind == TermKind::Lam) && !reach[t.b]) {
+            reach[t.b] = 1;
+            stack.push_back(t.b);
+        }
+    }
+
+    // names bound by some λ in this form; a subterm mentioning any of them
+    // freely cannot be lifted to the top
+    std::vector<uint32_t> bound;
+    for (size_t id = 0; id < n; id++) {
+        if (reach[id] && terms[id].kind == TermKind::Lam) bound.push_back(terms[id].a);
+    }
+    std::sort(bound.begin(), bound.end());
+    bound.erase(std::unique(bound.begin(), bound.end()), bound.end());
+
+    // children first: free bound-names and printed length of every node
+    std::vector<std::vector<uint32_t>> fv(n);
+    std::vector<uint64_t> len(n, 0);
+    for (size_t id = 0; id < n; id++) {
+        if (!reach[id]) continue;
+        const Term &t = terms[id];
+        switch (t.kind) {
+        case TermKind::Var:
+            if (std::binary_search(bound.begin(), bound.end(), t.a)) fv[id].push_back(t.a);
+            len[id] = terms.name(t.a).size();
+            break;
+        case TermKind::Lam:
+            for (uint32_t v : fv[t.b]) {
+                if (v != t.a) fv[id].push_back(v);
+            }
+            len[id] = sat_add(3 + terms.name(t.a).size(), len[t.b]);
+            break;
+        case TermKind::App:
+            std::set_union(fv[t.a].begin(), fv[t.a].end(), fv[t.b].begin(), fv[t.b].end(),
+                           std::back_inserter(fv[id]));
+            len[id] = sat_add(sat_add(3, len[t.a]), len[t.b]);
+            if (terms[t.a].kind == TermKind::Lam || terms[t.a].kind == TermKind::Num) {
+                len[id] = sat_add(len[id], 2);
+            }
+            break;
+        case TermKind::Const:
+            len[id] = const_text(static_cast<Builtin>(t.a), builtin_names).size();
+            break;
+        case TermKind::Num:
+            len[id] = church_numeral_length(t.a);
+            break;
+        }
+    }
+
+    // parents first: how often each node would be printed, given the
+    // hoisting decisions already made above it
+    const uint64_t NAME_LEN = 6;
+    std::vector<uint64_t> uses(n, 0);
+    std::vector<char> hoisted(n, 0);
+    uses[root] = 1;
+    size_t bindings = 0;
+    for (size_t id = n; id-- > 0;) {
+        if (!reach[id] || uses[id] == 0) continue;
+        const Term &t = terms[id];
+        if (id != root && uses[id] >= 2 && fv[id].empty()) {
+            uint64_t inline_cost = sat_mul(uses[id], len[id]);
+            uint64_t shared_cost = sat_add(len[id], sat_mul(uses[id] + 1, NAME_LEN) + 9);
+            if (shared_cost < inline_cost) {
+                hoisted[id] = 1;
+                bindings++;
+            }
+        }
+        uint64_t passed = hoisted[id] ? 1 : uses[id];
+        if (t.kind == TermKind::App) uses[t.a] = sat_add(uses[t.a], passed);
+        if (t.kind == TermKind::App || t.kind == TermKind::Lam) uses[t.b] = sat_add(uses[t.b], passed);
+    }
+
+    Printer printer{terms, out};
+    printer.builtin_names = builtin_names;
+    printer.profile = profile;
+    if (bindings == 0) {
+        printer.print(root, true);
+        return 0;
+    }
+
+    // binding names that cannot collide with anything in the form
+    std::vector<std::string> names(n);
+    std::vector<TermId> order;
+    std::string prefix = "_cse";
+    size_t next = 0;
+    for (size_t id = 0; id < n; id++) {
+        if (!hoisted[id]) continue;
+        std::string name;
+        do {
+            name = prefix + std::to_string(next++);
+        } while (terms.has_symbol(name));
+        names[id] = std::move(name);
+        order.push_back(static_cast<TermId>(id));
+    }
+
+    // smaller ids are subterms of larger ones, so binding in id order puts
+    // every definition in scope of the names it refers to
+    printer.hoisted = &hoisted;
+    printer.names = &names;
+    for (TermId id : order) {
+        out << "((λ" << names[id] << '.';
+    }
+    printer.print(root, true);
+    for (size_t k = order.size(); k-- > 0;) {
+        out << ") ";
+        printer.print(order[k], true);
+        out << ')';
+    }
+    return bindings;
+}
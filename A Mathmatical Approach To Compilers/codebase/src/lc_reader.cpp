@@ -0,0 +1,162 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: reader for generated .lc text (LC text -> λ-term IR)
+***************************************************************************************/
+
+#include "lc_reader.hpp"
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+class LineReader {
+public:
+    LineReader(std::string_view line, int line_no, TermTable &tt, size_t col_base = 0)
+        : s(line), line_no(line_no), col_base(col_base), tt(tt) {}
+
+    // Reads without recursion, so nesting depth is bounded by memory rather
+    // than the native stack. Every open application spine, λ body and
+    // parenthesis is a Frame on an explicit stack; a spine ends at ')' or the
+    // end of the line, and a λ inside it runs to the end of the spine.
+    TermId term() {
+        std::vector<Frame> stack{{Kind::Spine, NONE, {}}};
+        for (;;) {
+            skip_ws();
+            if (at_lambda()) {
+                i += s[i] == '\\' ? 1 : LAMBDA.size();
+                std::string_view param = name();
+                if (!take(".")) fail("expected '.' after λ" + std::string(param));
+                stack.push_back({Kind::Lambda, NONE, param});
+                stack.push_back({Kind::Spine, NONE, {}});
+                continue;
+            }
+            Frame &spine = stack.back();
+            if (spine.f == NONE || (i < s.size() && s[i] != ')')) {
+                if (i >= s.size()) fail("unexpected end of line");
+                if (s[i] == ')') fail("unexpected ')'");
+                if (s[i] == '(') {
+                    i++;
+                    stack.push_back({Kind::Paren, NONE, {}});
+                    stack.push_back({Kind::Spine, NONE, {}});
+                    continue;
+                }
+                extend(spine, tt.var(name()));
+                continue;
+            }
+
+            // The spine is finished; hand it up until a parenthesis takes it
+            // as an atom of the spine around it.
+            TermId t = spine.f;
+            stack.pop_back();
+            for (;;) {
+                if (stack.empty()) return t;
+                Frame &up = stack.back();
+                if (up.kind == Kind::Paren) {
+                    if (!take(")")) fail("expected ')'");
+                    stack.pop_back();
+                    extend(stack.back(), t);
+                    break;
+                }
+                t = tt.lam(up.param, t);
+                stack.pop_back();
+                if (stack.back().f != NONE) t = tt.app(stack.back().f, t);
+                stack.pop_back();
+            }
+        }
+    }
+
+    bool at_end() {
+        skip_ws();
+        return i >= s.size();
+    }
+
+    std::string_view name() {
+        skip_ws();
+        size_t start = i;
+        while (i < s.size() && !is_delimiter(i)) i++;
+        if (i == start) fail("expected a name");
+        return s.substr(start, i - start);
+    }
+
+    bool take(std::string_view tok) {
+        skip_ws();
+        if (s.substr(i, tok.size()) != tok) return false;
+        i += tok.size();
+        return true;
+    }
+
+    [[noreturn]] void fail(const std::string &what) const {
+        throw std::runtime_error(".lc syntax error at line " + std::to_string(line_no) +
+                                 ", col " + std::to_string(col_base + i + 1) + ": " + what);
+    }
+
+private:
+    std::string_view s;
+    size_t i = 0;
+    int line_no;
+    size_t col_base;
+    TermTable &tt;
+
+    static constexpr std::string_view LAMBDA = "λ";
+    static constexpr TermId NONE = UINT32_MAX;
+
+    enum class Kind { Spine, Lambda, Paren };
+    struct Frame {
+        Kind kind;
+        TermId f;  // Spine: the application read so far, NONE before its first atom
+        std::string_view param;
+    };
+
+    void skip_ws() {
+        while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r')) i++;
+    }
+
+    bool at_lambda() const {
+        return i < s.size() && (s[i] == '\\' || s.substr(i, LAMBDA.size()) == LAMBDA);
+    }
+
+    bool is_delimiter(size_t k) const {
+        char c = s[k];
+        return c == ' ' || c == '\t' || c == '\r' || c == '(' || c == ')' || c == '.' ||
+               c == '\\' || s.substr(k, LAMBDA.size()) == LAMBDA;
+    }
+
+    void extend(Frame &spine, TermId atom) {
+        spine.f = spine.f == NONE ? atom : tt.app(spine.f, atom);
+    }
+};
+
+} // namespace
+
+void read_lc(std::string_view text, LcProgram &program) {
+    int line_no = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        line_no++;
+
+        LineReader reader(line, line_no, program.terms);
+        if (reader.at_end()) continue;
+
+        size_t def = line.find(" := ");
+        if (def != std::string_view::npos) {
+            LineReader head(line.substr(0, def), line_no, program.terms);
+            std::string name(head.name());
+            if (!head.at_end()) head.fail("malformed definition name");
+            LineReader body(line.substr(def + 4), line_no, program.terms, def + 4);
+            TermId term = body.term();
+            if (!body.at_end()) body.fail("unexpected text after definition");
+            program.definitions.push_back({std::move(name), term, line_no});
+            continue;
+        }
+
+        TermId term = reader.term();
+        if (!reader.at_end()) reader.fail("unexpected ')'");
+        program.expressions.push_back({term, line_no});
+    }
+}
@@ -0,0 +1,395 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: binary λ-term IR (λ-DAG <-> .lcb records)
+***************************************************************************************/
+
+#include "lcb.hpp"
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'C', 'B', '\0'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 8;
+constexpr size_t TRAILER_SIZE = 16;
+
+enum Tag : uint8_t { VAR, FREE, LAM, APP, CONST, NUM };
+
+// a and b are operands or absolute node indices, depending on the tag
+struct Node {
+    uint8_t tag;
+    uint32_t a;
+    uint32_t b;
+    bool operator==(const Node &o) const { return tag == o.tag && a == o.a && b == o.b; }
+};
+
+struct NodeHash {
+    size_t operator()(const Node &n) const {
+        uint64_t h = (static_cast<uint64_t>(n.a) << 32) | n.b;
+        h ^= static_cast<uint64_t>(n.tag) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+void put_varint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void put_u64(Emitter &out, uint64_t v) {
+    char bytes[8];
+    for (int i = 0; i < 8; i++) bytes[i] = static_cast<char>(v >> (8 * i));
+    out << std::string_view(bytes, 8);
+}
+
+uint64_t get_u64(const char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+[[noreturn]] void corrupt(const std::string &what) {
+    throw std::runtime_error("corrupt .lcb file: " + what);
+}
+
+class Encoder {
+public:
+    explicit Encoder(const TermTable &terms) : terms(terms) {}
+
+    // Post-order walk on a heap stack: a node's children are encoded (the
+    // function before the argument) before the node itself.
+    uint32_t encode(TermId root) {
+        struct Step {
+            TermId id;
+            bool children_done;
+        };
+        std::vector<Step> stack{{root, false}};
+        std::vector<uint32_t> results;
+        while (!stack.empty()) {
+            Step step = stack.back();
+            stack.pop_back();
+            const Term &t = terms[step.id];
+            if (step.children_done) {
+                uint32_t second = results.back();
+                results.pop_back();
+                if (t.kind == TermKind::Lam) {
+                    scope.pop_back();
+                    results.push_back(node(LAM, second, 0));
+                } else {
+                    uint32_t first = results.back();
+                    results.pop_back();
+                    results.push_back(node(APP, first, second));
+                }
+                continue;
+            }
+            switch (t.kind) {
+            case TermKind::Var:
+                results.push_back(variable(t.a));
+                break;
+            case TermKind::Lam:
+                scope.push_back(t.a);
+                stack.push_back({step.id, true});
+                stack.push_back({t.b, false});
+                break;
+            case TermKind::App:
+                stack.push_back({step.id, true});
+                stack.push_back({t.b, false});
+                stack.push_back({t.a, false});
+                break;
+            case TermKind::Const:
+                results.push_back(node(CONST, t.a, 0));
+                break;
+            case TermKind::Num:
+                results.push_back(node(NUM, t.a, 0));
+                break;
+            }
+        }
+        return results.back();
+    }
+
+    void write(std::string &record) const {
+        put_varint(record, names.size());
+        for (uint32_t sym : names) {
+            std::string_view name = terms.name(sym);
+            put_varint(record, name.size());
+            record.append(name.data(), name.size());
+        }
+        put_varint(record, nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const Node &n = nodes[i];
+            switch (n.tag) {
+            case LAM:
+                put_varint(record, (static_cast<uint64_t>(i - n.a) << 3) | n.tag);
+                break;
+            case APP:
+                put_varint(record, (static_cast<uint64_t>(i - n.a) << 3) | n.tag);
+                put_varint(record, i - n.b);
+                break;
+            default:
+                put_varint(record, (static_cast<uint64_t>(n.a) << 3) | n.tag);
+                break;
+            }
+        }
+    }
+
+private:
+    const TermTable &terms;
+    std::vector<uint32_t> scope;
+    std::vector<Node> nodes;
+    std::unordered_map<Node, uint32_t, NodeHash> unique;
+    std::vector<uint32_t> names;
+    std::unordered_map<uint32_t, uint32_t> name_ids;
+
+    // de Bruijn index of the innermost binder of sym, or a free name
+    uint32_t variable(uint32_t sym) {
+        for (size_t k = scope.size(); k-- > 0;) {
+            if (scope[k] == sym) return node(VAR, static_cast<uint32_t>(scope.size() - 1 - k), 0);
+        }
+        return node(FREE, free_name(sym), 0);
+    }
+
+    uint32_t node(uint8_t tag, uint32_t a, uint32_t b) {
+        Node key{tag, a, b};
+        auto it = unique.find(key);
+        if (it != unique.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(key);
+        unique.emplace(key, id);
+        return id;
+    }
+
+    uint32_t free_name(uint32_t sym) {
+        auto it = name_ids.find(sym);
+        if (it != name_ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(names.size());
+        names.push_back(sym);
+        name_ids.emplace(sym, id);
+        return id;
+    }
+};
+
+class Decoder {
+public:
+    Decoder(std::string_view record, TermTable &terms) : s(record), terms(terms) {}
+
+    TermId decode() {
+        uint64_t name_count = varint();
+        for (uint64_t i = 0; i < name_count; i++) {
+            uint64_t len = varint();
+            if (len > s.size() - pos) corrupt("name runs past the record");
+            names.push_back(s.substr(pos, len));
+            pos += len;
+        }
+        uint64_t node_count = varint();
+        if (node_count == 0) corrupt("empty form");
+        for (uint64_t i = 0; i < node_count; i++) {
+            uint64_t head = varint();
+            Node n{static_cast<uint8_t>(head & 7), 0, 0};
+            uint64_t op = head >> 3;
+            switch (n.tag) {
+            case LAM:
+                n.a = back(i, op);
+                break;
+            case APP:
+                n.a = back(i, op);
+                n.b = back(i, varint());
+                break;
+            case FREE:
+                if (op >= names.size()) corrupt("free name out of range");
+                n.a = static_cast<uint32_t>(op);
+                break;
+            case CONST:
+                if (op >= BUILTIN_COUNT) corrupt("unknown builtin");
+                n.a = static_cast<uint32_t>(op);
+                break;
+            case VAR:
+            case NUM:
+                if (op > UINT32_MAX) corrupt("operand out of range");
+                n.a = static_cast<uint32_t>(op);
+                break;
+            default:
+                corrupt("unknown node tag");
+            }
+            nodes.push_back(n);
+        }
+        pick_prefix();
+        return named(static_cast<uint32_t>(nodes.size() - 1));
+    }
+
+private:
+    std::string_view s;
+    size_t pos = 0;
+    TermTable &terms;
+    std::vector<std::string_view> names;
+    std::vector<Node> nodes;
+    std::unordered_map<uint64_t, TermId> memo;
+    std::string prefix = "v";
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= s.size()) corrupt("record ends inside a varint");
+            unsigned char c = static_cast<unsigned char>(s[pos++]);
+            v |= static_cast<uint64_t>(c & 0x7F) << shift;
+            if (!(c & 0x80)) return v;
+        }
+        corrupt("varint too long");
+    }
+
+    uint32_t back(uint64_t self, uint64_t distance) {
+        if (distance == 0 || distance > self) corrupt("node refers forward");
+        return static_cast<uint32_t>(self - distance);
+    }
+
+    // binder names are prefix + depth; lengthen the prefix until no free
+    // name has that shape
+    void pick_prefix() {
+        for (bool clash = true; clash;) {
+            clash = false;
+            for (std::string_view name : names) {
+                if (name.size() > prefix.size() && name.substr(0, prefix.size()) == prefix &&
+                    name.find_first_not_of("0123456789", prefix.size()) == std::string_view::npos) {
+                    clash = true;
+                    prefix += '_';
+                    break;
+                }
+            }
+        }
+    }
+
+    // The same node can sit under different numbers of binders, and its
+    // named form depends on that depth. Post-order walk on a heap stack, as
+    // in Encoder::encode: a node is named once its children are (the
+    // function before the argument).
+    TermId named(uint32_t root) {
+        struct Step {
+            uint32_t id;
+            uint32_t depth;
+            bool children_done;
+        };
+        std::vector<Step> stack{{root, 0, false}};
+        std::vector<TermId> results;
+        while (!stack.empty()) {
+            Step step = stack.back();
+            stack.pop_back();
+            uint64_t key = (static_cast<uint64_t>(step.id) << 32) | step.depth;
+            const Node &n = nodes[step.id];
+            TermId out = 0;
+            if (step.children_done) {
+                TermId second = results.back();
+                results.pop_back();
+                if (n.tag == LAM) {
+                    out = terms.lam(prefix + std::to_string(step.depth), second);
+                } else {
+                    TermId first = results.back();
+                    results.pop_back();
+                    out = terms.app(first, second);
+                }
+                memo.emplace(key, out);
+                results.push_back(out);
+                continue;
+            }
+            auto it = memo.find(key);
+            if (it != memo.end()) {
+                results.push_back(it->second);
+                continue;
+            }
+            switch (n.tag) {
+            case VAR:
+                if (n.a >= step.depth) corrupt("unbound de Bruijn index");
+                out = terms.var(prefix + std::to_string(step.depth - 1 - n.a));
+                break;
+            case FREE:
+                out = terms.var(names[n.a]);
+                break;
+            case LAM:
+                stack.push_back({step.id, step.depth, true});
+                stack.push_back({n.a, step.depth + 1, false});
+                continue;
+            case APP:
+                stack.push_back({step.id, step.depth, true});
+                stack.push_back({n.b, step.depth, false});
+                stack.push_back({n.a, step.depth, false});
+                continue;
+            case CONST:
+                out = terms.constant(static_cast<Builtin>(n.a));
+                break;
+            case NUM:
+                out = terms.num(n.a);
+                break;
+            }
+            memo.emplace(key, out);
+            results.push_back(out);
+        }
+        return results.back();
+    }
+};
+
+} // namespace
+
+void encode_lcb_form(const TermTable &terms, TermId root, std::string &record) {
+    Encoder encoder(terms);
+    encoder.encode(root);
+    record.clear();
+    encoder.write(record);
+}
+
+LcbWriter::LcbWriter(Emitter &out) : out(out) {
+    char version[4];
+    for (int i = 0; i < 4; i++) version[i] = static_cast<char>(VERSION >> (8 * i));
+    out << std::string_view(MAGIC, 4) << std::string_view(version, 4);
+}
+
+void LcbWriter::add_form(std::string_view record) {
+    index.emplace_back(out.size(), record.size());
+    out << record;
+}
+
+void LcbWriter::finish() {
+    uint64_t index_offset = out.size();
+    for (const auto &entry : index) {
+        put_u64(out, entry.first);
+        put_u64(out, entry.second);
+    }
+    put_u64(out, index_offset);
+    put_u64(out, index.size());
+    out.flush();
+}
+
+LcbFile::LcbFile(const std::string &path) : file(path) {
+    const char *p = file.data();
+    size_t n = file.size();
+    if (n < HEADER_SIZE + TRAILER_SIZE || std::string_view(p, 4) != std::string_view(MAGIC, 4)) {
+        throw std::runtime_error("'" + path + "' is not an .lcb file");
+    }
+    uint32_t version = static_cast<uint32_t>(get_u64(p + 4) & 0xFFFFFFFFu);
+    if (version != VERSION) {
+        throw std::runtime_error("'" + path + "' has unsupported .lcb version " + std::to_string(version));
+    }
+    index_offset = get_u64(p + n - TRAILER_SIZE);
+    count = get_u64(p + n - TRAILER_SIZE + 8);
+    if (index_offset < HEADER_SIZE || index_offset > n - TRAILER_SIZE ||
+        count != (n - TRAILER_SIZE - index_offset) / 16 ||
+        (n - TRAILER_SIZE - index_offset) % 16 != 0) {
+        corrupt("bad index");
+    }
+}
+
+TermId LcbFile::load_form(size_t i, TermTable &terms) const {
+    if (i >= count) throw std::out_of_range("form index out of range");
+    const char *entry = file.data() + index_offset + 16 * i;
+    uint64_t offset = get_u64(entry);
+    uint64_t size = get_u64(entry + 8);
+    if (offset < HEADER_SIZE || offset > index_offset || size > index_offset - offset) {
+        corrupt("record out of bounds");
+    }
+    return Decoder(file.view().substr(offset, size), terms).decode();
+}
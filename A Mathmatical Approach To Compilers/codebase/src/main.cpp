@@ -9,6 +9,20 @@
 
 #include "parser.hpp"
 #include "translator.hpp"
+#include "mapped_file.hpp"
+#include "form_reader.hpp"
+#include "thread_pool.hpp"
+#include "evaluator.hpp"
+#include "lc_reader.hpp"
+#include "lcb.hpp"
+#include "fold.hpp"
+#include "form_cache.hpp"
+#include "server.hpp"
+#include "profile.hpp"
+#include "cbackend.hpp"
+#include "prescan.hpp"
+#include "combinators.hpp"
+#include "inet.hpp"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -17,6 +31,13 @@
 #include <vector>
 #include <chrono>
 #include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <optional>
+#include <thread>
 
 #include <sys/resource.h>
 #include <unistd.h>
@@ -28,32 +49,31 @@ struct MemoryStats {
     size_t compilation_peak = 0;
 };
 
-size_t get_memory_usage() {
+// One "Field:   N kB" line of /proc/self/status, in bytes.
+static size_t read_status_bytes(const char* field) {
     std::ifstream status("/proc/self/status");
     std::string line;
+    size_t len = std::strlen(field);
     while (std::getline(status, line)) {
-        if (line.substr(0, 6) == "VmRSS:") {
-            size_t kb;
-            if (std::sscanf(line.c_str(), "VmRSS: %zu kB", &kb) == 1) {
-                return kb * 1024;
-            }
+        if (line.compare(0, len, field) == 0 && line.size() > len && line[len] == ':') {
+            return static_cast<size_t>(std::strtoull(line.c_str() + len + 1, nullptr, 10)) * 1024;
         }
     }
     return 0;
 }
 
+size_t get_memory_usage() {
+    return read_status_bytes("VmRSS");
+}
+
 size_t get_virtual_memory_usage() {
-    std::ifstream status("/proc/self/status");
-    std::string line;
-    while (std::getline(status, line)) {
-        if (line.substr(0, 6) == "VmSize:") {
-            size_t kb;
-            if (std::sscanf(line.c_str(), "VmSize: %zu kB", &kb) == 1) {
-                return kb * 1024;
-            }
-        }
-    }
-    return 0;
+    return read_status_bytes("VmSize");
+}
+
+size_t get_peak_memory_usage() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
 }
 
 std::string format_bytes(size_t bytes) {
@@ -72,15 +92,70 @@ std::string format_bytes(size_t bytes) {
 }
 
 void print_usage(const char* program_name) {
-    std::cout << "Usage: " << program_name << " <file.lctest> [options]\n\n";
+    std::cout << "Usage: " << program_name << " <file.lctest> [options]\n";
+    std::cout << "       " << program_name << " <file.lctest|dir|@manifest>... [options]   (batch)\n\n";
     std::cout << "Options:\n";
     std::cout << "  --stats    Show compilation statistics\n";
+    std::cout << "  --arena    Parse into a flat arena AST with interned atoms\n";
+    std::cout << "  --mmap     Memory-map the input and tokenize it in place\n";
+    std::cout << "  --stream   Compile one top-level form at a time with bounded memory\n";
+    std::cout << "  --jobs N   Parse and translate top-level forms on N threads (output order is kept);\n";
+    std::cout << "             in batch mode, compile N files at once (default: all cores)\n";
+    std::cout << "  --prescan=auto|avx2|sse2|scalar\n";
+    std::cout << "             Instruction set for splitting the input into forms under --jobs\n";
+    std::cout << "  --cse      Print repeated subterms once per form, bound with let-style redexes\n";
+    std::cout << "  --fold     Evaluate constant arithmetic, comparisons and conditions at compile time\n";
+    std::cout << "  --optimize Inline bindings and β/η-reduce each form where that does not grow it\n";
+    std::cout << "  --opt-fuel N\n";
+    std::cout << "             Rewrites allowed per form with --optimize (default 10000)\n";
+    std::cout << "  --prelude  Define each builtin used once at the top of the file and refer to it by name\n";
+    std::cout << "  --numerals=unary|compact\n";
+    std::cout << "             Spell numerals out (default) or build large ones from base-16 digits\n";
+    std::cout << "  --numeral-cache MB\n";
+    std::cout << "             Memory bound for cached numeral text (default 64)\n";
+    std::cout << "  --emit=lc|lcb\n";
+    std::cout << "             Write .lc text (default) or the binary .lcb IR; an .lcb input is\n";
+    std::cout << "             decoded back to .lc\n";
+    std::cout << "  --cache DIR\n";
+    std::cout << "             Keep each form's IR in DIR and reuse it while the form is unchanged\n";
+    std::cout << "  --cache-size MB\n";
+    std::cout << "             Size limit of the --cache directory (default 256)\n";
+    std::cout << "  --profile=json|csv\n";
+    std::cout << "             Write per-phase allocations and times, per-form translate times and\n";
+    std::cout << "             output bytes by builtin and numeral to NAME.profile.json or .csv\n";
+    std::cout << "  --eval     Run the generated IR and print each line's value (also takes a .lc file)\n";
+    std::cout << "  --native   Also write the program as C (NAME.c) and build it with $CC (default cc)\n";
+    std::cout << "             into the executable NAME, which prints what --eval would (also takes\n";
+    std::cout << "             a .lc or .lcb file)\n";
+    std::cout << "  --ski      Also compile the program to S, K, I, B, C, S', B*, C' combinators\n";
+    std::cout << "             (NAME.ski) and run it with the graph reducer, printing what --eval\n";
+    std::cout << "             would (also takes a .lc or .lcb file)\n";
+    std::cout << "  --inet     Also reduce the program as an interaction net with optimal sharing on\n";
+    std::cout << "             --jobs threads (default: all cores), printing what --eval would\n";
+    std::cout << "             (also takes a .lc or .lcb file)\n";
+    std::cout << "  --inet-scaling\n";
+    std::cout << "             With --inet, time the reduction again on 1, 2, 4, ... --jobs threads\n";
+    std::cout << "  --native-numerals=machine|church\n";
+    std::cout << "             Run numerals and arithmetic builtins natively as machine integers\n";
+    std::cout << "             (default) or keep them Church-encoded\n";
+    std::cout << "  --max-steps N\n";
+    std::cout << "             Reduction budget per evaluated expression (default 10000000)\n";
+    std::cout << "  --serve PATH\n";
+    std::cout << "             Run as a compile server on the Unix socket PATH, keeping caches warm\n";
+    std::cout << "  --connect PATH\n";
+    std::cout << "             Compile the inputs (- for stdin) on the server at PATH; add\n";
+    std::cout << "             --server-stats for its request latencies or --shutdown to stop it\n";
     std::cout << "  --help     Show this help message\n\n";
     std::cout << "Input:  .lctest file containing S-expressions\n";
+    std::cout << "        Several files, a directory (every .lctest below it) or an @manifest\n";
+    std::cout << "        (one path per line) are compiled as a batch in one process\n";
     std::cout << "Output: .lc file containing lambda calculus IR\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << program_name << " factorial.lctest\n";
     std::cout << "  " << program_name << " arithmetic.lctest --stats\n";
+    std::cout << "  " << program_name << " arithmetic.lc --eval\n";
+    std::cout << "  " << program_name << " factorial.lctest --native && ./factorial\n";
+    std::cout << "  " << program_name << " corpus/ --jobs 8 --stats\n";
 }
 
 void print_compilation_stats(const std::chrono::duration<double>& parse_time,
@@ -90,6 +165,9 @@ void print_compilation_stats(const std::chrono::duration<double>& parse_time,
     std::cout << "\n=== Compilation Statistics ===\n";
     std::cout << std::fixed << std::setprecision(3);
     std::cout << "Parse time:      " << parse_time.count() * 1000 << " ms\n";
+    if (parse_time.count() > 0) {
+        std::cout << "Parse speed:     " << input_size / parse_time.count() / 1e9 << " GB/s\n";
+    }
     std::cout << "Translate time:  " << translate_time.count() * 1000 << " ms\n";
     std::cout << "Total time:      " << (parse_time + translate_time).count() * 1000 << " ms\n";
     std::cout << "Input size:      " << format_bytes(input_size) << "\n";
@@ -110,47 +188,759 @@ void print_compilation_stats(const std::chrono::duration<double>& parse_time,
     std::cout << "==============================\n";
 }
 
+// Samples memory once before compiling and once after. The kernel keeps
+// the high-water marks (ru_maxrss, VmPeak), so nothing has to be sampled
+// per form, where reading /proc would cost more than small forms do.
 class MemoryMonitor {
 private:
     MemoryStats& stats;
-    bool monitoring;
 
 public:
-    MemoryMonitor(MemoryStats& mem_stats) : stats(mem_stats), monitoring(false) {
+    MemoryMonitor(MemoryStats& mem_stats) : stats(mem_stats) {
         stats.initial_rss = get_memory_usage();
         stats.peak_rss = stats.initial_rss;
         stats.peak_virtual = get_virtual_memory_usage();
         stats.compilation_peak = stats.initial_rss;
     }
 
-    void start_monitoring() {
-        monitoring = true;
+    void stop_monitoring() {
+        stats.peak_rss = std::max(stats.peak_rss, get_peak_memory_usage());
+        stats.peak_virtual = std::max(stats.peak_virtual, read_status_bytes("VmPeak"));
+        stats.compilation_peak = stats.peak_rss;
+    }
+};
+
+// --cache DIR; set once in main() before anything is compiled
+static std::unique_ptr<FormCache> form_cache;
+
+// --profile=json|csv; the report is written next to the output as
+// NAME.profile.json or NAME.profile.csv
+static std::optional<ProfileFormat> profile_format;
+
+bool write_profile_report(const std::string& inputFile) {
+    if (!profile_format) return true;
+    std::filesystem::path path = inputFile;
+    path.replace_extension(*profile_format == ProfileFormat::Json ? ".profile.json" : ".profile.csv");
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: could not write profile '" << path << "'\n";
+        return false;
+    }
+    write_profile(out, *profile_format, inputFile);
+    std::cout << "  Profile: " << path << "\n";
+    return true;
+}
+
+// --stream: read, parse, translate and write one top-level form at a time.
+// Nothing outlives its form except the reader's chunk buffer, so peak
+// memory follows the largest form instead of the file size.
+int compile_stream(const std::string& inputFile, bool show_stats, bool use_arena, bool binary) {
+    std::ifstream in(inputFile, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: could not open input file '" << inputFile << "'\n";
+        std::cerr << "Please check that the file exists and is readable\n";
+        return 1;
+    }
+    std::filesystem::path outPath = inputFile;
+    outPath.replace_extension(binary ? ".lcb" : ".lc");
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: could not write to output file '" << outPath << "'\n";
+        std::cerr << "Please check directory permissions\n";
+        return 1;
     }
 
-    void update() {
-        if (!monitoring) return;
-        size_t current_rss = get_memory_usage();
-        size_t current_virtual = get_virtual_memory_usage();
-        if (current_rss > stats.peak_rss) {
-            stats.peak_rss = current_rss;
+    size_t initial_rss = get_memory_usage();
+    auto start = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> parse_time{0}, translate_time{0};
+    FormReader reader(in);
+    size_t forms = 0;
+    size_t output_size = 0;
+
+    try {
+        Emitter output(out);
+        // with --prelude each form is held back until the definitions it
+        // needs have been written ahead of it
+        bool prelude = translate_options().prelude;
+        Emitter held;
+        Emitter &sink = prelude ? held : output;
+        std::optional<LcbWriter> writer;
+        std::string record;
+        if (binary) writer.emplace(output);
+        AstArena arena;
+        std::string_view form;
+        auto next_form = [&] {
+            PhaseScope scope(Phase::Read);
+            return reader.next(form);
+        };
+        while (next_form()) {
+            auto parse_start = std::chrono::high_resolution_clock::now();
+            Parser parser(form, reader.line(), reader.col());
+            std::shared_ptr<SExpr> root;
+            {
+                PhaseScope scope(Phase::Parse);
+                if (use_arena) {
+                    parser.parse(arena);
+                } else {
+                    root = parser.parse();
+                }
+            }
+            if (translate_options().fold) {
+                PhaseScope scope(Phase::Fold);
+                if (use_arena) {
+                    fold_constants(arena, arena.root());
+                } else {
+                    fold_constants(root);
+                }
+            }
+            auto translate_start = std::chrono::high_resolution_clock::now();
+            // a slice is usually one form, but atoms the reader could not
+            // split ("42y") parse to several
+            size_t count = use_arena ? arena[arena.root()].count : root->list.size();
+            for (size_t i = 0; i < count; i++) {
+                uint32_t index = static_cast<uint32_t>(i);
+                if (binary) {
+                    if (use_arena) {
+                        translate_binary(arena, arena.child(arena.root(), index), record);
+                    } else {
+                        translate_binary(root->list[i], record);
+                    }
+                    writer->add_form(record);
+                    continue;
+                }
+                if (use_arena) {
+                    translate(arena, arena.child(arena.root(), index), sink);
+                } else {
+                    translate(root->list[i], sink);
+                }
+                if (prelude) {
+                    write_prelude(output);
+                    output << held.take();
+                }
+                output << '\n';
+            }
+            if (use_arena) arena.clear();
+            auto translate_end = std::chrono::high_resolution_clock::now();
+            parse_time += translate_start - parse_start;
+            translate_time += translate_end - translate_start;
+            forms += count;
         }
-        if (current_virtual > stats.peak_virtual) {
-            stats.peak_virtual = current_virtual;
+        if (writer) writer->finish();
+        output.flush();
+        output_size = output.size();
+        if (form_cache) form_cache->trim();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Compilation Error: " << e.what() << "\n";
+        out.close();
+        std::filesystem::remove(outPath);
+        return 1;
+    }
+    out.close();
+
+    if (forms == 0) {
+        std::cerr << "Error: input file is empty or contains only whitespace\n";
+        std::filesystem::remove(outPath);
+        return 1;
+    }
+
+    auto total_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+    size_t peak_rss = get_peak_memory_usage();
+
+    std::cout << "LC IR successfully generated (streamed)\n";
+    std::cout << "  Input:  " << inputFile << " (" << format_bytes(reader.bytes_read()) << ")\n";
+    std::cout << "  Output: " << outPath << " (" << format_bytes(output_size) << ")\n";
+    if (!write_profile_report(inputFile)) return 1;
+    if (show_stats) {
+        std::cout << "\n=== Compilation Statistics ===\n";
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Forms:           " << forms << "\n";
+        std::cout << "Parse time:      " << parse_time.count() * 1000 << " ms\n";
+        std::cout << "Translate time:  " << translate_time.count() * 1000 << " ms\n";
+        std::cout << "Total time:      " << total_us.count() / 1000.0 << " ms\n";
+        std::cout << "Largest form:    " << format_bytes(reader.largest_form()) << "\n";
+        std::cout << "Read buffer:     " << format_bytes(reader.buffer_peak()) << " peak\n";
+        std::cout << "\n--- Memory Usage ---\n";
+        std::cout << "Initial memory:  " << format_bytes(initial_rss) << "\n";
+        std::cout << "Peak memory:     " << format_bytes(peak_rss) << "\n";
+        std::cout << "Compilation overhead: "
+                  << format_bytes(peak_rss > initial_rss ? peak_rss - initial_rss : 0) << "\n";
+        print_cache_stats();
+        std::cout << "==============================\n";
+    } else {
+        std::cout << "  Time:   " << std::fixed << std::setprecision(2)
+                  << total_us.count() / 1000.0 << " ms\n";
+        std::cout << "  Memory: " << format_bytes(peak_rss) << " peak\n";
+    }
+    return 0;
+}
+
+// Batch mode: several inputs, a directory, or an @manifest compiled in one
+// process. Files are compiled whole on a pool of workers, one file per
+// task, so the numeral cache and --cache stay warm across all of them.
+struct BatchResult {
+    std::string error;
+    size_t forms = 0;
+    size_t input_size = 0;
+    size_t output_size = 0;
+    double seconds = 0;
+};
+
+// Expands directories (every .lctest below them, sorted) and @manifest
+// files (one path per line, relative to the manifest, # starts a comment).
+bool expand_inputs(const std::vector<std::string>& inputs, std::vector<std::string>& files) {
+    namespace fs = std::filesystem;
+    for (const auto& input : inputs) {
+        if (!input.empty() && input[0] == '@') {
+            fs::path manifest = input.substr(1);
+            std::ifstream in(manifest);
+            if (!in) {
+                std::cerr << "Error: could not open manifest '" << manifest.string() << "'\n";
+                return false;
+            }
+            std::vector<std::string> listed;
+            std::string line;
+            while (std::getline(in, line)) {
+                size_t start = line.find_first_not_of(" \t\r");
+                if (start == std::string::npos || line[start] == '#') continue;
+                size_t end = line.find_last_not_of(" \t\r");
+                fs::path entry = line.substr(start, end - start + 1);
+                listed.push_back((entry.is_relative() ? manifest.parent_path() / entry : entry).string());
+            }
+            if (!expand_inputs(listed, files)) return false;
+        } else if (fs::is_directory(input)) {
+            std::vector<std::string> found;
+            std::error_code ec;
+            for (const auto& e : fs::recursive_directory_iterator(input, ec)) {
+                if (e.is_regular_file() && e.path().extension() == ".lctest") {
+                    found.push_back(e.path().string());
+                }
+            }
+            if (ec) {
+                std::cerr << "Error: could not read directory '" << input << "': " << ec.message() << "\n";
+                return false;
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(input);
         }
-        if (current_rss > stats.compilation_peak) {
-            stats.compilation_peak = current_rss;
+    }
+    return true;
+}
+
+void compile_file(const std::string& path, bool use_arena, bool use_mmap, bool binary, BatchResult& result) {
+    auto start = std::chrono::high_resolution_clock::now();
+    try {
+        if (path.size() < 7 || path.compare(path.size() - 7, 7, ".lctest") != 0) {
+            throw std::runtime_error("input file must have .lctest extension");
+        }
+        std::unique_ptr<MappedFile> mapped;
+        std::unique_ptr<Parser> parser;
+        if (use_mmap) {
+            mapped = std::make_unique<MappedFile>(path);
+            result.input_size = mapped->view().size();
+            if (mapped->view().find_first_not_of(" \t\r\n") == std::string_view::npos) {
+                throw std::runtime_error("input file is empty or contains only whitespace");
+            }
+            parser = std::make_unique<Parser>(*mapped);
+        } else {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) throw std::runtime_error("could not open input file");
+            std::stringstream text;
+            text << in.rdbuf();
+            std::string source = text.str();
+            result.input_size = source.size();
+            if (source.find_first_not_of(" \t\r\n") == std::string::npos) {
+                throw std::runtime_error("input file is empty or contains only whitespace");
+            }
+            parser = std::make_unique<Parser>(std::move(source));
+        }
+
+        std::shared_ptr<SExpr> root;
+        AstArena arena;
+        if (use_arena) {
+            parser->parse(arena);
+        } else {
+            root = parser->parse();
+        }
+        if (translate_options().fold) {
+            if (use_arena) {
+                fold_constants(arena, arena.root());
+            } else {
+                fold_constants(root);
+            }
+        }
+
+        Emitter output;
+        std::optional<LcbWriter> writer;
+        if (binary) writer.emplace(output);
+        std::string record;
+        BuiltinSet used = 0;
+        size_t count = use_arena ? arena[arena.root()].count : root->list.size();
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = static_cast<uint32_t>(i);
+            if (binary) {
+                if (use_arena) {
+                    translate_binary(arena, arena.child(arena.root(), index), record);
+                } else {
+                    translate_binary(root->list[i], record);
+                }
+                writer->add_form(record);
+                continue;
+            }
+            if (use_arena) {
+                used |= translate(arena, arena.child(arena.root(), index), output);
+            } else {
+                used |= translate(root->list[i], output);
+            }
+            output << '\n';
         }
+        if (writer) writer->finish();
+        result.forms = count;
+
+        std::filesystem::path outPath = path;
+        outPath.replace_extension(binary ? ".lcb" : ".lc");
+        std::ofstream out(outPath, std::ios::binary);
+        if (!out) throw std::runtime_error("could not write to output file '" + outPath.string() + "'");
+        if (used != 0) {
+            Emitter prelude;
+            BuiltinSet written = 0;
+            write_prelude(prelude, used, written);
+            result.output_size += prelude.size();
+            out << prelude.str();
+        }
+        result.output_size += output.size();
+        out << output.str();
+        if (!out.flush()) throw std::runtime_error("could not write to output file '" + outPath.string() + "'");
+    } catch (const std::exception& e) {
+        result.error = e.what();
     }
+    result.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
 
-    void stop_monitoring() {
-        monitoring = false;
-        update();
+int compile_batch(const std::vector<std::string>& files, unsigned jobs, bool show_stats,
+                  bool use_arena, bool use_mmap, bool binary) {
+    if (files.empty()) {
+        std::cerr << "Error: no .lctest files found\n";
+        return 1;
     }
-};
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<BatchResult> results(files.size());
+    {
+        ThreadPool pool(jobs);
+        pool.parallel_for(files.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                compile_file(files[i], use_arena, use_mmap, binary, results[i]);
+            }
+        });
+    }
+    if (form_cache) form_cache->trim();
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    size_t failed = 0, forms = 0, input_size = 0, output_size = 0;
+    double busy = 0;
+    const BatchResult* slowest = nullptr;
+    for (size_t i = 0; i < files.size(); i++) {
+        const BatchResult& r = results[i];
+        if (!r.error.empty()) {
+            std::cerr << files[i] << ": Compilation Error: " << r.error << "\n";
+            failed++;
+        }
+        forms += r.forms;
+        input_size += r.input_size;
+        output_size += r.output_size;
+        busy += r.seconds;
+        if (!slowest || r.seconds > slowest->seconds) slowest = &r;
+    }
+
+    std::cout << "LC IR batch generated\n";
+    std::cout << "  Files:  " << files.size() - failed << " compiled, " << failed << " failed ("
+              << jobs << " threads)\n";
+    std::cout << "  Input:  " << format_bytes(input_size) << " in " << forms << " forms\n";
+    std::cout << "  Output: " << format_bytes(output_size) << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Time:   " << seconds * 1000 << " ms (" << files.size() / seconds << " files/s, "
+              << input_size / seconds / (1024 * 1024) << " MB/s)\n";
+    if (show_stats) {
+        std::cout << "\n=== Per-file Statistics ===\n";
+        std::cout << std::setprecision(3);
+        for (size_t i = 0; i < files.size(); i++) {
+            const BatchResult& r = results[i];
+            std::cout << "  " << files[i] << ": " << r.seconds * 1000 << " ms, " << r.forms << " forms, "
+                      << format_bytes(r.input_size) << " -> " << format_bytes(r.output_size)
+                      << (r.error.empty() ? "" : " (failed)") << "\n";
+        }
+        std::cout << "\n=== Compilation Statistics ===\n";
+        std::cout << "Mean file time:  " << busy / files.size() * 1000 << " ms\n";
+        std::cout << "Slowest file:    " << files[static_cast<size_t>(slowest - results.data())] << " ("
+                  << slowest->seconds * 1000 << " ms)\n";
+        std::cout << "Worker busy:     " << std::setprecision(1) << busy / (seconds * jobs) * 100 << "%\n";
+        std::cout << "Peak memory:     " << format_bytes(get_peak_memory_usage()) << "\n";
+        print_cache_stats();
+        std::cout << "==============================\n";
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+bool open_form_cache(const std::string& dir, uint64_t size) {
+    if (dir.empty()) return true;
+    try {
+        form_cache = std::make_unique<FormCache>(dir, size);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return false;
+    }
+    set_form_cache(form_cache.get());
+    return true;
+}
+
+// --eval: binds the program's definitions and reduces every expression,
+// printing the value it reads back as. Expressions are labelled with
+// their .lc line, or their form number when they came from an .lcb file.
+int evaluate_program(const LcProgram& program, const char* label, bool show_stats,
+                     const EvalOptions& opts) {
+    auto start = std::chrono::high_resolution_clock::now();
+    Evaluator evaluator(opts);
+    size_t failures = 0;
+    for (const auto& def : program.definitions) {
+        evaluator.define(def.name, program.terms, def.term);
+    }
+
+    std::cout << "Evaluation:\n";
+    for (const auto& expr : program.expressions) {
+        std::cout << "  " << label << " " << expr.line << ": ";
+        try {
+            std::cout << evaluator.evaluate(program.terms, expr.term) << "\n";
+        } catch (const EvalError& e) {
+            std::cout << "error: " << e.what() << "\n";
+            failures++;
+        }
+    }
+    auto eval_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+
+    if (show_stats) {
+        const EvalStats& st = evaluator.stats();
+        std::cout << "\n=== Evaluation Statistics ===\n";
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Eval time:       " << eval_us.count() / 1000.0 << " ms\n";
+        std::cout << "Reductions:      " << st.steps << "\n";
+        std::cout << "Thunk updates:   " << st.updates << "\n";
+        std::cout << "Allocations:     " << st.thunks << " thunks, " << st.values << " values, "
+                  << st.env_cells << " env cells\n";
+        std::cout << "Heap:            " << format_bytes(st.heap_bytes) << "\n";
+        std::cout << "==============================\n";
+    } else {
+        std::cout << "  Time:   " << std::fixed << std::setprecision(2)
+                  << eval_us.count() / 1000.0 << " ms\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int evaluate_lc(std::string_view text, bool show_stats, const EvalOptions& opts) {
+    LcProgram program;
+    try {
+        read_lc(text, program);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Evaluation Error: " << e.what() << "\n";
+        return 1;
+    }
+    return evaluate_program(program, "line", show_stats, opts);
+}
+
+// Loads every form of an .lcb file. Only the records are decoded; the
+// header, index and trailer are read in place from the mapping.
+bool load_lcb(const std::string& path, LcProgram& program) {
+    try {
+        LcbFile file(path);
+        for (size_t i = 0; i < file.forms(); i++) {
+            program.expressions.push_back({file.load_form(i, program.terms), static_cast<int>(i + 1)});
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+int evaluate_lcb(const std::string& path, bool show_stats, const EvalOptions& opts) {
+    LcProgram program;
+    if (!load_lcb(path, program)) return 1;
+    return evaluate_program(program, "form", show_stats, opts);
+}
+
+// --native: writes the program as C next to the input, as NAME.c, and
+// builds the executable NAME from it.
+int build_native_program(LcProgram& program, const char* label, const std::string& input,
+                         NativeNumerals numerals) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::filesystem::path exePath = input;
+    exePath.replace_extension();
+    std::filesystem::path cPath = exePath;
+    cPath += ".c";
+    NativeStats st;
+    {
+        std::ofstream out(cPath, std::ios::binary);
+        if (!out) {
+            std::cerr << "Error: could not write to output file '" << cPath << "'\n";
+            return 1;
+        }
+        st = write_c_program(program, label, numerals, out);
+    }
+    auto generated = std::chrono::high_resolution_clock::now();
+    std::string error;
+    if (!build_native(cPath.string(), exePath.string(), error)) {
+        std::cerr << "Native Build Error: " << error << "\n";
+        return 1;
+    }
+    auto built = std::chrono::high_resolution_clock::now();
+
+    auto ms = [](auto d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0; };
+    std::cout << "Native executable built\n";
+    std::cout << "  C:      " << cPath << " (" << format_bytes(std::filesystem::file_size(cPath)) << ", "
+              << st.functions << " functions, " << st.statics << " static, " << st.primitives
+              << " native builtins)\n";
+    std::cout << "  Output: " << exePath << " (" << format_bytes(std::filesystem::file_size(exePath)) << ")\n";
+    std::cout << "  Time:   " << std::fixed << std::setprecision(2) << ms(generated - start)
+              << " ms to generate, " << ms(built - generated) << " ms in cc\n";
+    return 0;
+}
+
+int build_native_lc(std::string_view text, const std::string& input, NativeNumerals numerals) {
+    LcProgram program;
+    try {
+        read_lc(text, program);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Native Build Error: " << e.what() << "\n";
+        return 1;
+    }
+    return build_native_program(program, "line", input, numerals);
+}
+
+int build_native_lcb(const std::string& path, const std::string& input, NativeNumerals numerals) {
+    LcProgram program;
+    if (!load_lcb(path, program)) return 1;
+    return build_native_program(program, "form", input, numerals);
+}
+
+// --ski: compiles the program to combinators, writes them next to the
+// input as NAME.ski and reduces every expression as --eval does. ir_bytes
+// is the size of the λ IR it came from, for comparison.
+int run_ski_program(const LcProgram& program, const char* label, const std::string& input,
+                    size_t ir_bytes, bool show_stats, const EvalOptions& opts) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::filesystem::path skiPath = input;
+    skiPath.replace_extension(".ski");
+    SkiProgram ski(opts);
+    {
+        std::ofstream out(skiPath, std::ios::binary);
+        if (!out) {
+            std::cerr << "Error: could not write to output file '" << skiPath << "'\n";
+            return 1;
+        }
+        ski.compile(program);
+        ski.write(out);
+    }
+    auto compiled = std::chrono::high_resolution_clock::now();
+    size_t ski_bytes = std::filesystem::file_size(skiPath);
+    const SkiStats& st = ski.stats();
+
+    auto ms = [](auto d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0; };
+    std::cout << "Combinator program written\n";
+    std::cout << "  Output: " << skiPath << " (" << format_bytes(ski_bytes) << ", " << st.nodes << " nodes, "
+              << st.shared << " shared)\n";
+    std::cout << "  Size:   " << std::fixed << std::setprecision(2)
+              << (ir_bytes ? static_cast<double>(ski_bytes) / ir_bytes : 0.0) << "x the λ IR ("
+              << format_bytes(ir_bytes) << ")\n";
+    std::cout << "  Time:   " << ms(compiled - start) << " ms\n";
+
+    size_t failures = 0;
+    std::cout << "Evaluation:\n";
+    for (size_t i = 0; i < ski.expressions(); i++) {
+        std::cout << "  " << label << " " << program.expressions[i].line << ": ";
+        try {
+            std::cout << ski.evaluate(i) << "\n";
+        } catch (const EvalError& e) {
+            std::cout << "error: " << e.what() << "\n";
+            failures++;
+        }
+    }
+    auto done = std::chrono::high_resolution_clock::now();
+
+    if (show_stats) {
+        double seconds = std::chrono::duration<double>(done - compiled).count();
+        std::cout << "\n=== Combinator Statistics ===\n";
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Eval time:       " << ms(done - compiled) << " ms\n";
+        std::cout << "Rewrites:        " << st.rewrites << " ("
+                  << std::setprecision(1) << (seconds > 0 ? st.rewrites / seconds / 1e6 : 0.0) << "M/s)\n";
+        std::cout << "By rule:        ";
+        for (size_t r = 0; r < std::size(st.rule_counts); r++) {
+            std::cout << " " << SkiProgram::rule_name(r) << "=" << st.rule_counts[r];
+        }
+        std::cout << "\n";
+        std::cout << "Heap:            " << format_bytes(st.heap_bytes) << "\n";
+        std::cout << "==============================\n";
+    } else {
+        std::cout << "  Time:   " << std::fixed << std::setprecision(2) << ms(done - compiled) << " ms\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// --inet: reduces every expression as an interaction net on threads
+// threads, printing what --eval would. scaling reruns the reduction on
+// 1, 2, 4, ... threads up to threads and reports interactions per second.
+int run_inet_program(const LcProgram& program, const char* label, unsigned threads, bool scaling,
+                     bool show_stats, const EvalOptions& opts) {
+    NetReducer net(program, opts, threads);
+    size_t failures = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::cout << "Evaluation:\n";
+    for (size_t i = 0; i < net.expressions(); i++) {
+        std::cout << "  " << label << " " << program.expressions[i].line << ": ";
+        try {
+            std::cout << net.evaluate(i) << "\n";
+        } catch (const EvalError& e) {
+            std::cout << "error: " << e.what() << "\n";
+            failures++;
+        }
+    }
+    auto eval_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+    InetStats st = net.stats();
+
+    if (show_stats) {
+        std::cout << "\n=== Interaction Net Statistics ===\n";
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Eval time:       " << eval_us.count() / 1000.0 << " ms\n";
+        std::cout << "Reduce time:     " << st.seconds * 1000 << " ms on " << threads << " threads\n";
+        std::cout << "Interactions:    " << st.interactions << " (" << std::setprecision(1)
+                  << (st.seconds > 0 ? st.interactions / st.seconds / 1e6 : 0.0) << "M/s)\n";
+        std::cout << "By rule:         annihilate=" << st.annihilations << " commute=" << st.commutations
+                  << " erase=" << st.erasures << " unfold=" << st.unfolds << "\n";
+        std::cout << "Steals:          " << st.steals << "\n";
+        std::cout << "Agents built:    " << st.agents << "\n";
+        std::cout << "Heap:            " << format_bytes(st.heap_bytes) << " peak\n";
+        std::cout << "==============================\n";
+    } else {
+        std::cout << "  Time:   " << std::fixed << std::setprecision(2) << eval_us.count() / 1000.0 << " ms\n";
+    }
+
+    if (scaling) {
+        std::vector<unsigned> counts;
+        for (unsigned t = 1; t < threads; t *= 2) counts.push_back(t);
+        counts.push_back(threads);
+        std::cout << "\n=== Interaction Net Scaling ===\n";
+        std::cout << "Threads  Reduce ms  Interactions/s  Speedup  Steals\n";
+        double base = 0;
+        for (unsigned t : counts) {
+            net.set_threads(t);
+            InetStats before = net.stats();
+            for (size_t i = 0; i < net.expressions(); i++) {
+                try {
+                    net.evaluate(i);
+                } catch (const EvalError&) {
+                }
+            }
+            const InetStats& after = net.stats();
+            double seconds = after.seconds - before.seconds;
+            uint64_t interactions = after.interactions - before.interactions;
+            if (t == 1) base = seconds;
+            std::cout << std::setw(7) << t << "  " << std::setw(9) << std::fixed << std::setprecision(2)
+                      << seconds * 1000 << "  " << std::setw(13) << std::setprecision(1)
+                      << (seconds > 0 ? interactions / seconds / 1e6 : 0.0) << "M  " << std::setw(6)
+                      << std::setprecision(2) << (seconds > 0 ? base / seconds : 0.0) << "x  "
+                      << after.steals - before.steals << "\n";
+        }
+        std::cout << "===============================\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int run_inet_lc(std::string_view text, unsigned threads, bool scaling, bool show_stats, const EvalOptions& opts) {
+    LcProgram program;
+    try {
+        read_lc(text, program);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Interaction Net Error: " << e.what() << "\n";
+        return 1;
+    }
+    return run_inet_program(program, "line", threads, scaling, show_stats, opts);
+}
+
+int run_inet_lcb(const std::string& path, unsigned threads, bool scaling, bool show_stats,
+                 const EvalOptions& opts) {
+    LcProgram program;
+    if (!load_lcb(path, program)) return 1;
+    return run_inet_program(program, "form", threads, scaling, show_stats, opts);
+}
+
+int run_ski_lc(std::string_view text, const std::string& input, bool show_stats, const EvalOptions& opts) {
+    LcProgram program;
+    try {
+        read_lc(text, program);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Combinator Error: " << e.what() << "\n";
+        return 1;
+    }
+    return run_ski_program(program, "line", input, text.size(), show_stats, opts);
+}
+
+int run_ski_lcb(const std::string& path, const std::string& input, bool show_stats, const EvalOptions& opts) {
+    LcProgram program;
+    if (!load_lcb(path, program)) return 1;
+    return run_ski_program(program, "form", input, std::filesystem::file_size(path), show_stats, opts);
+}
+
+// An .lcb input without --eval is printed back out as .lc text.
+int decode_lcb(const std::string& path) {
+    LcProgram program;
+    if (!load_lcb(path, program)) return 1;
+    std::filesystem::path outPath = path;
+    outPath.replace_extension(".lc");
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: could not write to output file '" << outPath << "'\n";
+        return 1;
+    }
+    Emitter output(out);
+    for (const auto& expr : program.expressions) {
+        print_term(program.terms, expr.term, output);
+        output << '\n';
+    }
+    output.flush();
+    std::cout << "LC IR decoded\n";
+    std::cout << "  Input:  " << path << " (" << program.expressions.size() << " forms)\n";
+    std::cout << "  Output: " << outPath << " (" << format_bytes(output.size()) << ")\n";
+    return 0;
+}
 
 int main(int argc, char** argv) {
     std::string inputFile;
+    std::vector<std::string> inputs;
     bool show_stats = false;
+    bool use_arena = false;
+    bool use_mmap = false;
+    bool use_stream = false;
+    bool evaluate = false;
+    bool native = false;
+    bool ski = false;
+    bool inet = false;
+    bool inet_scaling = false;
+    NativeNumerals native_numerals = NativeNumerals::Machine;
+    bool binary = false;
+    EvalOptions eval_opts;
+    unsigned jobs = 1;
+    bool jobs_given = false;
+    PrescanIsa prescan = PrescanIsa::Auto;
+    TranslateOptions translate_opts;
+    std::string serve_path;
+    std::string connect_path;
+    bool server_stats = false;
+    bool server_shutdown = false;
+    std::string cache_dir;
+    uint64_t cache_size = uint64_t(256) << 20;
 
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -159,39 +949,241 @@ int main(int argc, char** argv) {
             return 0;
         } else if (arg == "--stats" || arg == "-s") {
             show_stats = true;
+        } else if (arg == "--arena") {
+            use_arena = true;
+        } else if (arg == "--mmap") {
+            use_mmap = true;
+        } else if (arg == "--stream") {
+            use_stream = true;
+        } else if (arg == "--numerals=unary") {
+            translate_opts.numerals = NumeralMode::Unary;
+        } else if (arg == "--numerals=compact") {
+            translate_opts.numerals = NumeralMode::Compact;
+        } else if (arg == "--numeral-cache") {
+            if (i + 1 >= argc || std::atoi(argv[i + 1]) < 1) {
+                std::cerr << "Error: --numeral-cache requires a size in MB\n";
+                return 1;
+            }
+            set_numeral_cache_limit(static_cast<size_t>(std::atoi(argv[++i])) << 20);
+        } else if (arg == "--cache") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --cache requires a directory\n";
+                return 1;
+            }
+            cache_dir = argv[++i];
+        } else if (arg == "--cache-size") {
+            if (i + 1 >= argc || std::atoi(argv[i + 1]) < 1) {
+                std::cerr << "Error: --cache-size requires a size in MB\n";
+                return 1;
+            }
+            cache_size = static_cast<uint64_t>(std::atoi(argv[++i])) << 20;
+        } else if (arg == "--serve" || arg == "--connect") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a socket path\n";
+                return 1;
+            }
+            (arg == "--serve" ? serve_path : connect_path) = argv[++i];
+        } else if (arg == "--server-stats") {
+            server_stats = true;
+        } else if (arg == "--shutdown") {
+            server_shutdown = true;
+        } else if (arg == "--profile=json") {
+            profile_format = ProfileFormat::Json;
+        } else if (arg == "--profile=csv") {
+            profile_format = ProfileFormat::Csv;
+        } else if (arg == "--emit=lc") {
+            binary = false;
+        } else if (arg == "--emit=lcb") {
+            binary = true;
+        } else if (arg == "--eval") {
+            evaluate = true;
+        } else if (arg == "--native") {
+            native = true;
+        } else if (arg == "--ski") {
+            ski = true;
+        } else if (arg == "--inet") {
+            inet = true;
+        } else if (arg == "--inet-scaling") {
+            inet_scaling = true;
+        } else if (arg == "--prescan=auto") {
+            prescan = PrescanIsa::Auto;
+        } else if (arg == "--prescan=avx2") {
+            prescan = PrescanIsa::Avx2;
+        } else if (arg == "--prescan=sse2") {
+            prescan = PrescanIsa::Sse2;
+        } else if (arg == "--prescan=scalar") {
+            prescan = PrescanIsa::Scalar;
+        } else if (arg == "--native-numerals=machine") {
+            native_numerals = NativeNumerals::Machine;
+        } else if (arg == "--native-numerals=church") {
+            native_numerals = NativeNumerals::Church;
+        } else if (arg == "--max-steps") {
+            if (i + 1 >= argc || std::strtoull(argv[i + 1], nullptr, 10) == 0) {
+                std::cerr << "Error: --max-steps requires a positive step count\n";
+                return 1;
+            }
+            eval_opts.max_steps = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--fold") {
+            translate_opts.fold = true;
+        } else if (arg == "--optimize" || arg == "-O") {
+            translate_opts.optimize = true;
+        } else if (arg == "--opt-fuel") {
+            if (i + 1 >= argc || std::strtoull(argv[i + 1], nullptr, 10) == 0) {
+                std::cerr << "Error: --opt-fuel requires a positive rewrite count\n";
+                return 1;
+            }
+            translate_opts.optimize_fuel = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--prelude") {
+            translate_opts.prelude = true;
+        } else if (arg == "--cse") {
+            translate_opts.cse = true;
+        } else if (arg == "--jobs" || arg == "-j") {
+            if (i + 1 >= argc || std::atoi(argv[i + 1]) < 1) {
+                std::cerr << "Error: " << arg << " requires a positive thread count\n";
+                return 1;
+            }
+            jobs = static_cast<unsigned>(std::atoi(argv[++i]));
+            jobs_given = true;
         } else if (arg.substr(0, 2) == "--") {
             std::cerr << "Unknown option: " << arg << "\n";
             std::cerr << "Use --help for usage information\n";
             return 1;
         } else {
-            if (inputFile.empty()) {
-                inputFile = arg;
-            } else {
-                std::cerr << "Multiple input files specified\n";
-                return 1;
-            }
+            inputs.push_back(arg);
+        }
+    }
+    if (profile_format) {
+        if (!serve_path.empty() || !connect_path.empty() || inputs.size() != 1 ||
+            inputs[0][0] == '@' || std::filesystem::is_directory(inputs[0])) {
+            std::cerr << "Error: --profile takes a single input file\n";
+            return 1;
+        }
+        enable_profiling();
+    }
+    if (!serve_path.empty()) {
+        set_translate_options(translate_opts);
+        if (!open_form_cache(cache_dir, cache_size)) return 1;
+        return run_server(serve_path, use_arena);
+    }
+    if (!connect_path.empty()) {
+        if (inputs.empty() && !server_stats && !server_shutdown) {
+            std::cerr << "Error: --connect needs input files, -, --server-stats or --shutdown\n";
+            return 1;
         }
+        return run_client(connect_path, inputs, server_stats, server_shutdown);
     }
-    if (inputFile.empty()) {
+    if (inputs.empty()) {
         std::cerr << "Error: no input file specified\n";
         print_usage(argv[0]);
         return 1;
     }
+    if (inputs.size() > 1 || inputs[0][0] == '@' || std::filesystem::is_directory(inputs[0])) {
+        if (evaluate || native || ski || inet || use_stream) {
+            std::cerr << "Error: --eval, --native, --ski, --inet and --stream take a single input file\n";
+            return 1;
+        }
+        std::vector<std::string> files;
+        if (!expand_inputs(inputs, files)) return 1;
+        set_translate_options(translate_opts);
+        if (!open_form_cache(cache_dir, cache_size)) return 1;
+        if (!jobs_given) jobs = std::max(1u, std::thread::hardware_concurrency());
+        return compile_batch(files, jobs, show_stats, use_arena, use_mmap, binary);
+    }
+    inputFile = inputs[0];
+    auto has_extension = [&](const std::string& ext) {
+        return inputFile.size() > ext.size() &&
+               inputFile.compare(inputFile.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    // --eval, --native, --ski and --inet all run from the generated IR: .lc text, or
+    // the path of an .lcb file
+    auto run_ir = [&](bool lcb, const std::string& ir) {
+        int status = 0;
+        if (evaluate) {
+            status = lcb ? evaluate_lcb(ir, show_stats, eval_opts) : evaluate_lc(ir, show_stats, eval_opts);
+        }
+        if (native) {
+            int built = lcb ? build_native_lcb(ir, inputFile, native_numerals)
+                            : build_native_lc(ir, inputFile, native_numerals);
+            status = std::max(status, built);
+        }
+        if (ski) {
+            int reduced = lcb ? run_ski_lcb(ir, inputFile, show_stats, eval_opts)
+                              : run_ski_lc(ir, inputFile, show_stats, eval_opts);
+            status = std::max(status, reduced);
+        }
+        if (inet) {
+            unsigned threads = jobs_given ? jobs : std::max(1u, std::thread::hardware_concurrency());
+            int reduced = lcb ? run_inet_lcb(ir, threads, inet_scaling, show_stats, eval_opts)
+                              : run_inet_lc(ir, threads, inet_scaling, show_stats, eval_opts);
+            status = std::max(status, reduced);
+        }
+        return status;
+    };
+    if (has_extension(".lcb")) {
+        return evaluate || native || ski || inet ? run_ir(true, inputFile) : decode_lcb(inputFile);
+    }
+    bool lc_input = has_extension(".lc");
+    if ((evaluate || native || ski || inet) && lc_input) {
+        std::ifstream in(inputFile, std::ios::binary);
+        if (!in) {
+            std::cerr << "Error: could not open input file '" << inputFile << "'\n";
+            return 1;
+        }
+        std::stringstream text;
+        text << in.rdbuf();
+        return run_ir(false, text.str());
+    }
     if (inputFile.size() < 7 || inputFile.substr(inputFile.size() - 7) != ".lctest") {
         std::cerr << "Error: input file must have .lctest extension\n";
         return 1;
     }
-
-    std::ifstream in(inputFile);
-    if (!in) {
-        std::cerr << "Error: could not open input file '" << inputFile << "'\n";
-        std::cerr << "Please check that the file exists and is readable\n";
+    set_translate_options(translate_opts);
+    if (!open_form_cache(cache_dir, cache_size)) return 1;
+    if (use_stream && jobs > 1) {
+        std::cerr << "Error: --jobs cannot be combined with --stream\n";
         return 1;
     }
-    std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-    in.close();
-    size_t input_size = source.size();
-    if (source.find_first_not_of(" \t\r\n") == std::string::npos) {
+    if (use_stream) {
+        int status = compile_stream(inputFile, show_stats, use_arena, binary);
+        if (status != 0 || !(evaluate || native || ski || inet)) return status;
+        std::filesystem::path outPath = inputFile;
+        outPath.replace_extension(binary ? ".lcb" : ".lc");
+        if (binary) return run_ir(true, outPath.string());
+        std::ifstream in(outPath, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        return run_ir(false, text.str());
+    }
+
+    // --mmap borrows the file's pages directly; otherwise read it in one go
+    std::string source;
+    std::unique_ptr<MappedFile> mapped;
+    std::string_view text;
+    if (use_mmap) {
+        try {
+            mapped = std::make_unique<MappedFile>(inputFile);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            std::cerr << "Please check that the file exists and is readable\n";
+            return 1;
+        }
+        text = mapped->view();
+    } else {
+        PhaseScope scope(Phase::Read);
+        std::ifstream in(inputFile, std::ios::binary | std::ios::ate);
+        if (!in) {
+            std::cerr << "Error: could not open input file '" << inputFile << "'\n";
+            std::cerr << "Please check that the file exists and is readable\n";
+            return 1;
+        }
+        source.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(&source[0], static_cast<std::streamsize>(source.size()));
+        in.close();
+        text = source;
+    }
+    size_t input_size = text.size();
+    if (text.find_first_not_of(" \t\r\n") == std::string_view::npos) {
         std::cerr << "Error: input file is empty or contains only whitespace\n";
         return 1;
     }
@@ -200,30 +1192,123 @@ int main(int argc, char** argv) {
     MemoryMonitor monitor(memory_stats);
 
     std::string outputData;
+    std::string preludeData;
     auto total_start = std::chrono::high_resolution_clock::now();
 
     std::chrono::duration<double> parse_time, translate_time;
 
     try {
-        monitor.start_monitoring();
-        monitor.update();
-
         auto parse_start = std::chrono::high_resolution_clock::now();
-        Parser parser(source);
-        auto root = parser.parse();
-        monitor.update();
+        std::unique_ptr<Parser> parser;
+        std::shared_ptr<SExpr> root;
+        AstArena arena;
+        std::optional<ThreadPool> pool;
+        if (jobs > 1) pool.emplace(jobs);
+        {
+            PhaseScope scope(Phase::Parse);
+            std::vector<FormRange> ranges;
+            // With several threads the pre-scan splits the input into forms
+            // and each one is parsed on its own. Unbalanced input is left to
+            // the sequential parser, which reports where it goes wrong.
+            // A top-level atom range can hold several forms ("42y" is a
+            // number and a symbol), so every form a range parses to is kept.
+            if (pool && !use_arena && scan_forms(text, ranges, prescan)) {
+                std::vector<std::vector<std::shared_ptr<SExpr>>> parsed(ranges.size());
+                size_t grain = std::max<size_t>(1, ranges.size() / (static_cast<size_t>(jobs) * 8));
+                pool->parallel_for(ranges.size(), grain, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++) {
+                        const FormRange& r = ranges[i];
+                        Parser form_parser(text.substr(r.begin, r.end - r.begin), r.line, r.col);
+                        parsed[i] = std::move(form_parser.parse()->list);
+                    }
+                });
+                std::vector<std::shared_ptr<SExpr>> forms;
+                forms.reserve(ranges.size());
+                for (auto& range_forms : parsed) {
+                    for (auto& form : range_forms) forms.push_back(std::move(form));
+                }
+                root = std::make_shared<SExpr>(std::move(forms));
+            } else {
+                // the parser takes over the buffer instead of copying it
+                parser = mapped ? std::make_unique<Parser>(*mapped)
+                                : std::make_unique<Parser>(std::move(source));
+                if (use_arena) {
+                    parser->parse(arena);
+                } else {
+                    root = parser->parse();
+                }
+            }
+        }
+        if (translate_opts.fold) {
+            PhaseScope scope(Phase::Fold);
+            if (use_arena) {
+                fold_constants(arena, arena.root());
+            } else {
+                fold_constants(root);
+            }
+        }
         auto parse_end = std::chrono::high_resolution_clock::now();
         parse_time = parse_end - parse_start;
 
+        // every top-level form becomes one line of output, or one record
+        // of an .lcb file with --emit=lcb
         auto translate_start = std::chrono::high_resolution_clock::now();
-        if (!root->is_atom && !root->list.empty()) {
-            for (auto& form : root->list) {
-                outputData += translate(form) + "\n";
-                monitor.update();
+        Emitter output;
+        std::optional<LcbWriter> writer;
+        if (binary) writer.emplace(output);
+        size_t count = use_arena ? arena[arena.root()].count : root->list.size();
+        auto translate_form = [&](size_t i, Emitter& sink, std::string& record) {
+            uint32_t index = static_cast<uint32_t>(i);
+            if (binary) {
+                if (use_arena) {
+                    translate_binary(arena, arena.child(arena.root(), index), record);
+                } else {
+                    translate_binary(root->list[i], record);
+                }
+                return;
+            }
+            if (use_arena) {
+                translate(arena, arena.child(arena.root(), index), sink);
+            } else {
+                translate(root->list[i], sink);
+            }
+            sink << '\n';
+        };
+        if (pool) {
+            // forms are independent: translate them on the pool into per-form
+            // buffers, then append in source order so the output is unchanged
+            std::vector<std::string> results(count);
+            size_t grain = std::max<size_t>(1, count / (static_cast<size_t>(jobs) * 8));
+            pool->parallel_for(count, grain, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    Emitter form_output;
+                    translate_form(i, form_output, results[i]);
+                    if (!binary) results[i] = form_output.take();
+                }
+            });
+            for (auto& result : results) {
+                if (binary) {
+                    writer->add_form(result);
+                } else {
+                    output << result;
+                }
+                std::string().swap(result);
             }
         } else {
-            outputData += translate(root) + "\n";
-            monitor.update();
+            std::string record;
+            for (size_t i = 0; i < count; i++) {
+                translate_form(i, output, record);
+                if (binary) writer->add_form(record);
+            }
+        }
+        if (writer) writer->finish();
+        arena.clear();
+        outputData = output.take();
+        if (form_cache) form_cache->trim();
+        if (translate_opts.prelude) {
+            Emitter prelude;
+            write_prelude(prelude);
+            preludeData = prelude.take();
         }
         auto translate_end = std::chrono::high_resolution_clock::now();
         translate_time = translate_end - translate_start;
@@ -244,28 +1329,31 @@ int main(int argc, char** argv) {
     }
 
     std::filesystem::path outPath = inputFile;
-    outPath.replace_extension(".lc");
+    outPath.replace_extension(binary ? ".lcb" : ".lc");
 
-    std::ofstream out(outPath);
-    if (!out) {
-        std::cerr << "Error: could not write to output file '" << outPath << "'\n";
-        std::cerr << "Please check directory permissions\n";
-        return 1;
+    {
+        PhaseScope scope(Phase::Write);
+        std::ofstream out(outPath, std::ios::binary);
+        if (!out) {
+            std::cerr << "Error: could not write to output file '" << outPath << "'\n";
+            std::cerr << "Please check directory permissions\n";
+            return 1;
+        }
+        out << preludeData << outputData;
     }
 
-    out << outputData;
-    out.close();
-
     auto total_end = std::chrono::high_resolution_clock::now();
     auto total_time = total_end - total_start;
 
     std::cout << "LC IR successfully generated\n";
     std::cout << "  Input:  " << inputFile << " (" << format_bytes(input_size) << ")\n";
-    std::cout << "  Output: " << outPath << " (" << format_bytes(outputData.size()) << ")\n";
+    size_t output_size = preludeData.size() + outputData.size();
+    std::cout << "  Output: " << outPath << " (" << format_bytes(output_size) << ")\n";
+    if (!write_profile_report(inputFile)) return 1;
 
     if (show_stats) {
         print_compilation_stats(parse_time, translate_time,
-                                input_size, outputData.size(), memory_stats);
+                                input_size, output_size, memory_stats);
         clear_cache();
     } else {
         auto total_us = std::chrono::duration_cast<std::chrono::microseconds>(total_time);
@@ -276,6 +1364,9 @@ int main(int argc, char** argv) {
                   << " overhead)\n";
     }
 
+    if (evaluate || native || ski || inet) {
+        return binary ? run_ir(true, outPath.string()) : run_ir(false, preludeData + outputData);
+    }
     return 0;
 }
 
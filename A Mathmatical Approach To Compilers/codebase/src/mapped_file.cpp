@@ -0,0 +1,49 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: read-only memory mapping of source files (file -> zero-copy view)
+***************************************************************************************/
+
+#include "mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("could not open '" + path + "': " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("could not stat '" + path + "': " + std::strerror(err));
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        void *p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("could not map '" + path + "': " + std::strerror(err));
+        }
+        // the tokenizer walks the file front to back exactly once
+        ::madvise(p, length, MADV_SEQUENTIAL);
+        addr = static_cast<const char *>(p);
+    }
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (addr) {
+        ::munmap(const_cast<char *>(addr), length);
+    }
+}
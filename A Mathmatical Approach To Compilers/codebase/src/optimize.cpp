@@ -0,0 +1,470 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: β/η simplification of the λ-term DAG (λ-DAG -> smaller λ-DAG)
+***************************************************************************************/
+
+#include "optimize.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static std::atomic<size_t> beta_total{0};
+static std::atomic<size_t> inlined_total{0};
+static std::atomic<size_t> dead_total{0};
+static std::atomic<size_t> eta_total{0};
+static std::atomic<size_t> out_of_fuel_total{0};
+static std::atomic<uint64_t> bytes_before_total{0};
+static std::atomic<uint64_t> bytes_after_total{0};
+
+namespace {
+
+constexpr TermId NONE = UINT32_MAX;
+
+uint64_t sat_add(uint64_t a, uint64_t b) {
+    uint64_t r = a + b;
+    return r < a ? UINT64_MAX : r;
+}
+
+uint64_t sat_mul(uint64_t a, uint64_t b) {
+    if (a != 0 && b > UINT64_MAX / a) return UINT64_MAX;
+    return a * b;
+}
+
+// How a variable occurs in a term: how often (saturating), and whether any
+// occurrence sits under a λ inside it.
+struct Occurrences {
+    uint64_t count = 0;
+    bool under_lambda = false;
+};
+
+class Optimizer {
+public:
+    Optimizer(TermTable &terms, const OptimizeOptions &opts)
+        : tt(terms), fuel(opts.fuel), builtin_names(opts.builtin_names) {}
+
+    size_t beta = 0, inlined = 0, dead = 0, eta = 0;
+    bool starved = false;
+
+    // Children are simplified before their parent, so a redex is only
+    // considered once its function and argument are as small as they get.
+    // Like every walk here it keeps its own stack, so nesting depth is
+    // bounded by memory, not the C++ stack.
+    TermId simplify(TermId root) {
+        struct Frame {
+            TermId id;
+            Term t;
+            int stage;      // children simplified so far; 3 once a redex was substituted
+            TermId f;
+        };
+        std::vector<Frame> stack;
+        TermId r = root;
+        bool descend = true;
+        for (;;) {
+            if (descend) {
+                grow();
+                if (done[r] == NONE) {
+                    // provisional, so a redex that reduces back to itself stops there
+                    done[r] = r;
+                    const Term t = tt[r];
+                    if (t.kind == TermKind::Lam || t.kind == TermKind::App) {
+                        stack.push_back({r, t, 0, 0});
+                        r = t.kind == TermKind::Lam ? t.b : t.a;
+                        continue;
+                    }
+                    finish(r, r);
+                } else {
+                    r = done[r];
+                }
+            }
+            descend = false;
+            if (stack.empty()) return r;
+            Frame &fr = stack.back();
+            if (fr.t.kind == TermKind::Lam) {
+                r = try_eta(tt.lam(tt.name(fr.t.a), r));
+            } else if (fr.stage == 0) {
+                fr.f = r;
+                fr.stage = 1;
+                r = fr.t.b;
+                descend = true;
+                continue;
+            } else if (fr.stage == 1) {
+                r = tt.app(fr.f, r);
+                bool substituted = false;
+                if (tt[fr.f].kind == TermKind::Lam) r = try_beta(r, substituted);
+                if (substituted) {
+                    // the substituted body is simplified in turn
+                    fr.stage = 3;
+                    descend = true;
+                    continue;
+                }
+            }
+            finish(fr.id, r);
+            stack.pop_back();
+        }
+    }
+
+    // Printed length of a term, as print_term would write it.
+    uint64_t length(TermId root) {
+        grow();
+        std::vector<TermId> stack{root};
+        while (!stack.empty()) {
+            TermId id = stack.back();
+            if (len[id] != 0) {
+                stack.pop_back();
+                continue;
+            }
+            const Term t = tt[id];
+            // children first
+            bool ready = true;
+            if (t.kind == TermKind::App && len[t.a] == 0) {
+                stack.push_back(t.a);
+                ready = false;
+            }
+            if ((t.kind == TermKind::App || t.kind == TermKind::Lam) && len[t.b] == 0) {
+                stack.push_back(t.b);
+                ready = false;
+            }
+            if (!ready) continue;
+            uint64_t n = 0;
+            switch (t.kind) {
+            case TermKind::Var:
+                n = tt.name(t.a).size();
+                break;
+            case TermKind::Lam:
+                n = sat_add(3 + tt.name(t.a).size(), len[t.b]);
+                break;
+            case TermKind::App:
+                n = sat_add(sat_add(3, len[t.a]), len[t.b]);
+                if (tt[t.a].kind == TermKind::Lam || tt[t.a].kind == TermKind::Num) n = sat_add(n, 2);
+                break;
+            case TermKind::Const: {
+                Builtin b = static_cast<Builtin>(t.a);
+                n = builtin_names ? builtin_name(b).size() : builtin_text(b).size();
+                break;
+            }
+            case TermKind::Num:
+                n = church_numeral_length(t.a);
+                break;
+            }
+            len[id] = n;
+            stack.pop_back();
+        }
+        return len[root];
+    }
+
+private:
+    TermTable &tt;
+    size_t fuel;
+    bool builtin_names;
+    size_t fresh_counter = 0;
+
+    // indexed by TermId and grown as the table grows
+    std::vector<TermId> done;
+    std::vector<uint64_t> len;
+    std::vector<std::vector<uint32_t>> fv;
+    std::vector<char> fv_known;
+
+    void grow() {
+        size_t n = tt.size();
+        if (done.size() >= n) return;
+        done.resize(n, NONE);
+        len.resize(n, 0);
+        fv.resize(n);
+        fv_known.resize(n, 0);
+    }
+
+    bool spend() {
+        if (fuel == 0) {
+            starved = true;
+            return false;
+        }
+        fuel--;
+        return true;
+    }
+
+    void finish(TermId id, TermId r) {
+        grow();
+        done[id] = r;
+        done[r] = r;
+    }
+
+    // Sorted free variable symbols of a term.
+    const std::vector<uint32_t> &free_vars(TermId root) {
+        grow();
+        std::vector<TermId> stack{root};
+        while (!stack.empty()) {
+            TermId id = stack.back();
+            if (fv_known[id]) {
+                stack.pop_back();
+                continue;
+            }
+            const Term t = tt[id];
+            bool ready = true;
+            if (t.kind == TermKind::App && !fv_known[t.a]) {
+                stack.push_back(t.a);
+                ready = false;
+            }
+            if ((t.kind == TermKind::App || t.kind == TermKind::Lam) && !fv_known[t.b]) {
+                stack.push_back(t.b);
+                ready = false;
+            }
+            if (!ready) continue;
+            std::vector<uint32_t> out;
+            switch (t.kind) {
+            case TermKind::Var:
+                out.push_back(t.a);
+                break;
+            case TermKind::Lam:
+                for (uint32_t v : fv[t.b]) {
+                    if (v != t.a) out.push_back(v);
+                }
+                break;
+            case TermKind::App:
+                std::set_union(fv[t.a].begin(), fv[t.a].end(), fv[t.b].begin(), fv[t.b].end(),
+                               std::back_inserter(out));
+                break;
+            case TermKind::Const:
+            case TermKind::Num:
+                break;
+            }
+            fv[id] = std::move(out);
+            fv_known[id] = 1;
+            stack.pop_back();
+        }
+        return fv[root];
+    }
+
+    bool is_free(uint32_t sym, TermId id) {
+        const std::vector<uint32_t> &v = free_vars(id);
+        return std::binary_search(v.begin(), v.end(), sym);
+    }
+
+    static bool is_value(TermKind k) { return k != TermKind::App; }
+
+    Occurrences occurrences(uint32_t sym, TermId root, std::unordered_map<TermId, Occurrences> &memo) {
+        // children first; a term without sym free has none and is not stored
+        auto known = [&](TermId id) { return !is_free(sym, id) || memo.count(id); };
+        auto get = [&](TermId id) { return is_free(sym, id) ? memo[id] : Occurrences{}; };
+        std::vector<TermId> stack{root};
+        while (!stack.empty()) {
+            TermId id = stack.back();
+            if (known(id)) {
+                stack.pop_back();
+                continue;
+            }
+            const Term t = tt[id];
+            bool ready = true;
+            if (t.kind == TermKind::App && !known(t.a)) {
+                stack.push_back(t.a);
+                ready = false;
+            }
+            if ((t.kind == TermKind::App || t.kind == TermKind::Lam) && !known(t.b)) {
+                stack.push_back(t.b);
+                ready = false;
+            }
+            if (!ready) continue;
+            Occurrences o;
+            if (t.kind == TermKind::Var) {
+                o.count = 1;
+            } else if (t.kind == TermKind::Lam) {
+                o = get(t.b);
+                o.under_lambda = true;
+            } else if (t.kind == TermKind::App) {
+                Occurrences a = get(t.a);
+                Occurrences b = get(t.b);
+                o.count = sat_add(a.count, b.count);
+                o.under_lambda = a.under_lambda || b.under_lambda;
+            }
+            memo.emplace(id, o);
+            stack.pop_back();
+        }
+        return get(root);
+    }
+
+    // A binder name that appears nowhere in the table.
+    std::string_view fresh(std::string_view base) {
+        std::string name;
+        do {
+            name = std::string(base) + "_" + std::to_string(++fresh_counter);
+        } while (tt.has_symbol(name));
+        TermId v = tt.var(name);
+        return tt.name(tt[v].a);
+    }
+
+    using SubstMemo = std::unordered_map<TermId, TermId>;
+
+    // Capture-avoiding t[sym := value].
+    TermId subst(TermId root, uint32_t sym, TermId value, SubstMemo &memo) {
+        struct Frame {
+            TermId id;
+            Term t;
+            uint32_t sym;
+            TermId value;
+            SubstMemo *memo;
+            int stage;
+            TermId f;                           // App: the substituted function
+            std::string_view param;             // Lam: the binder, renamed if it captured
+            std::unique_ptr<SubstMemo> rename;  // Lam: memo for the renaming
+        };
+        std::vector<Frame> stack;
+        // Returns true with r set when id needs no frame.
+        auto leaf = [&](TermId id, uint32_t sym, TermId value, SubstMemo &memo, TermId &r) {
+            if (!is_free(sym, id)) {
+                r = id;
+                return true;
+            }
+            auto it = memo.find(id);
+            if (it != memo.end()) {
+                r = it->second;
+                return true;
+            }
+            const Term t = tt[id];
+            if (t.kind == TermKind::Var) {
+                r = value;
+                memo.emplace(id, r);
+                return true;
+            }
+            stack.push_back({id, t, sym, value, &memo, 0, 0, {}, nullptr});
+            return false;
+        };
+
+        TermId r;
+        if (leaf(root, sym, value, memo, r)) return r;
+        for (;;) {
+            Frame &fr = stack.back();
+            TermId child;
+            uint32_t child_sym = fr.sym;
+            TermId child_value = fr.value;
+            SubstMemo *child_memo = fr.memo;
+            if (fr.t.kind == TermKind::App) {
+                if (fr.stage == 0) {
+                    child = fr.t.a;
+                } else if (fr.stage == 1) {
+                    fr.f = r;
+                    child = fr.t.b;
+                } else {
+                    r = tt.app(fr.f, r);
+                    fr.memo->emplace(fr.id, r);
+                    stack.pop_back();
+                    if (stack.empty()) return r;
+                    continue;
+                }
+            } else if (fr.stage == 0) {
+                // sym is free here, so the binder is some other name
+                fr.param = tt.name(fr.t.a);
+                child = fr.t.b;
+                if (is_free(fr.t.a, fr.value)) {
+                    fr.param = fresh(fr.param);
+                    fr.rename = std::make_unique<SubstMemo>();
+                    child_sym = fr.t.a;
+                    child_value = tt.var(fr.param);
+                    child_memo = fr.rename.get();
+                } else {
+                    fr.stage = 1;
+                }
+            } else if (fr.stage == 1) {
+                // the body renamed
+                child = r;
+            } else {
+                r = tt.lam(fr.param, r);
+                fr.memo->emplace(fr.id, r);
+                stack.pop_back();
+                if (stack.empty()) return r;
+                continue;
+            }
+            fr.stage++;
+            if (leaf(child, child_sym, child_value, *child_memo, r)) continue;
+            // the new frame starts at stage 0 and hands its term back as r
+        }
+    }
+
+    TermId try_beta(TermId redex, bool &substituted) {
+        const Term app = tt[redex];
+        const Term lam = tt[app.a];
+        TermId body = lam.b, value = app.b;
+
+        std::unordered_map<TermId, Occurrences> seen;
+        Occurrences o = occurrences(lam.a, body, seen);
+        bool value_arg = is_value(tt[value].kind);
+        if (o.count == 0) {
+            if (!spend()) return redex;
+            dead++;
+            return body;
+        }
+        bool once = o.count == 1 && (value_arg || !o.under_lambda);
+        if (!once) {
+            if (!value_arg) return redex;
+            uint64_t name_len = tt.name(lam.a).size();
+            uint64_t copies = sat_mul(o.count, length(value));
+            uint64_t removed = sat_mul(o.count, name_len);
+            uint64_t result = sat_add(length(body), copies);
+            result = result > removed ? result - removed : 0;
+            if (result > length(redex)) return redex;
+        }
+        if (!spend()) return redex;
+        beta++;
+        if (once) inlined++;
+        SubstMemo memo;
+        substituted = true;
+        return subst(body, lam.a, value, memo);
+    }
+
+    TermId try_eta(TermId id) {
+        const Term lam = tt[id];
+        const Term body = tt[lam.b];
+        if (body.kind != TermKind::App) return id;
+        const Term arg = tt[body.b];
+        if (arg.kind != TermKind::Var || arg.a != lam.a) return id;
+        TermKind f = tt[body.a].kind;
+        if (f != TermKind::Var && f != TermKind::Const && f != TermKind::Num) return id;
+        if (is_free(lam.a, body.a)) return id;
+        if (!spend()) return id;
+        eta++;
+        return body.a;
+    }
+};
+
+} // namespace
+
+TermId optimize_term(TermTable &terms, TermId root, const OptimizeOptions &opts) {
+    Optimizer opt(terms, opts);
+    uint64_t before = opt.length(root);
+    TermId result = opt.simplify(root);
+    uint64_t after = opt.length(result);
+
+    beta_total.fetch_add(opt.beta, std::memory_order_relaxed);
+    inlined_total.fetch_add(opt.inlined, std::memory_order_relaxed);
+    dead_total.fetch_add(opt.dead, std::memory_order_relaxed);
+    eta_total.fetch_add(opt.eta, std::memory_order_relaxed);
+    if (opt.starved) out_of_fuel_total.fetch_add(1, std::memory_order_relaxed);
+    bytes_before_total.fetch_add(before, std::memory_order_relaxed);
+    bytes_after_total.fetch_add(after, std::memory_order_relaxed);
+    return result;
+}
+
+OptimizeStats optimize_stats() {
+    OptimizeStats st;
+    st.beta = beta_total.load();
+    st.inlined = inlined_total.load();
+    st.dead = dead_total.load();
+    st.eta = eta_total.load();
+    st.out_of_fuel = out_of_fuel_total.load();
+    st.bytes_before = bytes_before_total.load();
+    st.bytes_after = bytes_after_total.load();
+    return st;
+}
+
+void reset_optimize_stats() {
+    beta_total = 0;
+    inlined_total = 0;
+    dead_total = 0;
+    eta_total = 0;
+    out_of_fuel_total = 0;
+    bytes_before_total = 0;
+    bytes_after_total = 0;
+}
@@ -9,28 +9,51 @@
 #include "parser.hpp"
 #include <cctype>
 #include <stdexcept>
+#include <vector>
 
 // SExpr constructors
 SExpr::SExpr(std::string a) : is_atom(true), atom(std::move(a)) {}
 SExpr::SExpr(std::vector<std::shared_ptr<SExpr>> v) : is_atom(false), list(std::move(v)) {}
 
+// Frees the subtree with a work list; letting each child's destructor free
+// its own children would recurse once per level of nesting.
+SExpr::~SExpr() {
+    std::vector<std::shared_ptr<SExpr>> pending = std::move(list);
+    while (!pending.empty()) {
+        std::shared_ptr<SExpr> e = std::move(pending.back());
+        pending.pop_back();
+        if (e.use_count() == 1) {
+            for (auto &child : e->list) pending.push_back(std::move(child));
+            e->list.clear();
+        }
+    }
+}
+
 
 Parser::Tokenizer::Tokenizer(std::string input)
-    : s(std::move(input)), i(0), _line(1), _col(1) {}
-
-void Parser::Tokenizer::advance() {
-    if (i < s.size() && s[i] == '\n') {
-        _line++;
-        _col = 1;
-    } else {
-        _col++;
+    : owned(std::move(input)), s(owned), i(0) {}
+
+Parser::Tokenizer::Tokenizer(std::string_view input, int line, int col)
+    : s(input), i(0), origin_line(line), origin_col(col) {}
+
+std::string Parser::Tokenizer::location(size_t offset) const {
+    int line = origin_line;
+    size_t line_start = 0;
+    bool first_line = true;
+    for (size_t k = 0; k < offset && k < s.size(); k++) {
+        if (s[k] == '\n') {
+            line++;
+            line_start = k + 1;
+            first_line = false;
+        }
     }
-    i++;
+    size_t col = offset - line_start + (first_line ? origin_col : 1);
+    return "line " + std::to_string(line) + ", col " + std::to_string(col);
 }
 
 void Parser::Tokenizer::skip_ws() {
     while (i < s.size() && std::isspace((unsigned char)s[i])) {
-        advance();
+        i++;
     }
 }
 
@@ -38,41 +61,39 @@ Parser::Token Parser::Tokenizer::next() {
     skip_ws();
 
     if (i >= s.size()) {
-        return {Token::END, "", _line, _col};
+        return {Token::END, {}, i};
     }
 
-    int startLine = _line, startCol = _col;
+    size_t start = i;
     char c = s[i];
 
     // Handle parentheses
     if (c == '(') {
-        advance();
-        return {Token::LPAREN, "(", startLine, startCol};
+        i++;
+        return {Token::LPAREN, s.substr(start, 1), start};
     }
     if (c == ')') {
-        advance();
-        return {Token::RPAREN, ")", startLine, startCol};
+        i++;
+        return {Token::RPAREN, s.substr(start, 1), start};
     }
 
     // handle unsigned numbers
     if (std::isdigit((unsigned char)c) ||
         (c == '-' && i + 1 < s.size() && std::isdigit((unsigned char)s[i + 1]))) {
-        size_t start = i;
-        if (s[i] == '-') advance();
+        if (s[i] == '-') i++;
         while (i < s.size() && std::isdigit((unsigned char)s[i])) {
-            advance();
+            i++;
         }
-        return {Token::NUMBER, s.substr(start, i - start), startLine, startCol};
+        return {Token::NUMBER, s.substr(start, i - start), start};
     }
 
     // handle symbols
-    size_t start = i;
     while (i < s.size() &&
            !std::isspace((unsigned char)s[i]) &&
            s[i] != '(' && s[i] != ')') {
-        advance();
+        i++;
     }
-    return {Token::SYMBOL, s.substr(start, i - start), startLine, startCol};
+    return {Token::SYMBOL, s.substr(start, i - start), start};
 }
 
 
@@ -80,6 +101,14 @@ Parser::Parser(std::string in) : tz(std::move(in)) {
     cur = tz.next();
 }
 
+Parser::Parser(const MappedFile &file) : tz(file.view()) {
+    cur = tz.next();
+}
+
+Parser::Parser(std::string_view in, int line, int col) : tz(in, line, col) {
+    cur = tz.next();
+}
+
 void Parser::consume() {
     cur = tz.next();
 }
@@ -89,39 +118,86 @@ std::shared_ptr<SExpr> Parser::parse() {
     while (cur.kind != Token::END) {
         exprs.push_back(parseOne());
     }
-    if (exprs.size() == 1) {
-        return exprs[0];
-    }
     return std::make_shared<SExpr>(exprs);
 }
 
+AstArena::Id Parser::parse(AstArena &arena) {
+    // children are gathered here and only copied into the arena once their
+    // list closes, so every list's children end up contiguous
+    std::vector<AstNode> pending;
+    while (cur.kind != Token::END) {
+        parseOne(arena, pending);
+    }
+    AstArena::Id root = arena.push(arena.make_list(pending.data(), static_cast<uint32_t>(pending.size())));
+    arena.set_root(root);
+    return root;
+}
+
+// Both parseOne overloads keep the lists still waiting for their ')' on a
+// heap stack instead of recursing, so nesting depth is bounded by memory.
 std::shared_ptr<SExpr> Parser::parseOne() {
-    if (cur.kind == Token::LPAREN) {
-        consume(); // consume '('
-        std::vector<std::shared_ptr<SExpr>> elems;
-        while (cur.kind != Token::RPAREN && cur.kind != Token::END) {
-            elems.push_back(parseOne());
+    std::vector<std::vector<std::shared_ptr<SExpr>>> open;
+    for (;;) {
+        std::shared_ptr<SExpr> done;
+        if (cur.kind == Token::LPAREN) {
+            consume(); // consume '('
+            open.emplace_back();
+            continue;
         }
-        if (cur.kind == Token::END) {
-            throw std::runtime_error("Unexpected end of input: missing ')' at line "
-                                     + std::to_string(cur.line) + ", col " + std::to_string(cur.col));
+        if (cur.kind == Token::RPAREN && !open.empty()) {
+            consume(); // consume ')'
+            done = std::make_shared<SExpr>(std::move(open.back()));
+            open.pop_back();
+        } else if (cur.kind == Token::NUMBER || cur.kind == Token::SYMBOL) {
+            done = std::make_shared<SExpr>(std::string(cur.text));
+            consume();
+        } else if (cur.kind == Token::END && !open.empty()) {
+            throw std::runtime_error("Unexpected end of input: missing ')' at "
+                                     + tz.location(cur.offset));
+        } else {
+            unexpected();
         }
-        consume(); // consume ')'
-        return std::make_shared<SExpr>(elems);
+        if (open.empty()) return done;
+        open.back().push_back(std::move(done));
     }
-    if (cur.kind == Token::NUMBER || cur.kind == Token::SYMBOL) {
-        std::string text = cur.text;
-        consume();
-        return std::make_shared<SExpr>(text);
+}
+
+void Parser::parseOne(AstArena &arena, std::vector<AstNode> &pending) {
+    // where each open list's children start in pending
+    std::vector<size_t> marks;
+    for (;;) {
+        if (cur.kind == Token::LPAREN) {
+            consume(); // consume '('
+            marks.push_back(pending.size());
+            continue;
+        }
+        if (cur.kind == Token::RPAREN && !marks.empty()) {
+            consume(); // consume ')'
+            size_t mark = marks.back();
+            marks.pop_back();
+            AstNode list = arena.make_list(pending.data() + mark, static_cast<uint32_t>(pending.size() - mark));
+            pending.resize(mark);
+            pending.push_back(list);
+        } else if (cur.kind == Token::NUMBER || cur.kind == Token::SYMBOL) {
+            pending.push_back(arena.make_atom(cur.text));
+            consume();
+        } else if (cur.kind == Token::END && !marks.empty()) {
+            throw std::runtime_error("Unexpected end of input: missing ')' at "
+                                     + tz.location(cur.offset));
+        } else {
+            unexpected();
+        }
+        if (marks.empty()) return;
     }
+}
+
+void Parser::unexpected() const {
     if (cur.kind == Token::RPAREN) {
-        throw std::runtime_error("Unexpected ')' at line "
-                                 + std::to_string(cur.line) + ", col " + std::to_string(cur.col));
+        throw std::runtime_error("Unexpected ')' at " + tz.location(cur.offset));
     }
     if (cur.kind == Token::END) {
-        throw std::runtime_error("Unexpected end of input at line "
-                                 + std::to_string(cur.line) + ", col " + std::to_string(cur.col));
+        throw std::runtime_error("Unexpected end of input at " + tz.location(cur.offset));
     }
-    throw std::runtime_error("Unexpected token '" + cur.text + "' at line "
-                             + std::to_string(cur.line) + ", col " + std::to_string(cur.col));
+    throw std::runtime_error("Unexpected token '" + std::string(cur.text) + "' at "
+                             + tz.location(cur.offset));
 }
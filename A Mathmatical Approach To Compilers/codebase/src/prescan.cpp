@@ -0,0 +1,304 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: SIMD structural pre-scan splitting a whole input into top-level form
+*                 ranges (source -> form ranges) for parallel parsing
+***************************************************************************************/
+
+#include "prescan.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Bit i describes byte i of a 64-byte block. Depths are relative to the
+// depth before the block: low is the lowest depth after any byte, and
+// at_low marks the bytes after which the depth is low.
+struct Masks {
+    uint64_t open;
+    uint64_t close;
+    uint64_t ws;        // what std::isspace accepts: ' ' and '\t'..'\r'
+    uint64_t nl;
+    uint64_t at_low;
+    int low;
+    int change;         // depth after the last byte
+};
+
+// Blocks classified per call, so the dispatch is paid once per 4 KB.
+constexpr size_t BATCH = 64;
+
+using Classify = void (*)(const char *p, size_t blocks, Masks *out);
+
+void classify_scalar(const char *p, size_t blocks, Masks *out) {
+    for (size_t b = 0; b < blocks; b++, p += 64) {
+        Masks m = {0, 0, 0, 0, 0, 64, 0};
+        int depth[64];
+        int d = 0;
+        for (unsigned i = 0; i < 64; i++) {
+            unsigned char c = static_cast<unsigned char>(p[i]);
+            uint64_t bit = uint64_t(1) << i;
+            if (c == '(') {
+                m.open |= bit;
+                d++;
+            } else if (c == ')') {
+                m.close |= bit;
+                d--;
+            } else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+                m.ws |= bit;
+                if (c == '\n') m.nl |= bit;
+            }
+            depth[i] = d;
+            m.low = std::min(m.low, d);
+        }
+        for (unsigned i = 0; i < 64; i++) {
+            if (depth[i] == m.low) m.at_low |= uint64_t(1) << i;
+        }
+        m.change = d;
+        out[b] = m;
+    }
+}
+
+#if defined(__x86_64__)
+// Both vector versions compare bytes for the masks, then take the running
+// depth as a prefix sum of +1 per '(' and -1 per ')' in signed bytes
+// (|depth| <= 64 fits): log-step shifts within each 16-byte lane, then each
+// lane's total carried into the ones after it. '\t'..'\r' are the bytes
+// whose c - '\t' is at most 4 unsigned.
+
+__attribute__((target("sse2")))
+void classify_sse2(const char *p, size_t blocks, Masks *out) {
+    const __m128i open = _mm_set1_epi8('('), close = _mm_set1_epi8(')');
+    const __m128i space = _mm_set1_epi8(' '), nl = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t'), four = _mm_set1_epi8(4);
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    auto bits = [](__m128i v, unsigned shift) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(v))) << shift;
+    };
+    for (size_t b = 0; b < blocks; b++, p += 64) {
+        Masks m = {0, 0, 0, 0, 0, 0, 0};
+        __m128i depth[4];
+        int carry = 0;
+        // SSE2 has no signed byte min, so the minimum is taken biased
+        __m128i low = _mm_set1_epi8(static_cast<char>(0xff));
+        for (unsigned k = 0; k < 4; k++) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+            __m128i is_open = _mm_cmpeq_epi8(v, open), is_close = _mm_cmpeq_epi8(v, close);
+            __m128i ctl = _mm_sub_epi8(v, tab);
+            __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(_mm_min_epu8(ctl, four), ctl));
+            m.open |= bits(is_open, 16 * k);
+            m.close |= bits(is_close, 16 * k);
+            m.ws |= bits(ws, 16 * k);
+            m.nl |= bits(_mm_cmpeq_epi8(v, nl), 16 * k);
+
+            __m128i d = _mm_sub_epi8(is_close, is_open);   // cmpeq gives -1
+            d = _mm_add_epi8(d, _mm_slli_si128(d, 1));
+            d = _mm_add_epi8(d, _mm_slli_si128(d, 2));
+            d = _mm_add_epi8(d, _mm_slli_si128(d, 4));
+            d = _mm_add_epi8(d, _mm_slli_si128(d, 8));
+            d = _mm_add_epi8(d, _mm_set1_epi8(static_cast<char>(carry)));
+            carry = static_cast<int8_t>(_mm_extract_epi16(d, 7) >> 8);
+            depth[k] = d;
+            low = _mm_min_epu8(low, _mm_xor_si128(d, bias));
+        }
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 8));
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 2));
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 1));
+        m.low = static_cast<int>(_mm_cvtsi128_si32(low) & 0xff) - 0x80;
+        __m128i target = _mm_set1_epi8(static_cast<char>(m.low));
+        for (unsigned k = 0; k < 4; k++) m.at_low |= bits(_mm_cmpeq_epi8(depth[k], target), 16 * k);
+        m.change = carry;
+        out[b] = m;
+    }
+}
+
+__attribute__((target("avx2")))
+void classify_avx2(const char *p, size_t blocks, Masks *out) {
+    const __m256i open = _mm256_set1_epi8('('), close = _mm256_set1_epi8(')');
+    const __m256i space = _mm256_set1_epi8(' '), nl = _mm256_set1_epi8('\n');
+    const __m256i tab = _mm256_set1_epi8('\t'), four = _mm256_set1_epi8(4);
+    const __m256i last = _mm256_set1_epi8(15);
+    auto bits = [](__m256i lo, __m256i hi) __attribute__((target("avx2"))) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(lo))) |
+               static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hi))) << 32;
+    };
+    auto whitespace = [&](__m256i v) __attribute__((target("avx2"))) {
+        __m256i ctl = _mm256_sub_epi8(v, tab);
+        return _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                               _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, four), ctl));
+    };
+    // running depth over 32 bytes; the slli shifts stay within 16-byte lanes
+    auto prefix = [&](__m256i d) __attribute__((target("avx2"))) {
+        d = _mm256_add_epi8(d, _mm256_slli_si256(d, 1));
+        d = _mm256_add_epi8(d, _mm256_slli_si256(d, 2));
+        d = _mm256_add_epi8(d, _mm256_slli_si256(d, 4));
+        d = _mm256_add_epi8(d, _mm256_slli_si256(d, 8));
+        __m256i total = _mm256_shuffle_epi8(d, last);
+        return _mm256_add_epi8(d, _mm256_permute2x128_si256(total, total, 0x08));
+    };
+    for (size_t b = 0; b < blocks; b++, p += 64) {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+        __m256i open_lo = _mm256_cmpeq_epi8(lo, open), open_hi = _mm256_cmpeq_epi8(hi, open);
+        __m256i close_lo = _mm256_cmpeq_epi8(lo, close), close_hi = _mm256_cmpeq_epi8(hi, close);
+        Masks &m = out[b];
+        m.open = bits(open_lo, open_hi);
+        m.close = bits(close_lo, close_hi);
+        m.ws = bits(whitespace(lo), whitespace(hi));
+        m.nl = bits(_mm256_cmpeq_epi8(lo, nl), _mm256_cmpeq_epi8(hi, nl));
+
+        __m256i d_lo = prefix(_mm256_sub_epi8(close_lo, open_lo));
+        __m256i d_hi = prefix(_mm256_sub_epi8(close_hi, open_hi));
+        __m256i total = _mm256_shuffle_epi8(d_lo, last);
+        d_hi = _mm256_add_epi8(d_hi, _mm256_permute2x128_si256(total, total, 0x11));
+
+        __m256i low2 = _mm256_min_epi8(d_lo, d_hi);
+        __m128i low = _mm_min_epi8(_mm256_castsi256_si128(low2), _mm256_extracti128_si256(low2, 1));
+        low = _mm_min_epi8(low, _mm_srli_si128(low, 8));
+        low = _mm_min_epi8(low, _mm_srli_si128(low, 4));
+        low = _mm_min_epi8(low, _mm_srli_si128(low, 2));
+        low = _mm_min_epi8(low, _mm_srli_si128(low, 1));
+        m.low = static_cast<int8_t>(_mm_cvtsi128_si32(low) & 0xff);
+        __m256i target = _mm256_set1_epi8(static_cast<char>(m.low));
+        m.at_low = bits(_mm256_cmpeq_epi8(d_lo, target), _mm256_cmpeq_epi8(d_hi, target));
+        m.change = static_cast<int8_t>(_mm256_extract_epi8(d_hi, 31));
+    }
+}
+#endif
+
+uint64_t bits_below(unsigned hi) { return hi >= 64 ? ~uint64_t(0) : (uint64_t(1) << hi) - 1; }
+
+// Walks the classified blocks in order, carrying paren depth, the form
+// still open and the line count from one block to the next. Only bytes
+// where something happens at the top level are visited.
+class Scanner {
+public:
+    explicit Scanner(std::vector<FormRange> &out) : forms(out) {}
+
+    bool block(size_t base, const Masks &m) {
+        long long low = depth + m.low;
+        if (low < 0) return false;                  // a ')' with nothing open
+        uint64_t ends_at_top = low == 0 ? m.at_low : 0;
+        uint64_t top = ends_at_top << 1 | (depth == 0 ? 1 : 0);    // bytes read at depth zero
+        depth += m.change;
+
+        uint64_t token = ~(m.ws | m.open | m.close);
+        uint64_t token_start = token & ~(token << 1 | prev_token);
+        uint64_t token_end = ~token & (token << 1 | prev_token);   // the delimiter after an atom
+        prev_token = token >> 63;
+
+        uint64_t list_start = m.open & top;
+        uint64_t list_end = m.close & ends_at_top;
+        uint64_t atom_start = token_start & top;
+        uint64_t atom_end = token_end & top;
+        // an atom's end can be the next list's start, so that is closed first
+        for (uint64_t s = list_start | list_end | atom_start | atom_end; s != 0; s &= s - 1) {
+            unsigned p = static_cast<unsigned>(__builtin_ctzll(s));
+            uint64_t bit = uint64_t(1) << p;
+            if (atom_end & bit) {
+                form.end = base + p;
+                forms.push_back(form);
+                atom_open = false;
+            }
+            if ((list_start | atom_start) & bit) {
+                form = at(base, p, m);
+                atom_open = (atom_start & bit) != 0;
+            } else if (list_end & bit) {
+                form.end = base + p + 1;
+                forms.push_back(form);
+            }
+        }
+
+        lines += __builtin_popcountll(m.nl);
+        if (m.nl) last_nl = static_cast<long long>(base) + 63 - __builtin_clzll(m.nl);
+        return true;
+    }
+
+    bool finish(size_t size) {
+        if (atom_open) {
+            form.end = size;
+            forms.push_back(form);
+        }
+        return depth == 0;
+    }
+
+private:
+    std::vector<FormRange> &forms;
+    long long depth = 0;
+    uint64_t prev_token = 0;    // last byte of the previous block was part of an atom
+    FormRange form = {0, 0, 1, 1};
+    bool atom_open = false;
+    int lines = 1;              // line of the current block's first byte
+    long long last_nl = -1;     // offset of the last newline before the block
+
+    // Byte p of the block at base, with its line and column.
+    FormRange at(size_t base, unsigned p, const Masks &m) const {
+        uint64_t before = m.nl & bits_below(p);
+        long long nl = before ? static_cast<long long>(base) + 63 - __builtin_clzll(before) : last_nl;
+        long long offset = static_cast<long long>(base + p);
+        return {base + p, 0, lines + __builtin_popcountll(before), static_cast<int>(offset - nl)};
+    }
+};
+
+Classify classifier(PrescanIsa isa) {
+    switch (prescan_isa(isa)) {
+#if defined(__x86_64__)
+    case PrescanIsa::Avx2: return classify_avx2;
+    case PrescanIsa::Sse2: return classify_sse2;
+#endif
+    default: return classify_scalar;
+    }
+}
+
+} // namespace
+
+PrescanIsa prescan_isa(PrescanIsa isa) {
+#if defined(__x86_64__)
+    if (isa == PrescanIsa::Scalar) return PrescanIsa::Scalar;
+    __builtin_cpu_init();
+    if (isa != PrescanIsa::Sse2 && __builtin_cpu_supports("avx2")) return PrescanIsa::Avx2;
+    return PrescanIsa::Sse2;
+#else
+    (void)isa;
+    return PrescanIsa::Scalar;
+#endif
+}
+
+const char *prescan_isa_name(PrescanIsa isa) {
+    switch (isa) {
+    case PrescanIsa::Auto: return "auto";
+    case PrescanIsa::Avx2: return "avx2";
+    case PrescanIsa::Sse2: return "sse2";
+    case PrescanIsa::Scalar: return "scalar";
+    }
+    return "?";
+}
+
+bool scan_forms(std::string_view text, std::vector<FormRange> &forms, PrescanIsa isa) {
+    Classify classify = classifier(isa);
+    Scanner scanner(forms);
+    Masks masks[BATCH];
+    size_t full = text.size() / 64;
+    for (size_t b = 0; b < full; b += BATCH) {
+        size_t n = std::min(BATCH, full - b);
+        classify(text.data() + b * 64, n, masks);
+        for (size_t i = 0; i < n; i++) {
+            if (!scanner.block((b + i) * 64, masks[i])) return false;
+        }
+    }
+    // the tail is padded with spaces, which end an atom but add nothing
+    if (size_t rest = text.size() % 64) {
+        char tail[64];
+        std::memset(tail, ' ', sizeof tail);
+        std::memcpy(tail, text.data() + full * 64, rest);
+        classify(tail, 1, masks);
+        if (!scanner.block(full * 64, masks[0])) return false;
+    }
+    return scanner.finish(text.size());
+}
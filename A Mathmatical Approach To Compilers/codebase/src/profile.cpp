@@ -0,0 +1,259 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: --profile instrumentation: per-phase allocation counters via the
+*                 global operator new/delete, per-form times and output attribution
+***************************************************************************************/
+
+#include "profile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <malloc.h>
+
+namespace profile_detail {
+bool enabled = false;
+}
+
+namespace {
+
+// All of these are constant-initialised, so they are usable by operator
+// new calls made before main() runs.
+struct PhaseCounters {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> nanos;
+};
+PhaseCounters counters[PHASE_COUNT];
+std::atomic<int64_t> live_bytes{0};
+std::atomic<int64_t> peak_live_bytes{0};
+
+thread_local Phase current_phase = Phase::Other;
+thread_local uint64_t child_nanos = 0;     // time spent in scopes nested in the current one
+
+struct FormRecord {
+    std::string label;
+    uint64_t nanos;
+    uint64_t bytes;
+    bool cached;
+};
+std::mutex records_mutex;
+std::vector<FormRecord> forms;
+PrintProfile output;
+
+void count_alloc(void *p) {
+    PhaseCounters &c = counters[static_cast<size_t>(current_phase)];
+    uint64_t size = malloc_usable_size(p);
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = live_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+                   static_cast<int64_t>(size);
+    int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void count_free(void *p) {
+    counters[static_cast<size_t>(current_phase)].frees.fetch_add(1, std::memory_order_relaxed);
+    live_bytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+}
+
+void *allocate(size_t n) {
+    if (n == 0) n = 1;
+    for (;;) {
+        if (void *p = std::malloc(n)) {
+            if (profiling()) count_alloc(p);
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void release(void *p) noexcept {
+    if (p && profiling()) count_free(p);
+    std::free(p);
+}
+
+// Form labels may hold anything an atom can; keep reports one line per row.
+std::string json_string(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\u%04x", u);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::string csv_string(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+void *operator new(size_t n) { return allocate(n); }
+void *operator new[](size_t n) { return allocate(n); }
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
+
+const char *phase_name(Phase p) {
+    switch (p) {
+    case Phase::Other: return "other";
+    case Phase::Read: return "read";
+    case Phase::Parse: return "parse";
+    case Phase::Fold: return "fold";
+    case Phase::Lower: return "lower";
+    case Phase::Optimize: return "optimize";
+    case Phase::Print: return "print";
+    case Phase::Write: return "write";
+    case Phase::COUNT: break;
+    }
+    return "?";
+}
+
+uint64_t profile_now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void enable_profiling() {
+    profile_detail::enabled = true;
+}
+
+void PhaseScope::enter(Phase p) {
+    active = true;
+    saved = current_phase;
+    saved_child_ns = child_nanos;
+    current_phase = p;
+    child_nanos = 0;
+    start_ns = profile_now_ns();
+}
+
+void PhaseScope::leave() {
+    uint64_t total = profile_now_ns() - start_ns;
+    uint64_t self = total > child_nanos ? total - child_nanos : 0;
+    counters[static_cast<size_t>(current_phase)].nanos.fetch_add(self, std::memory_order_relaxed);
+    current_phase = saved;
+    child_nanos = saved_child_ns + total;
+}
+
+void record_form(std::string label, uint64_t nanos, uint64_t output_bytes, bool cached) {
+    std::lock_guard<std::mutex> lock(records_mutex);
+    forms.push_back({std::move(label), nanos, output_bytes, cached});
+}
+
+void record_output(const PrintProfile &p) {
+    std::lock_guard<std::mutex> lock(records_mutex);
+    for (size_t b = 0; b < BUILTIN_COUNT; b++) {
+        output.builtin_uses[b] += p.builtin_uses[b];
+        output.builtin_bytes[b] += p.builtin_bytes[b];
+    }
+    for (const auto &[value, n] : p.numerals) {
+        PrintProfile::Numeral &total = output.numerals[value];
+        total.uses += n.uses;
+        total.bytes += n.bytes;
+    }
+}
+
+void write_profile(std::ostream &out, ProfileFormat format, const std::string &input) {
+    std::lock_guard<std::mutex> lock(records_mutex);
+    std::vector<const FormRecord *> by_time;
+    for (const FormRecord &f : forms) by_time.push_back(&f);
+    std::stable_sort(by_time.begin(), by_time.end(),
+                     [](const FormRecord *a, const FormRecord *b) { return a->nanos > b->nanos; });
+
+    std::vector<size_t> builtins;
+    for (size_t b = 0; b < BUILTIN_COUNT; b++) {
+        if (output.builtin_uses[b] > 0) builtins.push_back(b);
+    }
+    std::stable_sort(builtins.begin(), builtins.end(), [](size_t a, size_t b) {
+        return output.builtin_bytes[a] > output.builtin_bytes[b];
+    });
+    std::vector<std::pair<uint32_t, PrintProfile::Numeral>> numerals(output.numerals.begin(),
+                                                                     output.numerals.end());
+    std::sort(numerals.begin(), numerals.end(), [](const auto &a, const auto &b) {
+        return a.second.bytes != b.second.bytes ? a.second.bytes > b.second.bytes : a.first < b.first;
+    });
+
+    auto builtin = [](size_t b) { return std::string(builtin_name(static_cast<Builtin>(b))); };
+    out << std::fixed << std::setprecision(3);
+
+    if (format == ProfileFormat::Csv) {
+        // one long table; frees only applies to phases
+        out << "section,name,count,bytes,micros,frees\n";
+        for (size_t p = 0; p < PHASE_COUNT; p++) {
+            const PhaseCounters &c = counters[p];
+            out << "phase," << phase_name(static_cast<Phase>(p)) << ',' << c.allocations.load() << ','
+                << c.bytes.load() << ',' << c.nanos.load() / 1000.0 << ',' << c.frees.load() << '\n';
+        }
+        out << "heap,peak_live,," << peak_live_bytes.load() << ",,\n";
+        for (const FormRecord *f : by_time) {
+            out << (f->cached ? "form_cached," : "form,") << csv_string(f->label) << ",1," << f->bytes
+                << ',' << f->nanos / 1000.0 << ",\n";
+        }
+        for (size_t b : builtins) {
+            out << "builtin," << builtin(b) << ',' << output.builtin_uses[b] << ','
+                << output.builtin_bytes[b] << ",,\n";
+        }
+        for (const auto &[value, n] : numerals) {
+            out << "numeral," << value << ',' << n.uses << ',' << n.bytes << ",,\n";
+        }
+        return;
+    }
+
+    out << "{\n  \"input\": " << json_string(input) << ",\n";
+    out << "  \"peak_live_heap_bytes\": " << peak_live_bytes.load() << ",\n";
+    out << "  \"phases\": [";
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        const PhaseCounters &c = counters[p];
+        out << (p ? ",\n" : "\n") << "    {\"phase\": \"" << phase_name(static_cast<Phase>(p))
+            << "\", \"self_ms\": " << c.nanos.load() / 1e6 << ", \"allocations\": "
+            << c.allocations.load() << ", \"bytes\": " << c.bytes.load() << ", \"frees\": "
+            << c.frees.load() << "}";
+    }
+    out << "\n  ],\n  \"forms\": [";
+    for (size_t i = 0; i < by_time.size(); i++) {
+        const FormRecord &f = *by_time[i];
+        out << (i ? ",\n" : "\n") << "    {\"form\": " << json_string(f.label) << ", \"us\": "
+            << f.nanos / 1000.0 << ", \"bytes\": " << f.bytes << ", \"cached\": "
+            << (f.cached ? "true" : "false") << "}";
+    }
+    out << "\n  ],\n  \"builtins\": [";
+    for (size_t i = 0; i < builtins.size(); i++) {
+        size_t b = builtins[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << builtin(b) << "\", \"uses\": "
+            << output.builtin_uses[b] << ", \"bytes\": " << output.builtin_bytes[b] << "}";
+    }
+    out << "\n  ],\n  \"numerals\": [";
+    for (size_t i = 0; i < numerals.size(); i++) {
+        out << (i ? ",\n" : "\n") << "    {\"value\": " << numerals[i].first << ", \"uses\": "
+            << numerals[i].second.uses << ", \"bytes\": " << numerals[i].second.bytes << "}";
+    }
+    out << "\n  ]\n}\n";
+}
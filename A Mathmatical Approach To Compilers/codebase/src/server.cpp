@@ -0,0 +1,389 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: resident compile server and client over a Unix domain socket
+***************************************************************************************/
+
+#include "server.hpp"
+#include "form_reader.hpp"
+#include "fold.hpp"
+#include "translator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t MAX_BODY = size_t(1) << 30;
+
+struct CompileError {
+    int line;
+    int col;
+    std::string message;
+};
+
+// ---- wire format ----
+
+bool write_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool read_all(int fd, char *p, size_t n) {
+    while (n > 0) {
+        ssize_t r = ::read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Header lines are short, so they are read a byte at a time and the body
+// is then read in one go.
+bool read_header(int fd, std::string &line) {
+    line.clear();
+    char c;
+    while (read_all(fd, &c, 1)) {
+        if (c == '\n') return true;
+        if (line.size() >= 256) return false;
+        line.push_back(c);
+    }
+    return false;
+}
+
+bool send_message(int fd, const std::string &header, const std::string &body) {
+    std::string msg = header + " " + std::to_string(body.size()) + "\n";
+    return write_all(fd, msg.data(), msg.size()) && write_all(fd, body.data(), body.size());
+}
+
+// ---- compiling ----
+
+// A parse error already names its position; anything else is placed at
+// the start of the form it came from.
+CompileError locate(const std::string &message, int form_line, int form_col) {
+    int line = form_line, col = form_col;
+    size_t at = message.rfind("line ");
+    if (at != std::string::npos && std::sscanf(message.c_str() + at, "line %d, col %d", &line, &col) == 2) {
+        return {line, col, message};
+    }
+    return {form_line, form_col, message};
+}
+
+std::string compile_source(const std::string &source, bool use_arena) {
+    std::istringstream in(source);
+    FormReader reader(in);
+    Emitter output;
+    BuiltinSet used = 0;
+    AstArena arena;
+    std::string_view form;
+    while (reader.next(form)) {
+        try {
+            Parser parser(form, reader.line(), reader.col());
+            if (use_arena) {
+                parser.parse(arena);
+                if (translate_options().fold) fold_constants(arena, arena.root());
+                used |= translate(arena, arena.child(arena.root(), 0), output);
+                arena.clear();
+            } else {
+                std::shared_ptr<SExpr> root = parser.parse();
+                if (translate_options().fold) fold_constants(root);
+                used |= translate(root->list[0], output);
+            }
+        } catch (const std::runtime_error &e) {
+            throw locate(e.what(), reader.line(), reader.col());
+        }
+        output << '\n';
+    }
+    if (used == 0) return output.take();
+    Emitter prelude;
+    BuiltinSet written = 0;
+    write_prelude(prelude, used, written);
+    return prelude.take() + output.take();
+}
+
+// ---- request latency ----
+
+// The most recent WINDOW request times, for percentiles in STATS.
+class LatencyLog {
+public:
+    void record(double ms, bool failed) {
+        std::lock_guard<std::mutex> lock(m);
+        if (samples.size() < WINDOW) {
+            samples.push_back(ms);
+        } else {
+            samples[next] = ms;
+        }
+        next = (next + 1) % WINDOW;
+        total++;
+        if (failed) errors++;
+    }
+
+    std::string report() {
+        std::vector<double> copy;
+        size_t requests, failures;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            copy = samples;
+            requests = total;
+            failures = errors;
+        }
+        std::ostringstream out;
+        out << "Requests:        " << requests << " (" << failures << " errors)\n";
+        if (!copy.empty()) {
+            auto pct = [&](double p) {
+                size_t k = std::min(copy.size() - 1, static_cast<size_t>(p * static_cast<double>(copy.size())));
+                std::nth_element(copy.begin(), copy.begin() + static_cast<std::ptrdiff_t>(k), copy.end());
+                return copy[k];
+            };
+            char line[160];
+            std::snprintf(line, sizeof line, "Latency:         p50 %.3f ms, p99 %.3f ms, max %.3f ms (last %zu)\n",
+                          pct(0.50), pct(0.99), *std::max_element(copy.begin(), copy.end()), copy.size());
+            out << line;
+        }
+        return out.str();
+    }
+
+private:
+    static constexpr size_t WINDOW = 1 << 16;
+    std::mutex m;
+    std::vector<double> samples;
+    size_t next = 0;
+    size_t total = 0;
+    size_t errors = 0;
+};
+
+LatencyLog latency;
+bool arena_mode = false;
+std::atomic<bool> stopping{false};
+int listen_fd = -1;
+const char *bound_path = nullptr;
+auto started = std::chrono::steady_clock::now();
+
+std::string stats_text() {
+    std::ostringstream out;
+    auto up = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    out << "Uptime:          " << static_cast<long long>(up) << " s\n";
+    out << latency.report();
+    print_cache_stats(out);
+    return out.str();
+}
+
+void serve_connection(int fd) {
+    std::string header, body;
+    while (read_header(fd, header)) {
+        char command[16] = {0};
+        unsigned long long length = 0;
+        if (std::sscanf(header.c_str(), "%15s %llu", command, &length) != 2 || length > MAX_BODY) {
+            send_message(fd, "ERROR 0 0", "malformed request header");
+            break;
+        }
+        body.resize(static_cast<size_t>(length));
+        if (length > 0 && !read_all(fd, &body[0], body.size())) break;
+
+        auto start = std::chrono::steady_clock::now();
+        std::string cmd = command;
+        bool ok = true;
+        std::string reply_header = "OK", reply;
+        if (cmd == "SOURCE" || cmd == "FILE") {
+            try {
+                if (cmd == "FILE") {
+                    std::ifstream in(body, std::ios::binary);
+                    if (!in) throw CompileError{0, 0, "could not open input file '" + body + "'"};
+                    std::stringstream text;
+                    text << in.rdbuf();
+                    body = text.str();
+                }
+                reply = compile_source(body, arena_mode);
+            } catch (const CompileError &e) {
+                ok = false;
+                reply_header = "ERROR " + std::to_string(e.line) + " " + std::to_string(e.col);
+                reply = e.message;
+            } catch (const std::exception &e) {
+                ok = false;
+                reply_header = "ERROR 0 0";
+                reply = e.what();
+            }
+            latency.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), !ok);
+        } else if (cmd == "STATS") {
+            reply = stats_text();
+        } else if (cmd == "SHUTDOWN") {
+            // answered first: the process exits once the listener closes
+            send_message(fd, "OK", "");
+            stopping = true;
+            ::shutdown(listen_fd, SHUT_RDWR);
+            break;
+        } else {
+            reply_header = "ERROR 0 0";
+            reply = "unknown request '" + cmd + "'";
+        }
+        if (!send_message(fd, reply_header, reply)) break;
+    }
+    ::close(fd);
+}
+
+extern "C" void on_signal(int) {
+    if (bound_path) ::unlink(bound_path);
+    _exit(0);
+}
+
+bool connect_to(const std::string &path, int &fd) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof addr.sun_path) return false;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0) {
+        ::close(fd);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int run_server(const std::string &socket_path, bool use_arena) {
+    sockaddr_un addr{};
+    if (socket_path.size() >= sizeof addr.sun_path) {
+        std::cerr << "Error: socket path '" << socket_path << "' is too long\n";
+        return 1;
+    }
+    int probe;
+    if (connect_to(socket_path, probe)) {
+        ::close(probe);
+        std::cerr << "Error: a server is already listening on '" << socket_path << "'\n";
+        return 1;
+    }
+    ::unlink(socket_path.c_str());   // left over from a server that died
+
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0 ||
+        ::listen(listen_fd, 128) != 0) {
+        std::cerr << "Error: cannot listen on '" << socket_path << "': " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    bound_path = socket_path.c_str();
+    arena_mode = use_arena;
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    started = std::chrono::steady_clock::now();
+    std::cout << "Compile server listening on " << socket_path << std::endl;
+
+    while (!stopping) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        std::thread(serve_connection, fd).detach();
+    }
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+    bound_path = nullptr;
+    std::cout << "Compile server stopped\n" << latency.report();
+    return 0;
+}
+
+int run_client(const std::string &socket_path, const std::vector<std::string> &inputs,
+               bool stats, bool shutdown) {
+    int fd;
+    if (!connect_to(socket_path, fd)) {
+        std::cerr << "Error: no compile server listening on '" << socket_path << "'\n";
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    auto request = [&](const std::string &command, const std::string &body,
+                       std::string &reply, std::string &status) {
+        std::string header;
+        if (!send_message(fd, command, body) || !read_header(fd, header)) return false;
+        size_t sp = header.rfind(' ');
+        unsigned long long length = 0;
+        if (sp == std::string::npos || std::sscanf(header.c_str() + sp + 1, "%llu", &length) != 1 ||
+            length > MAX_BODY) {
+            return false;
+        }
+        status = header.substr(0, sp);
+        reply.resize(static_cast<size_t>(length));
+        return length == 0 || read_all(fd, &reply[0], reply.size());
+    };
+
+    int exit_status = 0;
+    std::string reply, status;
+    if (stats || shutdown) {
+        if (!request(stats ? "STATS" : "SHUTDOWN", "", reply, status)) {
+            std::cerr << "Error: lost connection to the compile server\n";
+            exit_status = 1;
+        } else {
+            std::cout << reply;
+        }
+    }
+    for (const auto &input : inputs) {
+        bool from_stdin = input == "-";
+        std::string body;
+        if (from_stdin) {
+            std::stringstream text;
+            text << std::cin.rdbuf();
+            body = text.str();
+        } else {
+            body = std::filesystem::absolute(input).string();
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (!request(from_stdin ? "SOURCE" : "FILE", body, reply, status)) {
+            std::cerr << "Error: lost connection to the compile server\n";
+            exit_status = 1;
+            break;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (status != "OK") {
+            int line = 0, col = 0;
+            std::sscanf(status.c_str(), "ERROR %d %d", &line, &col);
+            std::cerr << input;
+            if (line > 0) std::cerr << ':' << line << ':' << col;
+            std::cerr << ": Compilation Error: " << reply << "\n";
+            exit_status = 1;
+            continue;
+        }
+        if (from_stdin) {
+            std::cout << reply;
+            continue;
+        }
+        std::filesystem::path outPath = input;
+        outPath.replace_extension(".lc");
+        std::ofstream out(outPath, std::ios::binary);
+        if (!out || !out.write(reply.data(), static_cast<std::streamsize>(reply.size()))) {
+            std::cerr << "Error: could not write to output file '" << outPath.string() << "'\n";
+            exit_status = 1;
+            continue;
+        }
+        std::printf("%s -> %s (%zu bytes, %.3f ms)\n", input.c_str(), outPath.string().c_str(), reply.size(), ms);
+    }
+    ::close(fd);
+    return exit_status;
+}
@@ -0,0 +1,121 @@
+/***************************************************************************************
+*    Title: A Mathematical Approach To Compilers
+*    Author: Cameron Haynes
+*    Date: 03/09/2025
+*    Description: work-stealing thread pool shared by the parallel compiler modes
+***************************************************************************************/
+
+#include "thread_pool.hpp"
+#include <exception>
+
+static thread_local int current_worker = -1;
+static thread_local const ThreadPool *current_pool = nullptr;
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_m);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto &t : workers) t.join();
+}
+
+int ThreadPool::worker_index() {
+    return current_worker;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t target;
+    if (current_pool == this) {
+        target = static_cast<size_t>(current_worker);
+    } else {
+        target = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+    unfinished.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->m);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_m);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+    work_cv.notify_one();
+}
+
+bool ThreadPool::try_pop(size_t self, std::function<void()> &task) {
+    {
+        Queue &own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.m);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); k++) {
+        Queue &victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.m);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t self) {
+    current_worker = static_cast<int>(self);
+    current_pool = this;
+    std::function<void()> task;
+    for (;;) {
+        if (try_pop(self, task)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(sleep_m);
+                idle_cv.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_m);
+        work_cv.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(sleep_m);
+    idle_cv.wait(lock, [this] { return unfinished.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)> &body) {
+    if (grain == 0) grain = 1;
+    std::exception_ptr error;
+    std::mutex error_m;
+    for (size_t begin = 0; begin < n; begin += grain) {
+        size_t end = begin + grain < n ? begin + grain : n;
+        submit([&, begin, end] {
+            try {
+                body(begin, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_m);
+                if (!error) error = std::current_exception();
+            }
+        });
+    }
+    wait_idle();
+    if (error) std::rethrow_exception(error);
+}
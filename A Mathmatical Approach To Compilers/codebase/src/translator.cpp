@@ -6,14 +6,38 @@
 ***************************************************************************************/
 
 #include "translator.hpp"
+#include "fold.hpp"
+#include "optimize.hpp"
+#include "form_cache.hpp"
+#include "profile.hpp"
+#include <atomic>
+#include <optional>
 #include <stdexcept>
-#include <unordered_map>
 #include <iostream>
-#include <sstream>
+#include <string_view>
+#include <vector>
 
-static std::unordered_map<int, std::string> numeral_cache;
+static TranslateOptions options;
+static std::atomic<size_t> shared_bindings{0};
+static std::atomic<size_t> term_nodes{0};
+static std::atomic<BuiltinSet> used_builtins{0};
+static BuiltinSet written_builtins = 0;   // only touched by write_prelude
+static size_t prelude_definitions = 0;
+static FormCache *form_cache = nullptr;
 
-static bool is_integer_atom(const std::string &a) {
+void set_translate_options(const TranslateOptions &opts) {
+    options = opts;
+}
+
+const TranslateOptions &translate_options() {
+    return options;
+}
+
+void set_form_cache(FormCache *cache) {
+    form_cache = cache;
+}
+
+static bool is_integer_atom(std::string_view a) {
     if (a.empty()) return false;
     size_t i = 0;
     if (a[0] == '-' && a.size() > 1) i = 1;
@@ -23,265 +47,666 @@ static bool is_integer_atom(const std::string &a) {
     return true;
 }
 
-static std::string church_numeral(int n) {
-    if (n < 0) throw std::runtime_error("Negative numbers not supported in Church numerals");
+// Read-only views over the two AST representations. translate_node is written
+// once against this small interface and instantiated for each of them.
+struct SExprView {
+    const SExpr *e;
+    bool is_atom() const { return e->is_atom; }
+    std::string_view atom() const { return e->atom; }
+    size_t size() const { return e->list.size(); }
+    SExprView operator[](size_t i) const { return {e->list[i].get()}; }
+};
 
-    auto it = numeral_cache.find(n);
-    if (it != numeral_cache.end()) return it->second;
+struct ArenaView {
+    const AstArena *a;
+    AstArena::Id id;
+    bool is_atom() const { return (*a)[id].is_atom; }
+    std::string_view atom() const { return a->atom(id); }
+    size_t size() const { return (*a)[id].count; }
+    ArenaView operator[](size_t i) const { return {a, a->child(id, static_cast<uint32_t>(i))}; }
+};
 
-    std::string result;
-    if (n == 0) {
-        result = "λf.λx.x";
-    } else {
-        result = "λf.λx.";
-        for (int i = 0; i < n; ++i) {
-            result += "f ";
+// Divides a decimal digit string by d in place and returns the remainder.
+static uint32_t divmod_decimal(std::string &digits, uint32_t d) {
+    uint64_t rem = 0;
+    size_t out = 0;
+    for (char c : digits) {
+        rem = rem * 10 + static_cast<uint64_t>(c - '0');
+        char q = static_cast<char>('0' + rem / d);
+        rem %= d;
+        if (out > 0 || q != '0') digits[out++] = q;
+    }
+    digits.resize(out);
+    return static_cast<uint32_t>(rem);
+}
+
+// Literal of any length as a Church numeral. Unary mode spells the value
+// out and so needs it to fit in 32 bits. Compact mode keeps values below
+// COMPACT_THRESHOLD unary and builds larger ones from base-COMPACT_BASE
+// digits by Horner's rule, (((d2 * B) + d1) * B) + d0, using LMUL/LADD.
+// The IR is then logarithmic in the value and the digit and base numerals
+// are shared nodes.
+static TermId translate_numeral(std::string_view a, TermTable &tt) {
+    constexpr uint32_t COMPACT_BASE = 16;
+    constexpr uint32_t COMPACT_THRESHOLD = 64;
+
+    bool negative = a[0] == '-';
+    std::string digits(a.substr(negative ? 1 : 0));
+    size_t lead = digits.find_first_not_of('0');
+    digits.erase(0, lead == std::string::npos ? digits.size() : lead);
+    if (digits.empty()) return tt.num(0);
+    if (negative) throw std::runtime_error("Negative numbers not supported in Church numerals");
+
+    bool fits = digits.size() < 10 || (digits.size() == 10 && digits <= "4294967295");
+    if (options.numerals == NumeralMode::Unary) {
+        if (!fits) {
+            throw std::runtime_error("Numeral " + digits + " is too large for a unary Church numeral"
+                                     " (use --numerals=compact)");
         }
-        result += "x";
-        for (int i = 0; i < n; ++i) {
-            result += "";
+        return tt.num(static_cast<uint32_t>(std::stoul(digits)));
+    }
+    if (fits && std::stoul(digits) < COMPACT_THRESHOLD) {
+        return tt.num(static_cast<uint32_t>(std::stoul(digits)));
+    }
+
+    std::vector<uint32_t> base_digits; // least significant first
+    while (!digits.empty()) {
+        base_digits.push_back(divmod_decimal(digits, COMPACT_BASE));
+    }
+    TermId base = tt.num(COMPACT_BASE);
+    TermId acc = tt.num(base_digits.back());
+    for (size_t i = base_digits.size() - 1; i-- > 0;) {
+        acc = tt.app(tt.app(tt.constant(Builtin::LMUL), acc), base);
+        if (base_digits[i] != 0) {
+            acc = tt.app(tt.app(tt.constant(Builtin::LADD), acc), tt.num(base_digits[i]));
         }
     }
-    numeral_cache[n] = result;
-    return result;
-}
-//function application helper
-static std::string app(const std::string &f, const std::string &arg) {
-    return "(" + f + " " + arg + ")";
-}
-
-//ops
-const std::string LADD = "(λm.λn.λf.λx. m f (n f x))";  // addition
-const std::string LMUL = "(λm.λn.λf. m (n f))";         // multiplication
-const std::string LSUB = "(λm.λn. n PRED m)";           // subtraction
-const std::string LDIV = "(λm.λn. m (n PRED) m)";       // division
-
-//bools
-const std::string LTRUE  = "(λt.λf.t)";
-const std::string LFALSE = "(λt.λf.f)";
-const std::string LAND   = "(λp.λq. p q p)";            // AND
-const std::string LOR    = "(λp.λq. p p q)";            // OR
-const std::string LNOT   = "(λp.λa.λb. p b a)";         // NOT
-
-//comparison
-const std::string LEQ    = "(λm.λn. ISZERO (SUB m n))"; // <=
-const std::string LLT    = "(λm.λn. NOT (LEQ n m))";    // <
-const std::string LGT    = "(λm.λn. LT n m)";           // >
-const std::string LGEQ   = "(λm.λn. LEQ n m)";          // >=
-
-//help ops
-const std::string LSUCC  = "(λn.λf.λx. f (n f x))";     // successor
-const std::string LPRED  = "(λn.λf.λx. n (λg.λh. h (g f)) (λu.x) (λu.u))"; // predecessor
-const std::string LISZERO = "(λn. n (λx.FALSE) TRUE)";  // ? == 0
-
-// recursion
-const std::string Y_COMBINATOR = "(λf. (λx. f (x x)) (λx. f (x x)))";
-
-//pairs
-const std::string LPAIR  = "(λx.λy.λf. f x y)";         // create pair
-const std::string LFIRST = "(λp. p (λx.λy.x))";         // first element
-const std::string LSECOND = "(λp. p (λx.λy.y))";        // second element
-
-//pair
-const std::string LNIL   = "(λx.TRUE)";                 // rmpty list
-const std::string LCONS  = "(λh.λt.λf. f h t)";         // cons
-const std::string LHEAD  = "FIRST";                     // list head
-const std::string LTAIL  = "SECOND";                    // list tail
-const std::string LISNIL = "(λl. l (λh.λt.FALSE))";     // ? == empty
-
-static std::string translate_atom(const std::string &a) {
+    return acc;
+}
+
+static TermId translate_atom(std::string_view a, TermTable &tt) {
     if (is_integer_atom(a)) {
-        int v = std::stoi(a);
-        return church_numeral(v);
+        return translate_numeral(a, tt);
+    }
+    if (a == "true" || a == "TRUE") return tt.constant(Builtin::LTRUE);
+    if (a == "false" || a == "FALSE") return tt.constant(Builtin::LFALSE);
+    if (a == "nil" || a == "NIL") return tt.constant(Builtin::LNIL);
+    // a prelude name used directly refers to the prelude's definition
+    Builtin b;
+    if (options.prelude && builtin_from_name(a, b)) return tt.constant(b);
+    return tt.var(a);
+}
+
+// Binding a prelude name would capture the definition for every builtin
+// used inside the binder's scope.
+static void check_binder(std::string_view name) {
+    Builtin b;
+    if (options.prelude && builtin_from_name(name, b)) {
+        throw std::runtime_error("'" + std::string(name) +
+                                 "' names a prelude definition and cannot be bound with --prelude");
     }
-    if (a == "true" || a == "TRUE") return LTRUE;
-    if (a == "false" || a == "FALSE") return LFALSE;
-    if (a == "nil" || a == "NIL") return LNIL;
-    return a;
 }
 
-static std::string translate_list(const std::vector<std::shared_ptr<SExpr>> &lst) {
-    if (lst.empty()) return LNIL;
+// Lists are lowered without recursion: every open list is a Frame on an
+// explicit stack, and each child's term is handed back to its parent's
+// frame. Nesting depth is then bounded by memory, not the C++ stack.
+//
+// A frame's shape says which children it translates, in which order, and
+// how it combines their terms. Terms are built in the same order as a
+// recursive lowering would build them, so ids (and --cse names) do not
+// depend on how the walk is driven.
+enum class Shape : uint8_t {
+    Fold,           // (op a b c) -> ((op ((op a) b)) c)
+    Application,    // (f a b ...) -> ((f a) b) ...
+    Unary,          // (op a) -> (op a)
+    Binary,         // (op a b) -> ((op a) b)
+    If,             // (if c t e) -> ((c t) e)
+    Lambda,         // body, then one λ per parameter from the last
+    Let,            // body, then each binding's value from the last
+};
 
-    if (!lst[0]->is_atom) {
-        std::string res = translate(lst[0]);
-        for (size_t i = 1; i < lst.size(); ++i) {
-            res = app(res, translate(lst[i]));
-        }
-        return res;
+template <typename Node>
+struct Frame {
+    Node lst;
+    Shape shape;
+    Builtin op = Builtin::LNIL;
+    size_t step = 0;    // child terms received so far
+    TermId acc = 0;
+    TermId aux = 0;
+};
+
+// Checks a non-empty list form and decides how it is lowered.
+template <typename Node>
+static Frame<Node> open_list(Node lst) {
+    auto frame = [&](Shape shape, Builtin op = Builtin::LNIL) { return Frame<Node>{lst, shape, op}; };
+    if (!lst[0].is_atom()) {
+        return frame(Shape::Application);
     }
 
-    std::string head = lst[0]->atom;
+    std::string_view head = lst[0].atom();
     if (head == "+") {
         if (lst.size() < 3) throw std::runtime_error("Operator + needs at least two operands");
-        std::string res = translate(lst[1]);
-        for (size_t i = 2; i < lst.size(); ++i) {
-            res = app(app(LADD, res), translate(lst[i]));
-        }
-        return res;
+        return frame(Shape::Fold, Builtin::LADD);
     }
     if (head == "*") {
         if (lst.size() < 3) throw std::runtime_error("Operator * needs at least two operands");
-        std::string res = translate(lst[1]);
-        for (size_t i = 2; i < lst.size(); ++i) {
-            res = app(app(LMUL, res), translate(lst[i]));
-        }
-        return res;
+        return frame(Shape::Fold, Builtin::LMUL);
     }
     if (head == "-") {
         if (lst.size() != 3) throw std::runtime_error("Operator - requires exactly two operands");
-        return app(app(LSUB, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LSUB);
     }
     if (head == "/") {
         if (lst.size() != 3) throw std::runtime_error("Operator / requires exactly two operands");
-        return app(app(LDIV, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LDIV);
     }
     if (head == "=" || head == "eq") {
         if (lst.size() != 3) throw std::runtime_error("Equality requires exactly two operands");
-        return app(app(LEQ, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LEQUAL);
     }
     if (head == "<") {
         if (lst.size() != 3) throw std::runtime_error("Less than requires exactly two operands");
-        return app(app(LLT, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LLT);
     }
     if (head == ">") {
         if (lst.size() != 3) throw std::runtime_error("Greater than requires exactly two operands");
-        return app(app(LGT, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LGT);
     }
     if (head == "<=" || head == "leq") {
         if (lst.size() != 3) throw std::runtime_error("Less than or equal requires exactly two operands");
-        return app(app(LGEQ, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LEQ);
     }
     if (head == ">=" || head == "geq") {
         if (lst.size() != 3) throw std::runtime_error("Greater than or equal requires exactly two operands");
-        return app(app(LGEQ, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LGEQ);
     }
     if (head == "and") {
         if (lst.size() < 3) throw std::runtime_error("AND requires at least two operands");
-        std::string res = translate(lst[1]);
-        for (size_t i = 2; i < lst.size(); ++i) {
-            res = app(app(LAND, res), translate(lst[i]));
-        }
-        return res;
+        return frame(Shape::Fold, Builtin::LAND);
     }
     if (head == "or") {
         if (lst.size() < 3) throw std::runtime_error("OR requires at least two operands");
-        std::string res = translate(lst[1]);
-        for (size_t i = 2; i < lst.size(); ++i) {
-            res = app(app(LOR, res), translate(lst[i]));
-        }
-        return res;
+        return frame(Shape::Fold, Builtin::LOR);
     }
     if (head == "not") {
         if (lst.size() != 2) throw std::runtime_error("NOT requires exactly one operand");
-        return app(LNOT, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LNOT);
     }
     if (head == "lambda" || head == "λ") {
         if (lst.size() < 3) throw std::runtime_error("Malformed lambda expression");
-        std::string body = translate(lst[2]);
-        if (lst[1]->is_atom) {
-            return "λ" + lst[1]->atom + "." + body;
-        } else {
-            for (auto it = lst[1]->list.rbegin(); it != lst[1]->list.rend(); ++it) {
-                if (!(*it)->is_atom) {
+        Node params = lst[1];
+        if (!params.is_atom()) {
+            for (size_t i = 0; i < params.size(); ++i) {
+                if (!params[i].is_atom()) {
                     throw std::runtime_error("Lambda parameter must be a symbol");
                 }
-                body = "λ" + (*it)->atom + "." + body;
             }
-            return body;
         }
+        return frame(Shape::Lambda);
     }
     if (head == "let") {
         if (lst.size() != 3) throw std::runtime_error("Let requires bindings and body");
-        if (lst[1]->is_atom || lst[1]->list.empty()) {
+        Node bindings = lst[1];
+        if (bindings.is_atom() || bindings.size() == 0) {
             throw std::runtime_error("Let requires binding list");
         }
-
-        std::string body = translate(lst[2]);
-        for (auto it = lst[1]->list.rbegin(); it != lst[1]->list.rend(); ++it) {
-            auto binding = *it;
-            if (binding->is_atom || binding->list.size() != 2 || !binding->list[0]->is_atom) {
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            Node binding = bindings[i];
+            if (binding.is_atom() || binding.size() != 2 || !binding[0].is_atom()) {
                 throw std::runtime_error("Invalid let binding format: expected (var value)");
             }
-            std::string var = binding->list[0]->atom;
-            std::string val = translate(binding->list[1]);
-            body = app("λ" + var + "." + body, val);
         }
-        return body;
+        return frame(Shape::Let);
     }
     if (head == "if") {
         if (lst.size() != 4) {
             throw std::runtime_error("If requires exactly 3 arguments: condition, then-branch, else-branch");
         }
-        std::string cond = translate(lst[1]);
-        std::string thenBranch = translate(lst[2]);
-        std::string elseBranch = translate(lst[3]);
-        return app(app(cond, thenBranch), elseBranch);
+        return frame(Shape::If);
     }
     if (head == "cons") {
         if (lst.size() != 3) throw std::runtime_error("Cons requires exactly two arguments");
-        return app(app(LCONS, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LCONS);
     }
     if (head == "car" || head == "head") {
         if (lst.size() != 2) throw std::runtime_error("Car/head requires exactly one argument");
-        return app(LHEAD, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LHEAD);
     }
     if (head == "cdr" || head == "tail") {
         if (lst.size() != 2) throw std::runtime_error("Cdr/tail requires exactly one argument");
-        return app(LTAIL, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LTAIL);
     }
     if (head == "null?" || head == "nil?") {
         if (lst.size() != 2) throw std::runtime_error("Null test requires exactly one argument");
-        return app(LISNIL, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LISNIL);
     }
     if (head == "pair") {
         if (lst.size() != 3) throw std::runtime_error("Pair requires exactly two arguments");
-        return app(app(LPAIR, translate(lst[1])), translate(lst[2]));
+        return frame(Shape::Binary, Builtin::LPAIR);
     }
     if (head == "first" || head == "fst") {
         if (lst.size() != 2) throw std::runtime_error("First requires exactly one argument");
-        return app(LFIRST, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LFIRST);
     }
     if (head == "second" || head == "snd") {
         if (lst.size() != 2) throw std::runtime_error("Second requires exactly one argument");
-        return app(LSECOND, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LSECOND);
     }
     if (head == "rec" || head == "recursive") {
         if (lst.size() != 2) throw std::runtime_error("Recursive definition requires exactly one argument");
-        return app(Y_COMBINATOR, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::Y_COMBINATOR);
     }
     if (head == "succ") {
         if (lst.size() != 2) throw std::runtime_error("Successor requires exactly one argument");
-        return app(LSUCC, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LSUCC);
     }
     if (head == "pred") {
         if (lst.size() != 2) throw std::runtime_error("Predecessor requires exactly one argument");
-        return app(LPRED, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LPRED);
     }
     if (head == "zero?") {
         if (lst.size() != 2) throw std::runtime_error("Zero test requires exactly one argument");
-        return app(LISZERO, translate(lst[1]));
+        return frame(Shape::Unary, Builtin::LISZERO);
     }
 
     // generel func application
-    std::string res = translate(lst[0]);
-    for (size_t i = 1; i < lst.size(); ++i) {
-        res = app(res, translate(lst[i]));
+    return frame(Shape::Application);
+}
+
+// The child whose term the frame needs next; false once it has them all.
+template <typename Node>
+static bool next_child(const Frame<Node> &f, Node &child) {
+    const Node &lst = f.lst;
+    size_t k = f.step;
+    switch (f.shape) {
+    case Shape::Fold:
+        if (k + 1 >= lst.size()) return false;
+        child = lst[k + 1];
+        return true;
+    case Shape::Application:
+        if (k >= lst.size()) return false;
+        child = lst[k];
+        return true;
+    case Shape::Unary:
+    case Shape::Binary:
+    case Shape::If:
+        if (k + 1 >= lst.size()) return false;
+        child = lst[k + 1];
+        return true;
+    case Shape::Lambda:
+        if (k >= 1) return false;
+        child = lst[2];
+        return true;
+    case Shape::Let: {
+        // body first, then the binding values from the last one
+        Node bindings = lst[1];
+        if (k > bindings.size()) return false;
+        child = k == 0 ? lst[2] : bindings[bindings.size() - k][1];
+        return true;
+    }
+    }
+    return false;
+}
+
+// Folds the next child's term x into the frame.
+template <typename Node>
+static void accept_child(Frame<Node> &f, TermId x, TermTable &tt) {
+    size_t k = f.step++;
+    switch (f.shape) {
+    case Shape::Fold:
+        f.acc = k == 0 ? x : tt.app(tt.app(tt.constant(f.op), f.acc), x);
+        break;
+    case Shape::Application:
+        f.acc = k == 0 ? x : tt.app(f.acc, x);
+        break;
+    case Shape::Unary:
+        f.acc = tt.app(tt.constant(f.op), x);
+        break;
+    case Shape::Binary:
+        f.acc = k == 0 ? x : tt.app(tt.app(tt.constant(f.op), f.acc), x);
+        break;
+    case Shape::If:
+        if (k == 0) {
+            f.acc = x;
+        } else if (k == 1) {
+            f.aux = x;
+        } else {
+            f.acc = tt.app(tt.app(f.acc, f.aux), x);
+        }
+        break;
+    case Shape::Lambda: {
+        Node params = f.lst[1];
+        if (params.is_atom()) {
+            check_binder(params.atom());
+            f.acc = tt.lam(params.atom(), x);
+            break;
+        }
+        f.acc = x;
+        for (size_t i = params.size(); i-- > 0;) {
+            check_binder(params[i].atom());
+            f.acc = tt.lam(params[i].atom(), f.acc);
+        }
+        break;
+    }
+    case Shape::Let: {
+        // (let ((a x) (b y)) body) -> ((λa.((λb.body) y)) x)
+        if (k == 0) {
+            f.acc = x;
+            break;
+        }
+        Node bindings = f.lst[1];
+        Node binding = bindings[bindings.size() - k];
+        check_binder(binding[0].atom());
+        f.acc = tt.app(tt.lam(binding[0].atom(), f.acc), x);
+        break;
+    }
     }
-    return res;
+}
+
+template <typename Node>
+static TermId translate_node(Node n, TermTable &tt) {
+    std::vector<Frame<Node>> stack;
+    for (;;) {
+        // descend to the next leaf (or childless list), opening frames
+        TermId term;
+        if (n.is_atom()) {
+            term = translate_atom(n.atom(), tt);
+        } else if (n.size() == 0) {
+            term = tt.constant(Builtin::LNIL);
+        } else {
+            stack.push_back(open_list(n));
+            next_child(stack.back(), n);
+            continue;
+        }
+        // hand the term up until some frame still has a child to translate
+        for (;;) {
+            if (stack.empty()) return term;
+            Frame<Node> &f = stack.back();
+            accept_child(f, term, tt);
+            if (next_child(f, n)) break;
+            term = f.acc;
+            stack.pop_back();
+        }
+    }
+}
+
+TermId translate_term(const std::shared_ptr<SExpr> &sexpr, TermTable &terms) {
+    return translate_node(SExprView{sexpr.get()}, terms);
+}
+
+TermId translate_term(const AstArena &arena, AstArena::Id node, TermTable &terms) {
+    return translate_node(ArenaView{&arena, node}, terms);
+}
+
+// Each thread lowers into its own table, reset per form so memory follows
+// the largest form rather than the whole program.
+static thread_local TermTable form_terms;
+
+// With --optimize the form is simplified before it is printed or encoded.
+static TermId finish_form(TermId root) {
+    if (options.optimize) {
+        PhaseScope scope(Phase::Optimize);
+        OptimizeOptions opts;
+        opts.fuel = options.optimize_fuel;
+        opts.builtin_names = options.prelude;
+        root = optimize_term(form_terms, root, opts);
+    }
+    term_nodes.fetch_add(form_terms.size(), std::memory_order_relaxed);
+    return root;
+}
+
+// Prints a form and returns the builtins it refers to (with --prelude).
+static BuiltinSet emit_form(TermId root, Emitter &out) {
+    root = finish_form(root);
+    PhaseScope scope(Phase::Print);
+    std::optional<PrintProfile> profile;
+    if (profiling()) profile.emplace();
+    PrintProfile *counts = profile ? &*profile : nullptr;
+    BuiltinSet used = 0;
+    if (options.prelude) {
+        // only what the root reaches: the optimizer leaves the terms it
+        // rewrote behind in the table
+        std::vector<char> reach(static_cast<size_t>(root) + 1, 0);
+        reach[root] = 1;
+        for (TermId id = root + 1; id-- > 0;) {
+            if (!reach[id]) continue;
+            const Term &t = form_terms[id];
+            if (t.kind == TermKind::Const) used |= builtin_bit(static_cast<Builtin>(t.a));
+            if (t.kind == TermKind::App) reach[t.a] = 1;
+            if (t.kind == TermKind::App || t.kind == TermKind::Lam) reach[t.b] = 1;
+        }
+        used_builtins.fetch_or(used, std::memory_order_relaxed);
+    }
+    if (options.cse) {
+        shared_bindings.fetch_add(print_shared(form_terms, root, out, options.prelude, counts),
+                                  std::memory_order_relaxed);
+    } else {
+        print_term(form_terms, root, out, options.prelude, counts);
+    }
+    if (profile) record_output(*profile);
+    return used;
+}
+
+template <typename Node>
+static void canonical_text(Node n, std::string &out) {
+    // every open list with the index of its next child
+    std::vector<std::pair<Node, size_t>> open;
+    for (;;) {
+        if (n.is_atom()) {
+            out += n.atom();
+        } else {
+            out += '(';
+            open.push_back({n, 0});
+        }
+        for (;;) {
+            if (open.empty()) return;
+            auto &[lst, next] = open.back();
+            if (next < lst.size()) {
+                if (next > 0) out += ' ';
+                n = lst[next++];
+                break;
+            }
+            out += ')';
+            open.pop_back();
+        }
+    }
+}
+
+// Form cache key: a fingerprint of the builtin encodings, every option the
+// IR depends on, then the form's canonical text.
+template <typename Node>
+static std::string form_cache_key(Node n, bool binary) {
+    static const uint64_t builtins_fingerprint = [] {
+        std::string all;
+        for (size_t b = 0; b < BUILTIN_COUNT; b++) {
+            all += builtin_name(static_cast<Builtin>(b));
+            all += builtin_text(static_cast<Builtin>(b));
+        }
+        return form_cache_hash(all);
+    }();
+    std::string key = std::to_string(builtins_fingerprint);
+    key += binary ? " lcb" : " lc";
+    key += options.numerals == NumeralMode::Compact ? " compact" : " unary";
+    if (options.cse) key += " cse";
+    if (options.prelude) key += " prelude";
+    if (options.optimize) key += " optimize=" + std::to_string(options.optimize_fuel);
+    key += '\n';
+    canonical_text(n, key);
+    return key;
+}
+
+// --profile names a form by the start of its canonical text.
+template <typename Node>
+static void form_label(Node n, std::string &out, size_t limit) {
+    if (out.size() >= limit) return;
+    if (n.is_atom()) {
+        out += n.atom();
+        return;
+    }
+    out += '(';
+    for (size_t i = 0; i < n.size() && out.size() < limit; i++) {
+        if (i > 0) out += ' ';
+        form_label(n[i], out, limit);
+    }
+    out += ')';
+}
+
+template <typename Node>
+static void profile_form(Node n, uint64_t start, uint64_t bytes, bool cached) {
+    uint64_t elapsed = profile_now_ns() - start;
+    const size_t LIMIT = 60;
+    std::string label;
+    form_label(n, label, LIMIT);
+    if (label.size() > LIMIT) {
+        size_t cut = LIMIT;
+        while (cut > 0 && (static_cast<unsigned char>(label[cut]) & 0xC0) == 0x80) cut--;
+        label.resize(cut);
+        label += "...";
+    }
+    record_form(std::move(label), elapsed, bytes, cached);
+}
+
+template <typename Node>
+static TermId lower_form(Node n) {
+    PhaseScope scope(Phase::Lower);
+    return translate_node(n, form_terms);
+}
+
+template <typename Node>
+static BuiltinSet translate_text(Node n, Emitter &out) {
+    uint64_t start = profiling() ? profile_now_ns() : 0;
+    size_t before = out.size();
+    bool cached = false;
+    BuiltinSet used = 0;
+    form_terms.clear();
+    if (!form_cache) {
+        used = emit_form(lower_form(n), out);
+    } else {
+        std::string key;
+        std::string ir;
+        {
+            PhaseScope scope(Phase::Lower);
+            key = form_cache_key(n, false);
+            cached = form_cache->lookup(key, ir, used);
+        }
+        if (cached) {
+            used_builtins.fetch_or(used, std::memory_order_relaxed);
+        } else {
+            Emitter form_out;
+            used = emit_form(lower_form(n), form_out);
+            ir = form_out.take();
+            form_cache->store(key, ir, used);
+        }
+        out << ir;
+    }
+    if (profiling()) profile_form(n, start, out.size() - before, cached);
+    return used;
+}
+
+template <typename Node>
+static void translate_record(Node n, std::string &record) {
+    uint64_t start = profiling() ? profile_now_ns() : 0;
+    form_terms.clear();
+    std::string key;
+    BuiltinSet used = 0;
+    if (form_cache) {
+        PhaseScope scope(Phase::Lower);
+        key = form_cache_key(n, true);
+        if (form_cache->lookup(key, record, used)) {
+            if (profiling()) profile_form(n, start, record.size(), true);
+            return;
+        }
+    }
+    TermId root = finish_form(lower_form(n));
+    {
+        PhaseScope scope(Phase::Print);
+        encode_lcb_form(form_terms, root, record);
+    }
+    if (form_cache) form_cache->store(key, record, 0);
+    if (profiling()) profile_form(n, start, record.size(), false);
+}
+
+BuiltinSet translate(const std::shared_ptr<SExpr> &sexpr, Emitter &out) {
+    return translate_text(SExprView{sexpr.get()}, out);
+}
+
+BuiltinSet translate(const AstArena &arena, AstArena::Id node, Emitter &out) {
+    return translate_text(ArenaView{&arena, node}, out);
+}
+
+void translate_binary(const std::shared_ptr<SExpr> &sexpr, std::string &record) {
+    translate_record(SExprView{sexpr.get()}, record);
+}
+
+void translate_binary(const AstArena &arena, AstArena::Id node, std::string &record) {
+    translate_record(ArenaView{&arena, node}, record);
 }
 
 std::string translate(const std::shared_ptr<SExpr> &sexpr) {
-    if (sexpr->is_atom) {
-        return translate_atom(sexpr->atom);
+    Emitter out;
+    translate(sexpr, out);
+    return out.take();
+}
+
+std::string translate(const AstArena &arena, AstArena::Id node) {
+    Emitter out;
+    translate(arena, node, out);
+    return out.take();
+}
+
+size_t write_prelude(Emitter &out, BuiltinSet used, BuiltinSet &written) {
+    std::vector<Builtin> order;
+    written = builtin_closure(used, written, order);
+    for (Builtin b : order) {
+        out << builtin_name(b) << " := " << builtin_text(b) << '\n';
     }
-    return translate_list(sexpr->list);
+    return order.size();
+}
+
+size_t write_prelude(Emitter &out) {
+    size_t n = write_prelude(out, used_builtins.load(), written_builtins);
+    prelude_definitions += n;
+    return n;
 }
 
 //util funcs
-void print_cache_stats() {
-    std::cout << "Church numeral cache contains " << numeral_cache.size() << " entries\n";
+void print_cache_stats(std::ostream &out) {
+    NumeralCacheStats nc = numeral_cache_stats();
+    out << "Church numeral cache contains " << nc.entries << " entries ("
+        << nc.bytes << " of " << nc.budget << " bytes, " << nc.hits << " hits, "
+        << nc.misses << " misses, " << nc.evictions << " evictions)\n";
+    out << "λ-term nodes built: " << term_nodes.load() << "\n";
+    if (options.cse) {
+        out << "Shared subterms bound: " << shared_bindings.load() << "\n";
+    }
+    if (options.fold) {
+        out << "Constant-folded nodes: " << folded_nodes() << "\n";
+    }
+    if (options.optimize) {
+        OptimizeStats st = optimize_stats();
+        out << "β-reductions: " << st.beta << " (" << st.inlined << " single-use inlines), "
+                  << st.dead << " dead bindings dropped, " << st.eta << " η-reductions\n";
+        out << "Optimized size: " << st.bytes_before << " -> " << st.bytes_after << " bytes";
+        if (st.out_of_fuel > 0) out << " (" << st.out_of_fuel << " forms ran out of fuel)";
+        out << "\n";
+    }
+    if (form_cache) {
+        FormCacheStats st = form_cache->stats();
+        out << "Form cache: " << st.hits << " hits, " << st.misses << " misses, "
+                  << st.stored << " stored, " << st.evicted << " evicted ("
+                  << st.bytes << " of " << st.limit << " bytes)\n";
+    }
+    if (options.prelude) {
+        out << "Prelude definitions: " << prelude_definitions << "\n";
+    }
 }
 void clear_cache() {
-    numeral_cache.clear();
+    clear_numeral_cache();
+    term_nodes = 0;
+    shared_bindings = 0;
+    used_builtins = 0;
+    written_builtins = 0;
+    prelude_definitions = 0;
+    reset_fold_stats();
+    reset_optimize_stats();
 }
@@ -1,40 +1,37 @@
 #include <bits/stdc++.h>
+#include "merge.h"
 using namespace std;
 
-void merge(vector<int>& arr, int left, int mid, int right){
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
-    int i = left, j = mid + 1, k = left;
-    vector<int> temp(arr.begin(), arr.end());
-    while (i <= mid && j <= right) {
-        if (temp[i] <= temp[j]) {
-            arr[k] = temp[i];
-            i++;
-        } else {
-            arr[k] = temp[j];
+// Merges the sorted runs arr[left..mid] and arr[mid+1..right]. Only the
+// left run is copied out, into the caller's buffer, whose capacity is
+// reused from call to call; the right one is merged in place behind it.
+void merge(vector<int>& arr, int left, int mid, int right, vector<int>& buffer){
+    buffer.assign(arr.begin() + left, arr.begin() + mid + 1);
+    int i = 0, j = mid + 1, k = left;
+    int n1 = buffer.size();
+    while (i < n1 && j <= right) {
+        if (arr[j] < buffer[i]) {
+            arr[k] = arr[j];
             j++;
+        } else {
+            arr[k] = buffer[i];
+            i++;
         }
         k++;
     }
-    while (i <= mid) {
-        arr[k] = temp[i];
+    while (i < n1) {
+        arr[k] = buffer[i];
         i++;
         k++;
     }
-    while (j <= right) {
-        arr[k] = temp[j];
-        j++;
-        k++;
-    }
 }
 
 void mergeSort(vector<int>& arr, int left, int right){
-    if (left < right) {
-        int mid = left + (right - left) / 2;
-        mergeSort(arr, left, mid);
-        mergeSort(arr, mid + 1, right);
-        merge(arr, left, mid, right);
-    }
+    if (left < right) mergeSort(arr.begin() + left, arr.begin() + right + 1);
+}
+
+void parallelMergeSort(vector<int>& arr, int left, int right, unsigned threads){
+    if (left < right) parallelMergeSort(arr.begin() + left, arr.begin() + right + 1, threads);
 }
 
 void printVector(const vector<int>& arr){
@@ -42,7 +39,58 @@ void printVector(const vector<int>& arr){
     cout << endl;
 }
 
-int main(){
+// ./merge_sort_program N [THREADS] sorts N random ints, checks the result
+// against std::stable_sort and reports both times, then times
+// parallelMergeSort on 1, 2, 4, ... up to THREADS threads (by default
+// every hardware thread).
+int benchmark(size_t n, unsigned maxThreads){
+    mt19937_64 rng(42);
+    vector<int> arr(n);
+    for (int& x : arr) x = (int)rng();
+    vector<int> expected = arr;
+
+    auto start = chrono::steady_clock::now();
+    mergeSort(arr, 0, (int)arr.size() - 1);
+    double ours = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    stable_sort(expected.begin(), expected.end());
+    double std_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    bool ok = arr == expected;
+    cout << "n = " << n << ": mergeSort " << ours << " s, std::stable_sort "
+         << std_time << " s, " << (ok ? "sorted" : "NOT SORTED") << endl;
+
+    // Pairs with few distinct keys, so a merge that broke ties the wrong
+    // way would show.
+    vector<pair<int, int>> input(n);
+    for (size_t i = 0; i < n; i++) input[i] = make_pair((int)(rng() % 1000), (int)i);
+    auto byKey = [](const pair<int, int>& a, const pair<int, int>& b){ return a.first < b.first; };
+    vector<pair<int, int>> stable = input;
+    stable_sort(stable.begin(), stable.end(), byKey);
+
+    cout << "threads  seconds  speedup" << endl;
+    double base = 0;
+    for (unsigned threads = 1; ; threads = min(threads * 2, maxThreads)) {
+        vector<pair<int, int>> data = input;
+        start = chrono::steady_clock::now();
+        parallelMergeSort(data.begin(), data.end(), byKey, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (threads == 1) base = seconds;
+        bool same = data == stable;
+        ok = ok && same;
+        printf("%7u  %7.3f  %6.2fx%s\n", threads, seconds, base / seconds, same ? "" : "  NOT STABLE");
+        if (threads >= maxThreads) break;
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv){
+    if (argc > 1) {
+        unsigned threads = argc > 2 ? strtoul(argv[2], nullptr, 10) : thread::hardware_concurrency();
+        return benchmark(strtoull(argv[1], nullptr, 10), max(threads, 1u));
+    }
+
     vector<int> arr = { 12, 11, 13, 5, 6, 7 };
     cout << "Input Vec \n";
     printVector(arr);